@@ -0,0 +1,209 @@
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <cstring>
+#include <algorithm>
+#include "global.h"
+#include "input.h"
+#include "SHCIshm.h"
+#include "CIExpansion.h"
+
+using namespace std;
+using namespace Eigen;
+
+// header: magic, nspin, ndets, number of alpha and beta reference orbitals, number of hole (= particle) indices,
+// followed by the selection parameters the determinants were read with (see selectionParameters)
+static const long ciMagic = 0x3230304943434d56; // "VMCCI002"
+static const int headerSize = 11;
+static const int nparameters = 5;
+
+
+// wavefunction.ndets, ciThreshold (bit copy) and excitationLevel, system.numAct and numCore
+static std::array<long, nparameters> selectionParameters()
+{
+  std::array<long, nparameters> params;
+  params[0] = schd.ndets;
+  memcpy(&params[1], &schd.ciThreshold, sizeof(double));
+  params[2] = schd.excitationLevel;
+  params[3] = schd.nciAct;
+  params[4] = schd.nciCore;
+  return params;
+};
+
+
+static bool sameSelection(const long* header)
+{
+  std::array<long, nparameters> params = selectionParameters();
+  return std::equal(params.begin(), params.end(), header + headerSize - nparameters);
+};
+
+
+// byte offsets of the arrays of the flat layout, the integer arrays are padded to 8 bytes
+// ref alpha, ref beta, ranks, offsets, holes, particles, parities, coefficients, total size
+static std::array<size_t, 9> layout(const long* header)
+{
+  auto padded = [](size_t nint) { return (nint + 1) / 2 * 2 * sizeof(int); };
+  size_t nspin = header[1], ndets = header[2], nindices = header[5];
+  std::array<size_t, 9> pos;
+  pos[0] = headerSize * sizeof(long);
+  pos[1] = pos[0] + padded(header[3]);
+  pos[2] = pos[1] + padded(header[4]);
+  pos[3] = pos[2] + padded(nspin * ndets);
+  pos[4] = pos[3] + nspin * ndets * sizeof(long);
+  pos[5] = pos[4] + padded(nindices);
+  pos[6] = pos[5] + padded(nindices);
+  pos[7] = pos[6] + ndets * sizeof(double);
+  pos[8] = pos[7] + ndets * sizeof(double);
+  return pos;
+};
+
+
+// parses a dice determinant file and packs it into the flat layout
+static void packDeterminants(std::string fname, int nspin, std::vector<double>& buffer)
+{
+  std::array<std::vector<int>, 2> ref;
+  std::array<std::vector<std::array<VectorXi, 2>>, 2> excitations;
+  std::vector<double> parity, coeffs;
+  if (nspin == 1) readDeterminantsGHFBinary(fname, ref[0], excitations[0], parity, coeffs);
+  else if (fname == "dets") readDeterminants(fname, ref, excitations, parity, coeffs);
+  else readDeterminantsBinary(fname, ref, excitations, parity, coeffs);
+
+  long ndets = coeffs.size(), nindices = 0;
+  for (int sz = 0; sz < nspin; sz++)
+    for (long i = 0; i < ndets; i++) nindices += excitations[sz][i][0].size();
+  long header[headerSize] = {ciMagic, nspin, ndets, long(ref[0].size()), long(ref[1].size()), nindices};
+  std::array<long, nparameters> params = selectionParameters();
+  std::copy(params.begin(), params.end(), header + headerSize - nparameters);
+  std::array<size_t, 9> pos = layout(header);
+  buffer.assign(pos[8] / sizeof(double), 0.);
+  char* data = reinterpret_cast<char*>(buffer.data());
+  memcpy(data, header, sizeof(header));
+  std::copy(ref[0].begin(), ref[0].end(), reinterpret_cast<int*>(data + pos[0]));
+  std::copy(ref[1].begin(), ref[1].end(), reinterpret_cast<int*>(data + pos[1]));
+  int* ranks = reinterpret_cast<int*>(data + pos[2]);
+  long* offsets = reinterpret_cast<long*>(data + pos[3]);
+  int* holes = reinterpret_cast<int*>(data + pos[4]);
+  int* particles = reinterpret_cast<int*>(data + pos[5]);
+  long offset = 0;
+  for (long i = 0; i < ndets; i++) {
+    for (int sz = 0; sz < nspin; sz++) {
+      std::array<VectorXi, 2>& exc = excitations[sz][i];
+      int rank = exc[0].size();
+      ranks[i * nspin + sz] = rank;
+      offsets[i * nspin + sz] = offset;
+      for (int p = 0; p < rank; p++) {
+        holes[offset + p] = exc[0](p);
+        particles[offset + p] = exc[1](p);
+      }
+      offset += rank;
+    }
+  }
+  std::copy(parity.begin(), parity.end(), reinterpret_cast<double*>(data + pos[6]));
+  std::copy(coeffs.begin(), coeffs.end(), reinterpret_cast<double*>(data + pos[7]));
+};
+
+
+void CIExpansion::load(std::string fname, int pnspin, std::string compactFile)
+{
+  nspin = pnspin;
+  if (compactFile != "") {
+    // an existing compact file is reused only if it was written with the same selection parameters
+    bool writeQ = false;
+    if (commrank == 0) {
+      long header[headerSize] = {0};
+      ifstream existing(compactFile, ios::binary);
+      existing.read(reinterpret_cast<char*>(header), sizeof(header));
+      if (!existing.good()) writeQ = true;
+      else if (header[0] != ciMagic || header[1] != nspin || !sameSelection(header)) {
+        cout << "Compact determinant file " << compactFile << " was written with different parameters, rewriting it\n";
+        writeQ = true;
+      }
+    }
+    if (writeQ) {
+      std::vector<double> buffer;
+      packDeterminants(fname, nspin, buffer);
+      ofstream dump(compactFile, ios::binary);
+      dump.write(reinterpret_cast<char*>(buffer.data()), buffer.size() * sizeof(double));
+      dump.close();
+    }
+    MPI_Barrier(MPI_COMM_WORLD);
+    fname = compactFile;
+  }
+
+  // compact files are recognized by their magic number
+  int compactQ = 0;
+  if (commrank == 0) {
+    long magic = 0;
+    ifstream dump(fname, ios::binary);
+    dump.read(reinterpret_cast<char*>(&magic), sizeof(long));
+    compactQ = (dump.good() && magic == ciMagic) ? 1 : 0;
+  }
+  MPI_Bcast(&compactQ, 1, MPI_INT, 0, MPI_COMM_WORLD);
+
+  if (compactQ) {
+    fileMap = boost::interprocess::file_mapping(fname.c_str(), boost::interprocess::read_only);
+    region = boost::interprocess::mapped_region(fileMap, boost::interprocess::read_only);
+  }
+  else {
+    std::vector<double> buffer;
+    if (commrank == 0) packDeterminants(fname, nspin, buffer);
+    static int nsegments = 0;
+    std::string SHMName = "ci" + to_string(nsegments++) + cholSHMName;
+    ciSHMNames.push_back(SHMName);
+    segment = boost::interprocess::shared_memory_object(boost::interprocess::open_or_create, SHMName.c_str(), boost::interprocess::read_write);
+    MPI_Barrier(MPI_COMM_WORLD);
+    double* SHMAddress;
+    SHMVecFromVecs(buffer.data(), buffer.size(), SHMAddress, SHMName, segment, region);
+  }
+  setViews(static_cast<const char*>(region.get_address()), region.get_size());
+
+  if (commrank == 0 && compactQ) {
+    ofstream afqmcFile("afqmc.dat", ios::app);
+    afqmcFile << "# Compact determinant file " << fname << "\n# Number of determinants " << ndets << "\n#\n";
+    afqmcFile.close();
+  }
+};
+
+
+void CIExpansion::setViews(const char* data, size_t size)
+{
+  const long* header = reinterpret_cast<const long*>(data);
+  if (size < headerSize * sizeof(long) || header[0] != ciMagic || header[1] != nspin || layout(header)[8] > size) {
+    if (commrank == 0) cout << "Determinant file is not a valid compact file for " << (nspin == 2 ? "uhf" : "ghf") << " determinants\n";
+    exit(0);
+  }
+  if (!sameSelection(header)) {
+    if (commrank == 0) cout << "Compact determinant file was written with different ndets, ciThreshold, excitationLevel, numAct or numCore\n";
+    exit(0);
+  }
+  std::array<size_t, 9> pos = layout(header);
+  ndets = header[2];
+  nref[0] = header[3];
+  nref[1] = header[4];
+  refs[0] = reinterpret_cast<const int*>(data + pos[0]);
+  refs[1] = reinterpret_cast<const int*>(data + pos[1]);
+  ranks = reinterpret_cast<const int*>(data + pos[2]);
+  offsets = reinterpret_cast<const long*>(data + pos[3]);
+  holeData = reinterpret_cast<const int*>(data + pos[4]);
+  particleData = reinterpret_cast<const int*>(data + pos[5]);
+  parity = reinterpret_cast<const double*>(data + pos[6]);
+  coeffs = reinterpret_cast<const double*>(data + pos[7]);
+};
+
+
+Map<const VectorXi> CIExpansion::ref(int sz) const
+{
+  return Map<const VectorXi>(refs[sz], nref[sz]);
+};
+
+
+Map<const VectorXi> CIExpansion::holes(int sz, size_t i) const
+{
+  return Map<const VectorXi>(holeData + offsets[i * nspin + sz], ranks[i * nspin + sz]);
+};
+
+
+Map<const VectorXi> CIExpansion::particles(int sz, size_t i) const
+{
+  return Map<const VectorXi>(particleData + offsets[i * nspin + sz], ranks[i * nspin + sz]);
+};
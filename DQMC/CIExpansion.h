@@ -0,0 +1,49 @@
+#ifndef CIExpansion_HEADER_H
+#define CIExpansion_HEADER_H
+#include <string>
+#include <array>
+#include <Eigen/Dense>
+#include <boost/interprocess/shared_memory_object.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+// multi determinant trial in a flat layout: a header followed by contiguous arrays of the reference occupations,
+// excitation ranks and offsets, hole and particle indices, parities and ci coefficients
+// the same layout is used on disk (compact trial file) and in memory, the arrays are never copied per rank:
+// a compact file is memory mapped read only (shared through the page cache by all ranks on a node), a dice
+// file is parsed on the head rank and broadcast into a node shared memory segment like the cholesky vectors
+// nspin = 2 for uhf determinants (excitations per spin sector), 1 for ghf (spin orbital excitations)
+class CIExpansion {
+  public:
+    int nspin;
+    size_t ndets;
+    const double* parity;
+    const double* coeffs;
+
+    CIExpansion() : nspin(0), ndets(0), parity(nullptr), coeffs(nullptr) {};
+
+    // fname is a dice determinant file ("dets" for the text format) or a compact file, if compactFile is given
+    // it is used instead of fname, being written from fname first if it does not exist
+    void load(std::string fname, int pnspin, std::string compactFile = "");
+
+    Eigen::Map<const Eigen::VectorXi> ref(int sz) const;
+    int rank(int sz, size_t i) const { return ranks[i * nspin + sz]; };
+    // holes are positions in the reference, particles are orbitals
+    Eigen::Map<const Eigen::VectorXi> holes(int sz, size_t i) const;
+    Eigen::Map<const Eigen::VectorXi> particles(int sz, size_t i) const;
+
+  private:
+    std::array<int, 2> nref;
+    std::array<const int*, 2> refs;
+    const int* ranks;
+    const long* offsets;
+    const int* holeData;
+    const int* particleData;
+    boost::interprocess::file_mapping fileMap;
+    boost::interprocess::shared_memory_object segment;
+    boost::interprocess::mapped_region region;
+
+    void setViews(const char* data, size_t size);
+};
+
+#endif
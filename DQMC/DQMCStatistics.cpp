@@ -7,6 +7,7 @@
 #include <boost/mpi.hpp>
 #endif
 #include <boost/format.hpp>
+#include <limits>
 #include "input.h"
 #include "global.h"
 #include "DQMCStatistics.h"
@@ -15,11 +16,79 @@ using namespace std;
 using namespace Eigen;
 using namespace boost;
 
+void BlockingAccumulator::add(complex<double> num, complex<double> denom)
+{
+  for (int l = 0; ; l++) {
+    if (l == nlevels()) {
+      sums.resize(sums.size() + nsums, 0.);
+      pending.resize(pending.size() + 2, 0.);
+      pendingQ.push_back(0);
+    }
+    complex<double> ene = num / denom;
+    complex<double>* s = &sums[l * nsums];
+    s[0] += 1.; 
+    s[1] += num; s[2] += denom; s[3] += ene;
+    s[4] += norm(num); s[5] += norm(denom); s[6] += norm(ene);
+    s[7] += num * denom;
+    if (pendingQ[l] == 0) {
+      pending[2 * l] = num;
+      pending[2 * l + 1] = denom;
+      pendingQ[l] = 1;
+      return;
+    }
+    // the completed pair is a sample of the next level
+    num = (pending[2 * l] + num) / 2.;
+    denom = (pending[2 * l + 1] + denom) / 2.;
+    pendingQ[l] = 0;
+  }
+}
+
+
+// variances are taken about the ratio of the means, as for the blocked energies before
+// error2 is the error of the error estimate, error / sqrt(2 (nblocks - 1))
+int BlockingAccumulator::analyze(const complex<double>* sums, int nlevels, complex<double> numMean, complex<double> denomMean, 
+                                 double& error, double& error2, complex<double>& bias)
+{
+  complex<double> ene = numMean / denomMean;
+  vector<double> errors(nlevels, 0.);
+  int optimal = -1, last = -1;
+  double n0 = nlevels > 0 ? sums[0].real() : 0.;
+  for (int l = 0; l < nlevels; l++) {
+    const complex<double>* s = sums + l * nsums;
+    double n = s[0].real();
+    if (n < 2.) break;
+    double var = (s[6].real() - 2. * real(conj(ene) * s[3]) + n * norm(ene)) / (n - 1);
+    errors[l] = sqrt(max(var, 0.) / n);
+    last = l;
+    if (optimal == -1 && (errors[0] == 0. || pow(2., 3 * l) > 2. * n0 * pow(errors[l] / errors[0], 4))) optimal = l;
+  }
+  int level = optimal == -1 ? last : optimal;
+  if (level == -1) {
+    error = std::numeric_limits<double>::infinity();
+    error2 = std::numeric_limits<double>::infinity();
+    bias = 0.;
+    return -1;
+  }
+
+  const complex<double>* s = sums + level * nsums;
+  double n = s[0].real();
+  error = errors[level];
+  error2 = error / sqrt(2. * (n - 1));
+  double numVar = (s[4].real() - 2. * real(conj(numMean) * s[1]) + n * norm(numMean)) / (n - 1);
+  double denomVar = (s[5].real() - 2. * real(conj(denomMean) * s[2]) + n * norm(denomMean)) / (n - 1);
+  complex<double> cov = (s[7] - numMean * s[2] - denomMean * s[1] + n * numMean * denomMean) / (n - 1);
+  bias = - (numMean * denomVar / pow(denomMean, 3) - cov / pow(denomMean, 2)) / n;
+  return optimal;
+}
+
+
 // constructor
 DQMCStatistics::DQMCStatistics(int pSampleSize) 
 {
   nSamples = 0;
   sampleSize = pSampleSize;
+  storeSamples = (schd.printLevel > 10);
+  blocking.resize(sampleSize);
   numMean = ArrayXcd::Zero(sampleSize);
   denomMean = ArrayXcd::Zero(sampleSize);
   denomAbsMean = ArrayXd::Zero(sampleSize);
@@ -36,13 +105,18 @@ DQMCStatistics::DQMCStatistics(int pSampleSize)
 
 
 // store samples and update running averages
+// converged sample points are not measured any more (zero samples), they are left out of the blocking
 void DQMCStatistics::addSamples(ArrayXcd& numSample, ArrayXcd& denomSample)
 {
   numMean += (numSample - numMean) / (nSamples + 1.);
   denomMean += (denomSample - denomMean) / (nSamples + 1.);
   denomAbsMean += (denomSample.abs() - denomAbsMean) / (nSamples + 1.);
-  numSamples.push_back(numSample);
-  denomSamples.push_back(denomSample);
+  for (int n = 0; n < sampleSize; n++) 
+    if (denomSample(n) != 0.) blocking[n].add(numSample(n), denomSample(n));
+  if (storeSamples) {
+    numSamples.push_back(numSample);
+    denomSamples.push_back(denomSample);
+  }
   nSamples++;
 }
 
@@ -52,81 +126,26 @@ size_t DQMCStatistics::getNumSamples()
   return nSamples;
 }
 
-// calculates error by blocking data
-// use after gathering data across processes for better estimates
-void DQMCStatistics::calcError(ArrayXd& error, ArrayXd& error2, ArrayXcd& bias)
+// calculates error by blocking data, the blocking sums of all processes are added in one reduction
+// use after gathering the running averages across processes
+void DQMCStatistics::calcError(ArrayXd& error, ArrayXd& error2, ArrayXcd& bias, ArrayXi& level)
 {
-  ArrayXcd eneEstimates = numMean / denomMean;
-  int nBlocks;
-  size_t blockSize;
-  if (nSamples <= 500) {
-    nBlocks = 1;
-    blockSize = nSamples;
-  }
-  else {
-    nBlocks = 10;
-    blockSize = size_t(nSamples / 10);
-  }
-  ArrayXd var(sampleSize), var2(sampleSize), denomVar(sampleSize), numVar(sampleSize);
-  var.setZero(); var2.setZero(); denomVar.setZero(); numVar.setZero();
-  ArrayXcd cov(sampleSize);
-  cov.setZero();
-
-  // calculate variance of blocked energies on each process
-  for (int i = 0; i < nBlocks; i++) {
-    ArrayXcd blockNum(sampleSize), blockDenom(sampleSize);
-    blockNum.setZero(); blockDenom.setZero();
-    for (int n = i * blockSize; n < (i + 1) * blockSize; n++) {
-      blockNum += numSamples[n];
-      blockDenom += denomSamples[n];
-    }
-    blockNum /= blockSize;
-    blockDenom /= blockSize;
-    ArrayXcd blockEne(sampleSize);
-    blockEne = blockNum / blockDenom;
-    var += (blockEne - eneEstimates).abs().pow(2);
-    var2 += (blockEne - eneEstimates).abs().pow(4);
-    numVar += (blockNum - numMean).abs().pow(2);
-    denomVar += (blockDenom - denomMean).abs().pow(2);
-    cov += (blockNum - numMean) * (blockDenom - denomMean);
-  }
-  
-  // gather variance across processes
-  MPI_Allreduce(MPI_IN_PLACE, var.data(), var.size(), MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
-  MPI_Allreduce(MPI_IN_PLACE, var2.data(), var2.size(), MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
-  MPI_Allreduce(MPI_IN_PLACE, numVar.data(), numVar.size(), MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
-  MPI_Allreduce(MPI_IN_PLACE, denomVar.data(), denomVar.size(), MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
-  MPI_Allreduce(MPI_IN_PLACE, cov.data(), cov.size(), MPI_DOUBLE_COMPLEX, MPI_SUM, MPI_COMM_WORLD);
-
-  int nBlockedSamples = nBlocks * commsize;
-  var /= (nBlockedSamples - 1);
-  var2 /= (nBlockedSamples);
-  numVar /= (nBlockedSamples - 1);
-  denomVar /= (nBlockedSamples - 1);
-  cov /= (nBlockedSamples - 1);
-
-  // bias
-  bias = - (numMean * denomVar / denomMean.pow(3) - cov / denomMean.pow(2)) / nBlockedSamples;
-
-  //if (commrank == 0) {
-  //  cout << "\nnumMean:  " << numMean.transpose() << endl;
-  //  cout << "numVar:  " << numVar.transpose() << endl;
-  //  cout << "denomMean:  " << denomMean.transpose() << endl;
-  //  cout << "denomVar:  " << denomVar.transpose() << endl;
-  //  cout << "cov:  " << cov.transpose() << endl;
-  //  cout << "bias (not added to the energies):  " << bias.transpose() << endl << endl;
-  //}
-
-  // calculate error estimates a la clt
-  error = sqrt(var / nBlockedSamples);
-  error2 = sqrt((var2 - (nBlockedSamples - 3) * var.pow(2) / (nBlockedSamples - 1)) / nBlockedSamples) / 2. / sqrt(var) / sqrt(sqrt(nBlockedSamples));
+  int nlevels = 0;
+  for (int n = 0; n < sampleSize; n++) nlevels = max(nlevels, blocking[n].nlevels());
+  MPI_Allreduce(MPI_IN_PLACE, &nlevels, 1, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
+  size_t stride = nlevels * BlockingAccumulator::nsums;
+  vector<complex<double>> sums(sampleSize * stride, 0.);
+  for (int n = 0; n < sampleSize; n++) 
+    std::copy(blocking[n].sums.begin(), blocking[n].sums.end(), sums.begin() + n * stride);
+  if (sums.size() > 0) MPI_Allreduce(MPI_IN_PLACE, sums.data(), sums.size(), MPI_DOUBLE_COMPLEX, MPI_SUM, MPI_COMM_WORLD);
+
+  error.resize(sampleSize); error2.resize(sampleSize); bias.resize(sampleSize); level.resize(sampleSize);
+  for (int n = 0; n < sampleSize; n++) 
+    level(n) = BlockingAccumulator::analyze(sums.data() + n * stride, nlevels, numMean(n), denomMean(n), error(n), error2(n), bias(n));
 }
- 
 
-// gather data from all the processes and print quantities
-// to be used at the end of a calculation
-// iTime used only for printing
-void DQMCStatistics::gatherAndPrintStatistics(ArrayXd iTime, complex<double> delta)
+
+void DQMCStatistics::gatherStatistics(ArrayXcd& eneEstimates, ArrayXcd& avgPhase, ArrayXd& error, ArrayXd& error2)
 {
   ArrayXcd numMeanbkp = numMean;
   ArrayXcd denomMeanbkp = denomMean;
@@ -140,35 +159,18 @@ void DQMCStatistics::gatherAndPrintStatistics(ArrayXd iTime, complex<double> del
   numMean /= commsize;
   denomMean /= commsize;
   denomAbsMean /= commsize;
-  ArrayXcd eneEstimates = numMean / denomMean;
-  ArrayXcd avgPhase = denomMean / denomAbsMean;
+  eneEstimates = numMean / denomMean;
+  avgPhase = denomMean / denomAbsMean;
 
   // calc error estimates
-  ArrayXd error, error2;
   ArrayXcd bias;
-  calcError(error, error2, bias);
-
-  eneEstimates += delta;
+  ArrayXi level;
+  calcError(error, error2, bias, level);
   //eneEstimates += bias;
 
-  // print
-  if (commrank == 0) {
-    cout << "          iTime                 Energy                     Energy error         Average phase\n";
-    for (int n = 0; n < sampleSize; n++) {
-      if (converged[n] == -1) {
-        cout << format(" %14.2f   (%14.8f, %14.8f)   (%8.2e   (%8.2e))   (%3.3f, %3.3f) \n") % iTime(n) % eneEstimates(n).real() % eneEstimates(n).imag() % error(n) % error2(n) % avgPhase(n).real() % avgPhase(n).imag(); 
-
-      }
-      else { //after it has converged just use the old ones
-        cout << format(" %14.2f   (%14.8f, %14.8f)   (%8.2e   (%8.2e))   (%3.3f, %3.3f) \n") % iTime(n) % convergedE(n).real() % convergedE(n).imag() % convergedDev(n) % convergedDev2(n) % convergedPhase(n).real() % convergedPhase(n).imag(); 
-      }
-
-    }
-  }
-
   // if error falls below the specified threshold then stop calculating it
   for (int n = 0; n < sampleSize; n++) {
-    if (error(n) < errorTargets[n]) {
+    if (converged[n] == -1 && level(n) != -1 && error(n) < errorTargets[n]) {
       converged[n] = 1;
       convergedE(n) = eneEstimates(n);
       convergedDev(n) = error(n);
@@ -176,19 +178,52 @@ void DQMCStatistics::gatherAndPrintStatistics(ArrayXd iTime, complex<double> del
       convergedPhase(n) = avgPhase(n);
     }
   }
-  
 
   //restore the original running averages
   numMean = numMeanbkp;
   denomMean = denomMeanbkp;
   denomAbsMean = denomAbsMeanbkp;  
 }
+ 
+
+// gather data from all the processes and print quantities
+// to be used at the end of a calculation
+// iTime used only for printing
+void DQMCStatistics::gatherAndPrintStatistics(ArrayXd iTime, complex<double> delta)
+{
+  ArrayXcd eneEstimates, avgPhase;
+  ArrayXd error, error2;
+  gatherStatistics(eneEstimates, avgPhase, error, error2);
+  eneEstimates += delta;
+
+  // print
+  if (commrank == 0) {
+    cout << "          iTime                 Energy                     Energy error         Average phase\n";
+    for (int n = 0; n < sampleSize; n++) {
+      if (converged[n] == -1) {
+        cout << format(" %14.2f   (%14.8f, %14.8f)   (%8.2e   (%8.2e))   (%3.3f, %3.3f) \n") % iTime(n) % eneEstimates(n).real() % eneEstimates(n).imag() % error(n) % error2(n) % avgPhase(n).real() % avgPhase(n).imag(); 
+
+      }
+      else { //after it has converged just use the old ones
+        complex<double> convergedEDelta = convergedE(n) + delta;
+        cout << format(" %14.2f   (%14.8f, %14.8f)   (%8.2e   (%8.2e))   (%3.3f, %3.3f) \n") % iTime(n) % convergedEDelta.real() % convergedEDelta.imag() % convergedDev(n) % convergedDev2(n) % convergedPhase(n).real() % convergedPhase(n).imag(); 
+      }
+
+    }
+  }
+}
 
 // if all energies are converged
 bool DQMCStatistics::isConverged() 
 {
-  if (converged[sampleSize - 1]  == 1) return true;
-  else return false;
+  if (nSamples > 0) {
+    ArrayXcd eneEstimates, avgPhase;
+    ArrayXd error, error2;
+    gatherStatistics(eneEstimates, avgPhase, error, error2);
+  }
+  for (int n = 0; n < sampleSize; n++) 
+    if (converged[n] != 1) return false;
+  return true;
 };
 
 
@@ -207,7 +242,7 @@ void DQMCStatistics::writeSamples()
   fname.append(".dat");
   ofstream samplesFile(fname, ios::app);
   samplesFile << "num_i  denom_i\n";
-  for (int i = 0; i < nSamples; i++) {
+  for (int i = 0; i < numSamples.size(); i++) {
     for (int n = 0; n < sampleSize; n++)
       samplesFile << format("  (%14.8f, %14.8f) ,  (%14.8f, %14.8f)  |") % numSamples[i](n).real() % numSamples[i](n).imag() % denomSamples[i](n).real() % denomSamples[i](n).imag();
     samplesFile << endl;
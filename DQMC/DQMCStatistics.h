@@ -3,12 +3,48 @@
 #include <utility>
 #include <vector>
 #include <fstream>
+#include <complex>
 #include <boost/serialization/serialization.hpp>
+#include <boost/serialization/vector.hpp>
+#include <boost/serialization/complex.hpp>
 #include <boost/archive/binary_iarchive.hpp>
 #include <boost/archive/binary_oarchive.hpp>
 #include <Eigen/Dense>
 
+// online flyvbjerg-petersen blocking of a ratio estimator num / denom
+// level l holds sums over the completed blocks of 2^l samples and the unpaired first half of the
+// next block, so memory is O(log n), sums of different processes can be added since their blocks
+// are independent
+class BlockingAccumulator {
+ private:
+   friend class boost::serialization::access;
+   template<class Archive> 
+     void serialize(Archive & ar, const unsigned int version) {
+       ar & sums
+          & pending
+          & pendingQ;
+     }
+
+ public:
+    // per level: number of blocks, sums of num, denom, ene = num / denom, |num|^2, |denom|^2, |ene|^2, num * denom
+    static const int nsums = 8;
+    std::vector<std::complex<double>> sums;
+    std::vector<std::complex<double>> pending;   // num and denom per level
+    std::vector<int> pendingQ;
+
+    void add(std::complex<double> num, std::complex<double> denom);
+    int nlevels() const { return pendingQ.size(); };
+
+    // error estimates from the (summed) sums of nlevels levels and the means of num and denom
+    // the block size is chosen with the criterion of lee, needs and drummond, returns its level
+    // or -1 if the data are too short for it, the largest available block is used then
+    static int analyze(const std::complex<double>* sums, int nlevels, std::complex<double> numMean, std::complex<double> denomMean, 
+                       double& error, double& error2, std::complex<double>& bias);
+};
+
+
 // holds numerator and denominator samples from direct sampling in dqmc
+// errors come from blocking accumulators, samples are only stored for writeSamples (printLevel > 10)
 class DQMCStatistics {
  private:
    friend class boost::serialization::access;
@@ -16,8 +52,10 @@ class DQMCStatistics {
      void serialize(Archive & ar, const unsigned int version) {
        ar & sampleSize
           & nSamples
+          & storeSamples
           & numSamples
           & denomSamples
+          & blocking
           & numMean
           & denomMean
           & denomAbsMean
@@ -36,13 +74,15 @@ class DQMCStatistics {
 
     int sampleSize;                                        // samples are taken at multiple points in a sweep
     size_t nSamples;                                       // number of samples
-    std::vector<Eigen::ArrayXcd> numSamples, denomSamples; // the samples
+    bool storeSamples;
+    std::vector<Eigen::ArrayXcd> numSamples, denomSamples; // the samples, if storeSamples
+    std::vector<BlockingAccumulator> blocking;             // one for each sample point
     Eigen::ArrayXcd numMean, denomMean;                    // running averages
     Eigen::ArrayXd denomAbsMean;                           // running averages
     Eigen::ArrayXcd num2Mean, denom2Mean, num_denomMean;   // running averages
     std::vector<double> errorTargets;
     std::vector<int> converged;
-    Eigen::ArrayXcd convergedE, convergedPhase;
+    Eigen::ArrayXcd convergedE, convergedPhase;            // convergedE does not include delta
     Eigen::ArrayXd convergedDev, convergedDev2;
 
     // constructor
@@ -54,16 +94,20 @@ class DQMCStatistics {
     // get the current number of samples
     size_t getNumSamples();
     
-    // calculates error by blocking data
-    // use after gathering data across processes for better estimates
-    void calcError(Eigen::ArrayXd& error, Eigen::ArrayXd& error2, Eigen::ArrayXcd& bias);
+    // calculates error by blocking data, the blocking sums are gathered across processes
+    // use after gathering the running averages across processes, level is the block size used
+    void calcError(Eigen::ArrayXd& error, Eigen::ArrayXd& error2, Eigen::ArrayXcd& bias, Eigen::ArrayXi& level);
+
+    // gathers the running averages and errors across processes without changing the local ones,
+    // and marks sample points whose error is below their target with a converged block size
+    void gatherStatistics(Eigen::ArrayXcd& eneEstimates, Eigen::ArrayXcd& avgPhase, Eigen::ArrayXd& error, Eigen::ArrayXd& error2);
     
     // gather data from all the processes and print quantities
     // iTime used only for printing
     // delta is used for energy extrapolation
     void gatherAndPrintStatistics(Eigen::ArrayXd iTime, std::complex<double> delta = std::complex<double>(0., 0.));
 
-    // if all energies are converged
+    // if all energies are converged, checked on the data of all processes so it is called by all of them
     bool isConverged();
 
     // prints running averages from proc 0
@@ -1,5 +1,6 @@
 #include <iostream>
 #include <fstream>
+#include <limits>
 #include <unsupported/Eigen/MatrixFunctions>
 #include "DQMCWalker.h"
 #include "Hamiltonian.h"
@@ -19,6 +20,21 @@ DQMCWalker::DQMCWalker(bool prhfQ, bool pphaselessQ, bool pszQ)
   orthoFac = complex<double> (1., 0.);
   normal = normal_distribution<double>(0., 1.);
   vhsTime = 0.; expTime = 0.; fbTime = 0.;
+  expCalls = 0; expTerms = 0;
+  walkerGeneratorQ = false;
+  floatQ = false;
+  orthoMethod = householder;
+  orthoAge = 0; orthoChecks = 0; orthoCalls = 0; orthoTime = 0.;
+  bpStep = -1; bpTime = 0.;
+};
+
+
+void DQMCWalker::seedGenerator(size_t seed, int rank, int index)
+{
+  std::seed_seq seq{seed, size_t(rank), size_t(index)};
+  walkerGenerator.seed(seq);
+  normal.reset();
+  walkerGeneratorQ = true;
 };
 
 
@@ -31,7 +47,9 @@ void DQMCWalker::prepProp(std::array<Eigen::MatrixXcd, 2>& ref, Hamiltonian& ham
 
 void DQMCWalker::prepPropR(std::array<Eigen::MatrixXcd, 2>& ref, Hamiltonian& ham, double pdt, double ene0)
 {
-  dt = pdt;
+  Propagator p;
+  p.dt = pdt;
+  p.ene0 = ene0;
 
   int norbs = ham.norbs;
   int nfields = ham.nchol;
@@ -68,44 +86,52 @@ void DQMCWalker::prepPropR(std::array<Eigen::MatrixXcd, 2>& ref, Hamiltonian& ha
   MatrixXcd oneBodyOperator = ham.h1Mod;
   complex<double> constant(0., 0.);
   constant += ene0 - ham.ecore;
-  for (int i = 0; i < nfields; i++) {
-    MatrixXd chol = ham.chol[i];
-    if (ham.rotFlag == true) {
-      chol = MatrixXd::Zero(norbs, norbs);
-      size_t triSize = (norbs * (norbs + 1) / 2);
-      long counter = 0;
-      for (int j = 0; j < norbs; j++) {
-        for (int k = 0; k <= j; k++) {
-          chol(j, k) = ham.floatChol[i * triSize + counter];
-          chol(k, j) = ham.floatChol[i * triSize + counter];
-          counter++;
-        }
-      }
+  if (ham.thcQ) {
+    // thc: mfShift_n = i sum_P thcU(P, n) rho(P), rho(P) = sum_pq thcOrbs_Pp thcOrbs_Pq green_pq
+    MatrixXcd greenSum = green[0] + green[1];
+    VectorXcd rho = (ham.thcOrbs * greenSum).cwiseProduct(ham.thcOrbs).rowwise().sum();
+    VectorXcd mfShiftVec = complex<double>(0., 1.) * (ham.thcU.transpose() * rho);
+    MatrixXcd op;
+    ham.thcVHS(mfShiftVec, op);
+    oneBodyOperator -= op;
+    for (int i = 0; i < nfields; i++) {
+      constant -= pow(mfShiftVec(i), 2) / 2.;
+      if (phaselessQ) p.mfShifts.push_back(mfShiftVec(i));
+      else p.mfShifts.push_back(mfShiftVec(i) /(1. * (ham.nalpha + ham.nbeta)));
     }
+  }
+  // with a rotated left state the shifts are built from the packed copy used in propagation
+  MatrixXd cholBuffer;
+  for (int i = 0; i < nfields && !ham.thcQ; i++) {
+    MatrixXd chol = ham.choleskyMatrix(i, cholBuffer, 0, ham.rotFlag);
     //MatrixXcd op = complex<double>(0., 1.) * ham.chol[i];
     MatrixXcd op = complex<double>(0., 1.) * chol;
     complex<double> mfShift = 1. * green[0].cwiseProduct(op).sum() + 1. * green[1].cwiseProduct(op).sum();
     constant -= pow(mfShift, 2) / 2.;
     oneBodyOperator -= mfShift * op;
-    if (phaselessQ) mfShifts.push_back(mfShift);
-    else mfShifts.push_back(mfShift /(1. * (ham.nalpha + ham.nbeta)));
+    if (phaselessQ) p.mfShifts.push_back(mfShift);
+    else p.mfShifts.push_back(mfShift /(1. * (ham.nalpha + ham.nbeta)));
   }
 
   if (phaselessQ) {
-    propConstant[0] = constant - ene0;
-    propConstant[1] = constant - ene0;
+    p.propConstant[0] = constant - ene0;
+    p.propConstant[1] = constant - ene0;
   }
   else {
-    propConstant[0] = constant / (1. * ham.nalpha);
-    propConstant[1] = constant / (1. * ham.nbeta);
+    p.propConstant[0] = constant / (1. * ham.nalpha);
+    p.propConstant[1] = constant / (1. * ham.nbeta);
   }
-  expOneBodyOperator =  (-dt * oneBodyOperator / 2.).exp();
+  p.expOneBodyOperator =  (-p.dt * oneBodyOperator / 2.).exp();
+  if (floatQ) p.expOneBodyOperatorF = p.expOneBodyOperator.cast<complex<float>>();
+  prop = std::make_shared<const Propagator>(std::move(p));
 };
 
 
 void DQMCWalker::prepPropU(std::array<Eigen::MatrixXcd, 2>& ref, Hamiltonian& ham, double pdt, double ene0)
 {
-  dt = pdt;
+  Propagator p;
+  p.dt = pdt;
+  p.ene0 = ene0;
 
   int norbs = ham.norbs;
   int nfields = ham.nchol;
@@ -144,25 +170,11 @@ void DQMCWalker::prepPropU(std::array<Eigen::MatrixXcd, 2>& ref, Hamiltonian& ha
   oneBodyOperator[1] = ham.h1uMod[1];
   complex<double> constant(0., 0.);
   constant += ene0 - ham.ecore;
+  MatrixXd cholBuffer;
   for (int i = 0; i < nfields; i++) {
     std::array<MatrixXd, 2> chol;
-    chol[0] = ham.cholu[i][0];
-    chol[1] = ham.cholu[i][1];
-    if (ham.rotFlag == true) {
-      size_t triSize = (norbs * (norbs + 1) / 2);
-      chol[0] = MatrixXd::Zero(norbs, norbs);
-      chol[1] = MatrixXd::Zero(norbs, norbs);
-      long counter = 0;
-      for (int j = 0; j < norbs; j++) {
-        for (int k = 0; k <= j; k++) {
-          chol[0](j, k) = ham.floatChol[i * triSize + counter];
-          chol[0](k, j) = ham.floatChol[i * triSize + counter];
-          chol[1](j, k) = ham.floatChol[nfields * triSize + i * triSize + counter];
-          chol[1](k, j) = ham.floatChol[nfields * triSize + i * triSize + counter];
-          counter++;
-        }
-      }
-    }
+    chol[0] = ham.choleskyMatrix(i, cholBuffer, 0, ham.rotFlag);
+    chol[1] = ham.choleskyMatrix(i, cholBuffer, 1, ham.rotFlag);
     std::array<MatrixXcd, 2> op;
     op[0] = complex<double>(0., 1.) * chol[0];
     op[1] = complex<double>(0., 1.) * chol[1];
@@ -170,20 +182,25 @@ void DQMCWalker::prepPropU(std::array<Eigen::MatrixXcd, 2>& ref, Hamiltonian& ha
     constant -= pow(mfShift, 2) / 2.;
     oneBodyOperator[0] -= mfShift * op[0];
     oneBodyOperator[1] -= mfShift * op[1];
-    if (phaselessQ) mfShifts.push_back(mfShift);
-    else mfShifts.push_back(mfShift /(1. * (ham.nalpha + ham.nbeta)));
+    if (phaselessQ) p.mfShifts.push_back(mfShift);
+    else p.mfShifts.push_back(mfShift /(1. * (ham.nalpha + ham.nbeta)));
   }
 
   if (phaselessQ) {
-    propConstant[0] = constant - ene0;
-    propConstant[1] = constant - ene0;
+    p.propConstant[0] = constant - ene0;
+    p.propConstant[1] = constant - ene0;
   }
   else {
-    propConstant[0] = constant / (1. * ham.nalpha);
-    propConstant[1] = constant / (1. * ham.nbeta);
+    p.propConstant[0] = constant / (1. * ham.nalpha);
+    p.propConstant[1] = constant / (1. * ham.nbeta);
   }
-  expOneBodyOperatorU[0] =  (-dt * oneBodyOperator[0] / 2.).exp();
-  expOneBodyOperatorU[1] =  (-dt * oneBodyOperator[1] / 2.).exp();
+  p.expOneBodyOperatorU[0] =  (-p.dt * oneBodyOperator[0] / 2.).exp();
+  p.expOneBodyOperatorU[1] =  (-p.dt * oneBodyOperator[1] / 2.).exp();
+  if (floatQ) {
+    p.expOneBodyOperatorUF[0] = p.expOneBodyOperatorU[0].cast<complex<float>>();
+    p.expOneBodyOperatorUF[1] = p.expOneBodyOperatorU[1].cast<complex<float>>();
+  }
+  prop = std::make_shared<const Propagator>(std::move(p));
 };
 
 
@@ -192,7 +209,9 @@ void DQMCWalker::prepPropU(std::array<Eigen::MatrixXcd, 2>& ref, Hamiltonian& ha
 // ene0 not used
 void DQMCWalker::prepProp(Eigen::MatrixXcd& ref, Hamiltonian& ham, double pdt, double ene0)
 {
-  dt = pdt;
+  Propagator p;
+  p.dt = pdt;
+  p.ene0 = ene0;
   int norbs = ham.norbs;
   int nfields = ham.nchol;
 
@@ -207,30 +226,34 @@ void DQMCWalker::prepProp(Eigen::MatrixXcd& ref, Hamiltonian& ham, double pdt, d
   if (ham.socQ) {
     oneBodyOperator = ham.h1socMod;
     constant += ene0 - ham.ecore;
+    MatrixXd cholBuffer;
     for (int i = 0; i < nfields; i++) {
-      MatrixXcd op = complex<double>(0., 1.) * ham.chol[i];
+      MatrixXcd op = complex<double>(0., 1.) * ham.choleskyMatrix(i, cholBuffer);
       complex<double> mfShift = 1. * greenTrace.cwiseProduct(op).sum();
       constant -= pow(mfShift, 2) / 2.;
       oneBodyOperator.block(0, 0, norbs, norbs) -= mfShift * op;
       oneBodyOperator.block(norbs, norbs, norbs, norbs) -= mfShift * op;
-      mfShifts.push_back(mfShift);
+      p.mfShifts.push_back(mfShift);
     }
   }
   else if (ham.intType == "g") {
     oneBodyOperator = ham.h1Mod;
     constant += ene0 - ham.ecore;
+    MatrixXd cholBuffer;
     for (int i = 0; i < nfields; i++) {
-      MatrixXcd op = complex<double>(0., 1.) * ham.chol[i];
+      MatrixXcd op = complex<double>(0., 1.) * ham.choleskyMatrix(i, cholBuffer);
       complex<double> mfShift = 1. * green.cwiseProduct(op).sum();
       constant -= pow(mfShift, 2) / 2.;
       oneBodyOperator -= mfShift * op;
-      mfShifts.push_back(mfShift);
+      p.mfShifts.push_back(mfShift);
     }
   }
   
-  propConstant[0] = constant - ene0;
-  propConstant[1] = constant - ene0;
-  expOneBodyOperator =  (-dt * oneBodyOperator / 2.).exp();
+  p.propConstant[0] = constant - ene0;
+  p.propConstant[1] = constant - ene0;
+  p.expOneBodyOperator =  (-p.dt * oneBodyOperator / 2.).exp();
+  if (floatQ) p.expOneBodyOperatorF = p.expOneBodyOperator.cast<complex<float>>();
+  prop = std::make_shared<const Propagator>(std::move(p));
 };
 
 
@@ -266,6 +289,17 @@ void DQMCWalker::setDet(std::vector<std::complex<double>>& serial, std::complex<
       for (int j = 0; j < nbeta; j++)
         det[1](i, j) = serial[nalpha * norbs + i * nbeta + j];
   }
+  if (bpFields.size() > 0) {
+    size_t offset = szQ ? detG.size() : det[0].size() + det[1].size();
+    bpStep = int(serial[offset++].real());
+    if (szQ) for (int i = 0; i < bpDetG.size(); i++) bpDetG.data()[i] = serial[offset++];
+    else {
+      for (int sz = 0; sz < 2; sz++) 
+        for (int i = 0; i < bpDet[sz].size(); i++) bpDet[sz].data()[i] = serial[offset++];
+    }
+    for (int n = 0; n < bpFields.size(); n++)
+      for (int i = 0; i < bpFields[n].size(); i++) bpFields[n](i) = complex<float>(serial[offset++]);
+  }
 };
 
 
@@ -286,25 +320,110 @@ std::complex<double> DQMCWalker::getDet(std::vector<std::complex<double>>& seria
       for (int j = 0; j < nbeta; j++)
         serial[nalpha * norbs + i * nbeta + j] = det[1](i, j);
   }
+  if (bpFields.size() > 0) {
+    size_t offset = szQ ? detG.size() : det[0].size() + det[1].size();
+    serial[offset++] = double(bpStep);
+    if (szQ) for (int i = 0; i < bpDetG.size(); i++) serial[offset++] = bpDetG.data()[i];
+    else {
+      for (int sz = 0; sz < 2; sz++) 
+        for (int i = 0; i < bpDet[sz].size(); i++) serial[offset++] = bpDet[sz].data()[i];
+    }
+    for (int n = 0; n < bpFields.size(); n++)
+      for (int i = 0; i < bpFields[n].size(); i++) serial[offset++] = complex<double>(bpFields[n](i));
+  }
   return trialOverlap;
 };
 
 
+int DQMCWalker::historySize()
+{
+  if (bpFields.size() == 0) return 0;
+  int detSize = szQ ? detG.size() : det[0].size() + det[1].size();
+  return detSize + 1 + bpFields.size() * bpFields[0].size();
+};
+
+
+void DQMCWalker::initBackProp(int window, int nfields)
+{
+  bpFields.assign(window, VectorXcf::Zero(nfields));
+  bpStep = -1;
+  bpDet = det;
+  bpDetG = detG;
+};
+
+
+void DQMCWalker::startBackProp()
+{
+  if (szQ) bpDetG = detG;
+  else bpDet = det;
+  bpStep = 0;
+};
+
+
+void DQMCWalker::setOrthoMethod(std::string method)
+{
+  if (method == "householder") orthoMethod = householder;
+  else if (method == "cholqr2") orthoMethod = cholqr2;
+  else if (method == "mgs") orthoMethod = mgs;
+  else {
+    cout << "Orthogonalization method " << method << " not supported, use householder, cholqr2 or mgs\n";
+    exit(0);
+  }
+};
+
+
+static complex<double> householderQR(MatrixXcd& det)
+{
+  complex<double> factor(1., 0.);
+  HouseholderQR<MatrixXcd> qr(det);
+  det = qr.householderQ() * MatrixXd::Identity(det.rows(), det.cols());
+  for (int i = 0; i < qr.matrixQR().diagonal().size(); i++) factor *= qr.matrixQR().diagonal()(i);
+  return factor;
+};
+
+
+// thin qr of det in place, det <- Q, returns prod_i R_ii
+// cholqr2: det <- det L^-H with L L^H = det^H det, done twice since the first pass
+//          leaves an O(cond^2 eps) loss of orthogonality, all work is in gemm and trsm
+// mgs: modified gram-schmidt, each column is projected out of the remaining block with one gemv
+static complex<double> thinQR(MatrixXcd& det, DQMCWalker::OrthoMethod method)
+{
+  if (method == DQMCWalker::householder) return householderQR(det);
+  complex<double> factor(1., 0.);
+  int ncols = det.cols();
+  if (method == DQMCWalker::cholqr2) {
+    for (int pass = 0; pass < 2; pass++) {
+      MatrixXcd gram = det.adjoint() * det;
+      LLT<MatrixXcd> llt(gram);
+      if (llt.info() != Success) return factor * householderQR(det);  // numerically rank deficient gram
+      llt.matrixU().solveInPlace<OnTheRight>(det);
+      for (int i = 0; i < ncols; i++) factor *= llt.matrixLLT()(i, i);
+    }
+  }
+  else {
+    for (int i = 0; i < ncols; i++) {
+      double norm = det.col(i).norm();
+      det.col(i) /= norm;
+      factor *= norm;
+      int nrest = ncols - i - 1;
+      if (nrest > 0) det.rightCols(nrest) -= det.col(i) * (det.col(i).adjoint() * det.rightCols(nrest));
+    }
+  }
+  return factor;
+};
+
+
 // for phaseless propagation the normalization does not matter
 // it is calculated so as to not repeat it for the overlap ratio
 void DQMCWalker::orthogonalize()
 {
-  complex<double> tempOrthoFac(1., 0.);
+  auto initTime = getTime();
   if (szQ) {
-    HouseholderQR<MatrixXcd> qr1(detG);
-    detG = qr1.householderQ() * MatrixXd::Identity(detG.rows(), detG.cols());
-    for (int i = 0; i < qr1.matrixQR().diagonal().size(); i++) tempOrthoFac *= qr1.matrixQR().diagonal()(i);
+    complex<double> tempOrthoFac = thinQR(detG, orthoMethod);
     trialOverlap /= tempOrthoFac;
   }
   else {
-    HouseholderQR<MatrixXcd> qr1(det[0]);
-    det[0] = qr1.householderQ() * MatrixXd::Identity(det[0].rows(), det[0].cols());
-    for (int i = 0; i < qr1.matrixQR().diagonal().size(); i++) tempOrthoFac *= qr1.matrixQR().diagonal()(i);
+    complex<double> tempOrthoFac = thinQR(det[0], orthoMethod);
     if (rhfQ) {
       orthoFac *= (tempOrthoFac * tempOrthoFac);
       if (phaselessQ) {
@@ -313,9 +432,7 @@ void DQMCWalker::orthogonalize()
       }
     }
     else {
-      HouseholderQR<MatrixXcd> qr2(det[1]);
-      det[1] = qr2.householderQ() * MatrixXd::Identity(det[1].rows(), det[1].cols());
-      for (int i = 0; i < qr2.matrixQR().diagonal().size(); i++) tempOrthoFac *= qr2.matrixQR().diagonal()(i);
+      tempOrthoFac *= thinQR(det[1], orthoMethod);
       orthoFac *= tempOrthoFac;
       if (phaselessQ) {
         trialOverlap /= tempOrthoFac;
@@ -323,57 +440,98 @@ void DQMCWalker::orthogonalize()
       }
     }
   }
+  orthoAge = 0;
+  orthoCalls++;
+  orthoTime += getTime() - initTime;
+};
+
+
+// max_i L_ii / min_i L_ii with L L^H = det^H det for each determinant of the walker
+// this is a lower bound on the 2-norm condition number of det that costs one
+// nelec x nelec gram matrix and its cholesky, a fraction of the cost of forming Q
+double DQMCWalker::conditionEstimate()
+{
+  auto initTime = getTime();
+  double cond = 1.;
+  int ndets = szQ ? 1 : (rhfQ ? 1 : 2);
+  for (int i = 0; i < ndets; i++) {
+    MatrixXcd& d = szQ ? detG : det[i];
+    MatrixXcd gram = d.adjoint() * d;
+    LLT<MatrixXcd> llt(gram);
+    if (llt.info() != Success) cond = std::numeric_limits<double>::infinity();
+    else {
+      VectorXd diag = llt.matrixLLT().diagonal().real();
+      cond = std::max(cond, diag.maxCoeff() / diag.minCoeff());
+    }
+  }
+  orthoChecks++;
+  orthoTime += getTime() - initTime;
+  return cond;
+};
+
+
+// condition estimates of all walkers with nonzero weights are computed first, and the
+// walkers that need it are then orthogonalized together in a second pass
+// the estimate costs a gram matrix and its cholesky, so it is only made every checkSteps steps
+void stabilizeWalkers(std::vector<DQMCWalker>& walkers, Eigen::ArrayXd& weights, double condThresh, int maxAge, int checkSteps, bool threadsQ)
+{
+  vector<char> flags(walkers.size(), 0);
+#pragma omp parallel for schedule(dynamic) if (threadsQ)
+  for (int w = 0; w < walkers.size(); w++) {
+    if (weights(w) < 1.e-8) continue;
+    walkers[w].orthoAge++;
+    if (walkers[w].orthoAge >= maxAge) flags[w] = 1;
+    else if (walkers[w].orthoAge % checkSteps == 0 && walkers[w].conditionEstimate() > condThresh) flags[w] = 1;
+  }
+  vector<int> flagged;
+  for (int w = 0; w < walkers.size(); w++) 
+    if (flags[w]) flagged.push_back(w);
+#pragma omp parallel for schedule(dynamic) if (threadsQ)
+  for (int k = 0; k < flagged.size(); k++) walkers[flagged[k]].orthogonalize();
 };
 
 
 // for free propagation only works for r integrals
 void DQMCWalker::propagate(Hamiltonian& ham)
 {
+  double dt = prop->dt;
   int norbs = det[0].rows();
   int nfields = ham.nchol; 
   //MatrixXf prop = MatrixXf::Zero(norbs, norbs);
-  vector<float> prop(norbs * (norbs + 1) / 2, 0.);
+  vector<float> propr(norbs * (norbs + 1) / 2, 0.);
   complex<double> shift(0., 0.);
   VectorXd fields(nfields);
   fields.setZero();
   size_t triSize = (norbs * (norbs + 1)) / 2;
   for (int n = 0; n < nfields; n++) {
-    double field_n = normal(generator);
+    double field_n = walkerGeneratorQ ? normal(walkerGenerator) : normal(generator);
     fields(n) = field_n;
     for (int i = 0; i < norbs; i++)
       for (int j = 0; j <= i; j++)
-        prop[i * (i + 1) / 2 + j] += float(field_n) * ham.floatChol[n * triSize + i * (i + 1) / 2 + j];
-    //prop.noalias() += float(field_n) * floatChol[i];
-    shift += field_n * mfShifts[n];
+        propr[i * (i + 1) / 2 + j] += float(field_n) * (ham.packedChol != nullptr ? float(ham.packedChol[n * triSize + i * (i + 1) / 2 + j]) : ham.floatChol[n * triSize + i * (i + 1) / 2 + j]);
+    //propr.noalias() += float(field_n) * floatChol[i];
+    shift += field_n * prop->mfShifts[n];
   }
   //MatrixXcd propc = sqrt(dt) * complex<double>(0, 1.) * prop.cast<double>();
   MatrixXcd propc = MatrixXcd::Zero(norbs, norbs);
   for (int i = 0; i < norbs; i++) {
-    propc(i, i) = sqrt(dt) * static_cast<complex<double>>(complex<float>(0, 1.) * prop[i * (i + 1) / 2 + i]);
+    propc(i, i) = sqrt(dt) * static_cast<complex<double>>(complex<float>(0, 1.) * propr[i * (i + 1) / 2 + i]);
     for (int j = 0; j < i; j++) {
-      propc(i, j) = sqrt(dt) * static_cast<complex<double>>(complex<float>(0, 1.) * prop[i * (i + 1) / 2 + j]);
-      propc(j, i) = sqrt(dt) * static_cast<complex<double>>(complex<float>(0, 1.) * prop[i * (i + 1) / 2 + j]);
+      propc(i, j) = sqrt(dt) * static_cast<complex<double>>(complex<float>(0, 1.) * propr[i * (i + 1) / 2 + j]);
+      propc(j, i) = sqrt(dt) * static_cast<complex<double>>(complex<float>(0, 1.) * propr[i * (i + 1) / 2 + j]);
     }
   }
   
-  det[0] = expOneBodyOperator * det[0];
-  MatrixXcd temp = det[0];
-  for (int i = 1; i < 10; i++) {
-    temp = propc * temp / i;
-    det[0] += temp;
-  }
-  det[0] = exp(-sqrt(dt) * shift) * exp(propConstant[0] * dt / 2.) * expOneBodyOperator * det[0];
+  det[0] = prop->expOneBodyOperator * det[0];
+  applyExp(propc, det[0], 9);
+  det[0] = exp(-sqrt(dt) * shift) * exp(prop->propConstant[0] * dt / 2.) * prop->expOneBodyOperator * det[0];
 
 
   if (rhfQ) det[1] = det[0];
   else {
-    det[1] = expOneBodyOperator * det[1];
-    temp = det[1];
-    for (int i = 1; i < 10; i++) {
-      temp = propc * temp / i;
-      det[1] += temp;
-    }
-    det[1] = exp(-sqrt(dt) * shift) * exp(propConstant[1] * dt / 2.) * expOneBodyOperator * det[1];
+    det[1] = prop->expOneBodyOperator * det[1];
+    applyExp(propc, det[1], 9);
+    det[1] = exp(-sqrt(dt) * shift) * exp(prop->propConstant[1] * dt / 2.) * prop->expOneBodyOperator * det[1];
   }
 };
 
@@ -403,34 +561,120 @@ void VHS(VectorXcf& fields, float* floatChol, MatrixXcd& propc)
   }
 }
 
-void VHS(VectorXcf& fields, Eigen::Map<Eigen::MatrixXf> floatCholMat, MatrixXcd& propc) 
+// MatrixType is MatrixXcd, or MatrixXcf for single precision propagation
+// CholType is the packed float copy, or the packed double copy for cholStorage double
+template <typename CholType, typename MatrixType> void VHS(VectorXcf& fields, CholType& cholMat, MatrixType& propc) 
 {
+  typedef typename MatrixType::Scalar Scalar;
+  typedef typename CholType::Scalar CholScalar;
   int norbs = propc.rows();
-  int nfields = fields.size();
-  size_t triSize = (norbs * (norbs + 1)) / 2;
-  VectorXf propr = floatCholMat * fields.real();
-  VectorXf propi = floatCholMat * fields.imag();
+  Matrix<CholScalar, Dynamic, 1> propr = cholMat * fields.real().template cast<CholScalar>();
+  Matrix<CholScalar, Dynamic, 1> propi = cholMat * fields.imag().template cast<CholScalar>();
   
   for (int i = 0; i < norbs; i++) {
-    propc(i, i) = static_cast<complex<double>>(complex<float>(0., 1.) * propr[i * (i + 1) / 2 + i] - propi[i * (i + 1) / 2 + i]);
+    propc(i, i) = static_cast<Scalar>(complex<CholScalar>(0., 1.) * propr[i * (i + 1) / 2 + i] - propi[i * (i + 1) / 2 + i]);
     for (int j = 0; j < i; j++) {
-      propc(i, j) = static_cast<complex<double>>(complex<float>(0., 1.) * propr[i * (i + 1) / 2 + j] - propi[i * (i + 1) / 2 + j]);
-      propc(j, i) = static_cast<complex<double>>(complex<float>(0., 1.) * propr[i * (i + 1) / 2 + j] - propi[i * (i + 1) / 2 + j]);
+      propc(i, j) = static_cast<Scalar>(complex<CholScalar>(0., 1.) * propr[i * (i + 1) / 2 + j] - propi[i * (i + 1) / 2 + j]);
+      propc(j, i) = static_cast<Scalar>(complex<CholScalar>(0., 1.) * propr[i * (i + 1) / 2 + j] - propi[i * (i + 1) / 2 + j]);
     }
   }
 }
 
 
-void applyExp(MatrixXcd& propc, MatrixXcd& det) 
+// vhs of spin sz from whichever packed copy the hamiltonian stores
+template <typename MatrixType> void VHS(VectorXcf& fields, Hamiltonian& ham, int sz, MatrixType& propc) 
+{
+  if (ham.packedChol != nullptr) VHS(fields, ham.packedCholMat[sz], propc);
+  else VHS(fields, ham.floatCholMat[sz], propc);
+}
+
+
+// batched vhs for several walkers: fields is nfields x nwalk
+// a single gemm over all walkers instead of one gemv per walker
+template <typename CholType> void VHSBatch(MatrixXcf& fields, CholType& cholMat, vector<MatrixXcd>& propc) 
 {
-  MatrixXcd temp = det;
-  for (int i = 1; i < 6; i++) {
-    temp = propc * temp / i;
-    det += temp;
+  typedef typename CholType::Scalar CholScalar;
+  int norbs = propc[0].rows();
+  Matrix<CholScalar, Dynamic, Dynamic> fieldsr = fields.real().template cast<CholScalar>();
+  Matrix<CholScalar, Dynamic, Dynamic> fieldsi = fields.imag().template cast<CholScalar>();
+  Matrix<CholScalar, Dynamic, Dynamic> propr = cholMat * fieldsr;
+  Matrix<CholScalar, Dynamic, Dynamic> propi = cholMat * fieldsi;
+  
+  for (int w = 0; w < propc.size(); w++) {
+    for (int i = 0; i < norbs; i++) {
+      propc[w](i, i) = static_cast<complex<double>>(complex<CholScalar>(0., 1.) * propr(i * (i + 1) / 2 + i, w) - propi(i * (i + 1) / 2 + i, w));
+      for (int j = 0; j < i; j++) {
+        propc[w](i, j) = static_cast<complex<double>>(complex<CholScalar>(0., 1.) * propr(i * (i + 1) / 2 + j, w) - propi(i * (i + 1) / 2 + j, w));
+        propc[w](j, i) = static_cast<complex<double>>(complex<CholScalar>(0., 1.) * propr(i * (i + 1) / 2 + j, w) - propi(i * (i + 1) / 2 + j, w));
+      }
+    }
   }
 }
 
 
+void VHSBatch(MatrixXcf& fields, Hamiltonian& ham, int sz, vector<MatrixXcd>& propc) 
+{
+  if (ham.packedChol != nullptr) VHSBatch(fields, ham.packedCholMat[sz], propc);
+  else VHSBatch(fields, ham.floatCholMat[sz], propc);
+}
+
+
+void DQMCWalker::applyExp(const MatrixXcd& propc, Eigen::Ref<MatrixXcd> det, int defaultOrder) 
+{
+  expTerms += expProp.apply(propc, det, defaultOrder);
+  expCalls++;
+}
+
+
+void DQMCWalker::applyExp(const MatrixXcf& propc, Eigen::Ref<MatrixXcf> det, int defaultOrder) 
+{
+  expTerms += expProp.apply(propc, det, defaultOrder);
+  expCalls++;
+}
+
+
+// one step of the walker propagator in single precision: one body, two body, one body
+// the walker is stored in double precision between steps
+void DQMCWalker::applyPropFloat(const MatrixXcf& expOneBody, MatrixXcf& propc, MatrixXcd& det) 
+{
+  MatrixXcf detF = expOneBody * det.cast<complex<float>>();
+  applyExp(propc, detF);
+  det = (expOneBody * detF).cast<complex<double>>();
+}
+
+
+// samples auxiliary fields shifted by the force bias
+// shift and fbTerm are accumulated for the phaseless importance function
+void DQMCWalker::sampleFields(Eigen::VectorXcd& fb, Eigen::VectorXcf& fields, std::complex<double>& shift, std::complex<double>& fbTerm)
+{
+  double dt = prop->dt;
+  int nfields = fields.size();
+  for (int n = 0; n < nfields; n++) {
+    double field_n;
+    if (noise.size() > 0) field_n = noise(n);
+    else field_n = walkerGeneratorQ ? normal(walkerGenerator) : normal(generator);
+    complex<double> fieldShift = -sqrt(dt) * (complex<double>(0., 1.) * fb(n) - prop->mfShifts[n]);
+    fields(n) = complex<float>(field_n - fieldShift);
+    shift += (field_n - fieldShift) * prop->mfShifts[n];
+    fbTerm += (field_n * fieldShift - fieldShift * fieldShift / 2.);
+  }
+  if (bpStep >= 0 && bpStep < bpFields.size()) bpFields[bpStep++] = fields;
+};
+
+
+// updates trialOverlap and returns the phaseless importance function for the last step
+double DQMCWalker::phaselessRatio(std::complex<double> oldOverlap, std::complex<double> newOverlap, std::complex<double> shift, std::complex<double> fbTerm, double eshift)
+{
+  double dt = prop->dt;
+  trialOverlap = newOverlap;
+  complex<double> importanceFunction = exp(-sqrt(dt) * shift + fbTerm + dt * (eshift + prop->propConstant[0])) * newOverlap / oldOverlap;
+  double theta = std::arg( exp(-sqrt(dt) * shift) * newOverlap / oldOverlap );
+  double importanceFunctionPhaseless = std::abs(importanceFunction) * cos(theta);
+  if (importanceFunctionPhaseless < 1.e-3 || importanceFunctionPhaseless > 100. || std::isnan(importanceFunctionPhaseless)) importanceFunctionPhaseless = 0.; 
+  return importanceFunctionPhaseless;
+};
+
+
 double DQMCWalker::propagatePhaseless(Wavefunction& wave, Hamiltonian& ham, double eshift)
 {
   if (ham.intType == "r" || ham.intType == "g") return propagatePhaselessRG(wave, ham, eshift);
@@ -440,6 +684,7 @@ double DQMCWalker::propagatePhaseless(Wavefunction& wave, Hamiltonian& ham, doub
 
 double DQMCWalker::propagatePhaselessRG(Wavefunction& wave, Hamiltonian& ham, double eshift)
 {
+  double dt = prop->dt;
   int norbs = ham.norbs;
   int nelec = ham.nelec;
   int nfields = ham.nchol; 
@@ -448,63 +693,67 @@ double DQMCWalker::propagatePhaselessRG(Wavefunction& wave, Hamiltonian& ham, do
   complex<double> shift(0., 0.), fbTerm(0., 0.);
   VectorXcf fields(nfields); fields.setZero();
   auto initTime = getTime();
-  for (int n = 0; n < nfields; n++) {
-    double field_n = normal(generator);
-    complex<double> fieldShift = -sqrt(dt) * (complex<double>(0., 1.) * fb(n) - mfShifts[n]);
-    fields(n) = complex<float>(field_n - fieldShift);
-    shift += (field_n - fieldShift) * mfShifts[n];
-    fbTerm += (field_n * fieldShift - fieldShift * fieldShift / 2.);
+  sampleFields(fb, fields, shift, fbTerm);
+
+  if (floatQ && !ham.socQ && !ham.thcQ) {
+    MatrixXcf propc = MatrixXcf::Zero(norbs, norbs);
+    VHS(fields, ham, 0, propc);
+    propc *= float(sqrt(dt));
+    vhsTime += getTime() - initTime;
+
+    initTime = getTime();
+    if (szQ) applyPropFloat(prop->expOneBodyOperatorF, propc, detG);
+    else {
+      applyPropFloat(prop->expOneBodyOperatorF, propc, det[0]);
+      if (rhfQ) det[1] = det[0];
+      else applyPropFloat(prop->expOneBodyOperatorF, propc, det[1]);
+    }
+    expTime += getTime() - initTime;
+    complex<double> oldOverlap = trialOverlap;
+    return phaselessRatio(oldOverlap, this->overlap(wave), shift, fbTerm, eshift);
   }
 
   MatrixXcd propc = MatrixXcd::Zero(norbs, norbs);
   //VHS(fields, ham.floatChol, propc);
-  VHS(fields, ham.floatCholMat[0], propc);
+  if (ham.thcQ) ham.thcVHS(fields.cast<complex<double>>(), propc);
+  else VHS(fields, ham, 0, propc);
   propc *= sqrt(dt);
   vhsTime += getTime() - initTime;
 
   initTime = getTime();
   if (szQ && ham.socQ) {
-    detG = expOneBodyOperator * detG;
-    MatrixXcd temp = detG;
-    for (int i = 1; i < 6; i++) {
-      temp.block(0, 0, norbs, nelec)  = propc * temp.block(0, 0, norbs, nelec) / i;
-      temp.block(norbs, 0, norbs, nelec)  = propc * temp.block(norbs, 0, norbs, nelec) / i;
-      detG += temp;
-    }
-    detG = expOneBodyOperator * detG;
+    detG = prop->expOneBodyOperator * detG;
+    applyExp(propc, detG.topRows(norbs));
+    applyExp(propc, detG.bottomRows(norbs));
+    detG = prop->expOneBodyOperator * detG;
   }
   else if (szQ) {
-    detG = expOneBodyOperator * detG;
+    detG = prop->expOneBodyOperator * detG;
     applyExp(propc, detG);
-    detG = expOneBodyOperator * detG;
+    detG = prop->expOneBodyOperator * detG;
   }
   else {
-    det[0] = expOneBodyOperator * det[0];
+    det[0] = prop->expOneBodyOperator * det[0];
     applyExp(propc, det[0]);
-    det[0] = expOneBodyOperator * det[0];
+    det[0] = prop->expOneBodyOperator * det[0];
 
     if (rhfQ) det[1] = det[0];
     else {
-      det[1] = expOneBodyOperator * det[1];
+      det[1] = prop->expOneBodyOperator * det[1];
       applyExp(propc, det[1]);
-      det[1] = expOneBodyOperator * det[1];
+      det[1] = prop->expOneBodyOperator * det[1];
     }
   }
   expTime += getTime() - initTime;
 
-  // phaseless
   complex<double> oldOverlap = trialOverlap;
-  complex<double> newOverlap = this->overlap(wave);
-  complex<double> importanceFunction = exp(-sqrt(dt) * shift + fbTerm + dt * (eshift + propConstant[0])) * newOverlap / oldOverlap;
-  double theta = std::arg( exp(-sqrt(dt) * shift) * newOverlap / oldOverlap );
-  double importanceFunctionPhaseless = std::abs(importanceFunction) * cos(theta);
-  if (importanceFunctionPhaseless < 1.e-3 || importanceFunctionPhaseless > 100. || std::isnan(importanceFunctionPhaseless)) importanceFunctionPhaseless = 0.; 
-  return importanceFunctionPhaseless;
+  return phaselessRatio(oldOverlap, this->overlap(wave), shift, fbTerm, eshift);
 };
 
 
 double DQMCWalker::propagatePhaselessU(Wavefunction& wave, Hamiltonian& ham, double eshift)
 {
+  double dt = prop->dt;
   int norbs = ham.norbs;
   int nelec = ham.nelec;
   int nfields = ham.nchol; 
@@ -515,42 +764,184 @@ double DQMCWalker::propagatePhaselessU(Wavefunction& wave, Hamiltonian& ham, dou
   complex<double> shift(0., 0.), fbTerm(0., 0.);
   VectorXcf fields(nfields); fields.setZero();
   auto initTime = getTime();
-  for (int n = 0; n < nfields; n++) {
-    double field_n = normal(generator);
-    complex<double> fieldShift = -sqrt(dt) * (complex<double>(0., 1.) * fb(n) - mfShifts[n]);
-    fields(n) = complex<float>(field_n - fieldShift);
-    shift += (field_n - fieldShift) * mfShifts[n];
-    fbTerm += (field_n * fieldShift - fieldShift * fieldShift / 2.);
+  sampleFields(fb, fields, shift, fbTerm);
+
+  if (floatQ) {
+    MatrixXcf propUpc = MatrixXcf::Zero(norbs, norbs);
+    MatrixXcf propDnc = MatrixXcf::Zero(norbs, norbs);
+    VHS(fields, ham, 0, propUpc);
+    VHS(fields, ham, 1, propDnc);
+    propUpc *= float(sqrt(dt));
+    propDnc *= float(sqrt(dt));
+    vhsTime += getTime() - initTime;
+
+    initTime = getTime();
+    applyPropFloat(prop->expOneBodyOperatorUF[0], propUpc, det[0]);
+    applyPropFloat(prop->expOneBodyOperatorUF[1], propDnc, det[1]);
+    expTime += getTime() - initTime;
+    complex<double> oldOverlap = trialOverlap;
+    return phaselessRatio(oldOverlap, this->overlap(wave), shift, fbTerm, eshift);
   }
 
   MatrixXcd propUpc = MatrixXcd::Zero(norbs, norbs);
   MatrixXcd propDnc = MatrixXcd::Zero(norbs, norbs);
   //VHS(fields, ham.floatChol, propUpc);
   //VHS(fields, ham.floatChol + nfields * (norbs * (norbs+1)) / 2, propDnc);
-  VHS(fields, ham.floatCholMat[0], propUpc);
-  VHS(fields, ham.floatCholMat[1], propDnc);
+  VHS(fields, ham, 0, propUpc);
+  VHS(fields, ham, 1, propDnc);
   propUpc *= sqrt(dt);
   propDnc *= sqrt(dt);
   vhsTime += getTime() - initTime;
 
   initTime = getTime();
-  det[0] = expOneBodyOperatorU[0] * det[0];
+  det[0] = prop->expOneBodyOperatorU[0] * det[0];
   applyExp(propUpc, det[0]);
-  det[0] = expOneBodyOperatorU[0] * det[0];
+  det[0] = prop->expOneBodyOperatorU[0] * det[0];
 
-  det[1] = expOneBodyOperatorU[1] * det[1];
+  det[1] = prop->expOneBodyOperatorU[1] * det[1];
   applyExp(propDnc, det[1]);
-  det[1] = expOneBodyOperatorU[1] * det[1];
+  det[1] = prop->expOneBodyOperatorU[1] * det[1];
   expTime += getTime() - initTime;
 
-  // phaseless
   complex<double> oldOverlap = trialOverlap;
-  complex<double> newOverlap = this->overlap(wave);
-  complex<double> importanceFunction = exp(-sqrt(dt) * shift + fbTerm + dt * (eshift + propConstant[0])) * newOverlap / oldOverlap;
-  double theta = std::arg( exp(-sqrt(dt) * shift) * newOverlap / oldOverlap );
-  double importanceFunctionPhaseless = std::abs(importanceFunction) * cos(theta);
-  if (importanceFunctionPhaseless < 1.e-3 || importanceFunctionPhaseless > 100. || std::isnan(importanceFunctionPhaseless)) importanceFunctionPhaseless = 0.; 
-  return importanceFunctionPhaseless;
+  return phaselessRatio(oldOverlap, this->overlap(wave), shift, fbTerm, eshift);
+};
+
+
+// force bias of the walkers in active using the batched trial interface, fb is nactive x nfields
+static void forceBiasBatch(std::vector<DQMCWalker>& walkers, std::vector<int>& active, Wavefunction& wave, Hamiltonian& ham, MatrixXcd& fb)
+{
+  DQMCWalker& first = walkers[active[0]];
+  if (first.szQ || first.rhfQ) {
+    vector<MatrixXcd*> dets;
+    for (int k = 0; k < active.size(); k++) dets.push_back(first.szQ ? &walkers[active[k]].detG : &walkers[active[k]].det[0]);
+    wave.forceBiasBatch(dets, ham, fb);
+  }
+  else {
+    vector<std::array<MatrixXcd, 2>*> dets;
+    for (int k = 0; k < active.size(); k++) dets.push_back(&walkers[active[k]].det);
+    wave.forceBiasBatch(dets, ham, fb);
+  }
+};
+
+
+// trial overlaps of the walkers in active using the batched trial interface
+static void overlapBatch(std::vector<DQMCWalker>& walkers, std::vector<int>& active, Wavefunction& wave, VectorXcd& overlaps)
+{
+  DQMCWalker& first = walkers[active[0]];
+  if (first.szQ || first.rhfQ) {
+    vector<MatrixXcd*> dets;
+    for (int k = 0; k < active.size(); k++) dets.push_back(first.szQ ? &walkers[active[k]].detG : &walkers[active[k]].det[0]);
+    wave.overlapBatch(dets, overlaps);
+  }
+  else {
+    vector<std::array<MatrixXcd, 2>*> dets;
+    for (int k = 0; k < active.size(); k++) dets.push_back(&walkers[active[k]].det);
+    wave.overlapBatch(dets, overlaps);
+  }
+};
+
+
+// propagates all walkers with nonzero weights on this process together
+// force bias and overlaps use the batched trial interface
+// walker determinants are stacked into one norbs x (nwalk * nocc) block so that each
+// one-body half step is a single gemm, and the vhs of all walkers is built with one gemm
+// random fields are drawn walker by walker in the same order as in propagatePhaseless
+void propagatePhaselessBatch(std::vector<DQMCWalker>& walkers, Eigen::ArrayXd& weights, Wavefunction& wave, Hamiltonian& ham, double eshift)
+{
+  vector<int> active;
+  for (int w = 0; w < walkers.size(); w++) 
+    if (weights(w) > 1.e-8) active.push_back(w);
+  int nactive = active.size();
+  if (nactive == 0) return;
+
+  // batch timings are charged to the first walker, the driver only uses their sum
+  DQMCWalker& first = walkers[0];
+  int norbs = ham.norbs;
+  int nfields = ham.nchol;
+  double dt = first.prop->dt;
+  bool uQ = (ham.intType == "u");
+  bool socQ = first.szQ && ham.socQ;
+
+  // force bias and fields
+  auto initTime = getTime();
+  MatrixXcd fbBatch;
+  forceBiasBatch(walkers, active, wave, ham, fbBatch);
+  first.fbTime += getTime() - initTime;
+
+  initTime = getTime();
+  MatrixXcf fields = MatrixXcf::Zero(nfields, nactive);
+  vector<complex<double>> shifts(nactive, complex<double>(0., 0.)), fbTerms(nactive, complex<double>(0., 0.));
+  for (int k = 0; k < nactive; k++) {
+    VectorXcd fb = fbBatch.row(k).transpose();
+    VectorXcf fieldsk(nfields); fieldsk.setZero();
+    walkers[active[k]].sampleFields(fb, fieldsk, shifts[k], fbTerms[k]);
+    fields.col(k) = fieldsk;
+  }
+
+  vector<MatrixXcd> propc(nactive, MatrixXcd::Zero(norbs, norbs)), propcDn;
+  if (ham.thcQ) {
+    for (int k = 0; k < nactive; k++) ham.thcVHS(fields.col(k).cast<complex<double>>(), propc[k]);
+  }
+  else VHSBatch(fields, ham, 0, propc);
+  if (uQ) {
+    propcDn = vector<MatrixXcd>(nactive, MatrixXcd::Zero(norbs, norbs));
+    VHSBatch(fields, ham, 1, propcDn);
+  }
+  for (int k = 0; k < nactive; k++) {
+    propc[k] *= sqrt(dt);
+    if (uQ) propcDn[k] *= sqrt(dt);
+  }
+  first.vhsTime += getTime() - initTime;
+
+  // stack determinants, spin sectors with different one-body operators go in separate stacks
+  initTime = getTime();
+  int nstacks = uQ ? 2 : 1;
+  for (int sz = 0; sz < nstacks; sz++) {
+    vector<MatrixXcd*> dets;
+    vector<MatrixXcd*> props;
+    for (int k = 0; k < nactive; k++) {
+      DQMCWalker& walker = walkers[active[k]];
+      if (uQ) {
+        dets.push_back(&walker.det[sz]); props.push_back(sz == 0 ? &propc[k] : &propcDn[k]);
+      }
+      else if (walker.szQ) {
+        dets.push_back(&walker.detG); props.push_back(&propc[k]);
+      }
+      else {
+        dets.push_back(&walker.det[0]); props.push_back(&propc[k]);
+        if (!walker.rhfQ) { dets.push_back(&walker.det[1]); props.push_back(&propc[k]); }
+      }
+    }
+    int nrows = dets[0]->rows(), ncols = 0;
+    for (int i = 0; i < dets.size(); i++) ncols += dets[i]->cols();
+    MatrixXcd stacked(nrows, ncols);
+    for (int i = 0, col = 0; i < dets.size(); col += dets[i]->cols(), i++) stacked.middleCols(col, dets[i]->cols()) = *dets[i];
+
+    const MatrixXcd& expOneBody = uQ ? first.prop->expOneBodyOperatorU[sz] : first.prop->expOneBodyOperator;
+    stacked = expOneBody * stacked;
+    for (int i = 0, col = 0; i < dets.size(); col += dets[i]->cols(), i++) {
+      int nelec = dets[i]->cols();
+      if (socQ) {
+        first.applyExp(*props[i], stacked.block(0, col, norbs, nelec));
+        first.applyExp(*props[i], stacked.block(norbs, col, norbs, nelec));
+      }
+      else first.applyExp(*props[i], stacked.middleCols(col, nelec));
+    }
+    stacked = expOneBody * stacked;
+    for (int i = 0, col = 0; i < dets.size(); col += dets[i]->cols(), i++) *dets[i] = stacked.middleCols(col, dets[i]->cols());
+  }
+  for (int k = 0; k < nactive; k++) {
+    DQMCWalker& walker = walkers[active[k]];
+    if (!walker.szQ && !uQ && walker.rhfQ) walker.det[1] = walker.det[0];
+  }
+  first.expTime += getTime() - initTime;
+
+  // phaseless
+  VectorXcd overlaps;
+  overlapBatch(walkers, active, wave, overlaps);
+  for (int k = 0; k < nactive; k++) 
+    weights(active[k]) *= walkers[active[k]].phaselessRatio(walkers[active[k]].trialOverlap, overlaps(k), shifts[k], fbTerms[k], eshift);
 };
 
 
@@ -589,6 +980,64 @@ void DQMCWalker::oneRDM(Wavefunction& wave, std::array<Eigen::MatrixXcd, 2>& rdm
 };
 
 
+// <ref| B(x_n) ... B(x_1) is (B(x_1)^H ... B(x_n)^H |ref>)^H, so the reference is propagated with the adjoint
+// one and two body pieces applied for the recorded fields in reverse order, constant factors cancel in the rdm
+// the left state is orthogonalized every orthoSteps steps, this does not change the rdm either
+void DQMCWalker::backPropOneRDM(std::array<Eigen::MatrixXcd, 2>& ref, Hamiltonian& ham, int orthoSteps, std::array<Eigen::MatrixXcd, 2>& rdmSample)
+{
+  auto initTime = getTime();
+  double dt = prop->dt;
+  int norbs = ham.norbs;
+  bool uQ = (ham.intType == "u");
+  int nsz = rhfQ ? 1 : 2;
+  matPair left = ref;
+  MatrixXcd propc = MatrixXcd::Zero(norbs, norbs), propcH;
+  for (int n = bpStep - 1; n >= 0; n--) {
+    for (int sz = 0; sz < nsz; sz++) {
+      if (sz == 0 || uQ) {
+        if (ham.thcQ) ham.thcVHS(bpFields[n].cast<complex<double>>(), propc);
+        else VHS(bpFields[n], ham, sz, propc);
+        propcH = sqrt(dt) * propc.adjoint();
+      }
+      const MatrixXcd& expOneBody = uQ ? prop->expOneBodyOperatorU[sz] : prop->expOneBodyOperator;
+      left[sz] = expOneBody.adjoint() * left[sz];
+      expProp.apply(propcH, left[sz]);
+      left[sz] = expOneBody.adjoint() * left[sz];
+      if ((bpStep - n) % orthoSteps == 0) householderQR(left[sz]);
+    }
+  }
+  for (int sz = 0; sz < nsz; sz++) 
+    rdmSample[sz] = (bpDet[sz] * (left[sz].adjoint() * bpDet[sz]).inverse() * left[sz].adjoint()).transpose();
+  if (rhfQ) rdmSample[1] = rdmSample[0];
+  bpTime += getTime() - initTime;
+};
+
+
+void DQMCWalker::backPropOneRDM(Eigen::MatrixXcd& ref, Hamiltonian& ham, int orthoSteps, Eigen::MatrixXcd& rdmSample)
+{
+  auto initTime = getTime();
+  double dt = prop->dt;
+  int norbs = ham.norbs;
+  MatrixXcd left = ref;
+  MatrixXcd propc = MatrixXcd::Zero(norbs, norbs), propcH;
+  for (int n = bpStep - 1; n >= 0; n--) {
+    if (ham.thcQ) ham.thcVHS(bpFields[n].cast<complex<double>>(), propc);
+    else VHS(bpFields[n], ham, 0, propc);
+    propcH = sqrt(dt) * propc.adjoint();
+    left = prop->expOneBodyOperator.adjoint() * left;
+    if (ham.socQ) {
+      expProp.apply(propcH, left.topRows(norbs));
+      expProp.apply(propcH, left.bottomRows(norbs));
+    }
+    else expProp.apply(propcH, left);
+    left = prop->expOneBodyOperator.adjoint() * left;
+    if ((bpStep - n) % orthoSteps == 0) householderQR(left);
+  }
+  rdmSample = (bpDetG * (left.adjoint() * bpDetG).inverse() * left.adjoint()).transpose();
+  bpTime += getTime() - initTime;
+};
+
+
 std::array<std::complex<double>, 2> DQMCWalker::hamAndOverlap(Wavefunction& wave, Hamiltonian& ham)
 {
 
@@ -601,3 +1050,31 @@ std::array<std::complex<double>, 2> DQMCWalker::hamAndOverlap(Wavefunction& wave
 };
 
 
+// local energies of all walkers with nonzero weights using the batched trial interface
+// hamOverlaps of walkers with zero weights are set to zero
+void hamAndOverlapBatch(std::vector<DQMCWalker>& walkers, Eigen::ArrayXd& weights, Wavefunction& wave, Hamiltonian& ham, std::vector<std::array<std::complex<double>, 2>>& hamOverlaps)
+{
+  hamOverlaps.assign(walkers.size(), std::array<complex<double>, 2>{0., 0.});
+  vector<int> active;
+  for (int w = 0; w < walkers.size(); w++) 
+    if (weights(w) != 0.) active.push_back(w);
+  if (active.size() == 0) return;
+
+  DQMCWalker& first = walkers[active[0]];
+  std::vector<std::array<complex<double>, 2>> activeHamOverlaps;
+  if (first.szQ || first.rhfQ) {
+    vector<MatrixXcd*> dets;
+    for (int k = 0; k < active.size(); k++) dets.push_back(first.szQ ? &walkers[active[k]].detG : &walkers[active[k]].det[0]);
+    wave.hamAndOverlapBatch(dets, ham, activeHamOverlaps);
+  }
+  else {
+    vector<std::array<MatrixXcd, 2>*> dets;
+    for (int k = 0; k < active.size(); k++) dets.push_back(&walkers[active[k]].det);
+    wave.hamAndOverlapBatch(dets, ham, activeHamOverlaps);
+  }
+  for (int k = 0; k < active.size(); k++) {
+    hamOverlaps[active[k]][0] = activeHamOverlaps[k][0] * walkers[active[k]].orthoFac;
+    hamOverlaps[active[k]][1] = activeHamOverlaps[k][1] * walkers[active[k]].orthoFac;
+  }
+};
+
@@ -1,22 +1,50 @@
 #ifndef DQMCWalker_HEADER_H
 #define DQMCWalker_HEADER_H
 #include <random>
+#include <memory>
 #include "Hamiltonian.h"
 #include "Wavefunction.h"
+#include "PropagatorExp.h"
+
+// one and two body propagator pieces that do not depend on the walker
+// built once by prepProp and shared (read only) by all copies of a walker
+struct Propagator {
+  std::vector<std::complex<double>> mfShifts;
+  std::array<std::complex<double>, 2> propConstant;
+  Eigen::MatrixXcd expOneBodyOperator;
+  std::array<Eigen::MatrixXcd, 2> expOneBodyOperatorU;
+  Eigen::MatrixXcf expOneBodyOperatorF;          // single precision copies used if floatQ
+  std::array<Eigen::MatrixXcf, 2> expOneBodyOperatorUF;
+  double dt, ene0;
+};
 
 class DQMCWalker {
   public:
     std::array<Eigen::MatrixXcd, 2> det;
     Eigen::MatrixXcd detG;
     std::complex<double> orthoFac, trialOverlap;
-    std::vector<std::complex<double>> mfShifts;
-    std::array<std::complex<double>, 2> propConstant;
-    Eigen::MatrixXcd expOneBodyOperator;
-    std::array<Eigen::MatrixXcd, 2> expOneBodyOperatorU;
+    std::shared_ptr<const Propagator> prop;  // copying a walker only copies the pointer
     bool rhfQ, szQ, phaselessQ;  // come up with a better name for szQ (szQ == false for ghf dets)
-    double dt, ene0;
     std::normal_distribution<double> normal;
+    std::mt19937 walkerGenerator;   // own random stream, used instead of the global generator if walkerGeneratorQ
+    bool walkerGeneratorQ;
+    Eigen::VectorXd noise;          // if set, normal draws used for the fields instead of the generators (correlated sampling)
+    bool floatQ;                    // propagate in single precision, set before prepProp
+    PropagatorExp expProp;          // how exp(VHS) is applied, set before prepProp
     double vhsTime, expTime, fbTime;
+    long expCalls, expTerms;        // applications of exp(VHS) and series terms (gemms) used
+    enum OrthoMethod { householder, cholqr2, mgs };
+    OrthoMethod orthoMethod;        // thin qr used by orthogonalize
+    int orthoAge;                   // steps since the last orthogonalization, used by stabilizeWalkers
+    long orthoChecks, orthoCalls;   // condition estimates and orthogonalizations
+    double orthoTime;
+    // back propagation window: the walker at the start of the window and the fields sampled since then
+    // the field buffer is allocated once with the window length, recording stops when it is full
+    std::vector<Eigen::VectorXcf> bpFields;
+    int bpStep;                     // fields recorded in the current window, -1 until startBackProp
+    std::array<Eigen::MatrixXcd, 2> bpDet;
+    Eigen::MatrixXcd bpDetG;
+    double bpTime;
 
     // constructor
     DQMCWalker(bool prhfQ = true, bool pphaselessQ = false, bool pszQ = false);
@@ -26,22 +54,53 @@ class DQMCWalker {
     void prepPropU(std::array<Eigen::MatrixXcd, 2>& ref, Hamiltonian& ham, double pdt, double pene0);
     void prepProp(Eigen::MatrixXcd& ref, Hamiltonian& ham, double pdt, double pene0);
 
+    // gives the walker its own random stream, independent of thread count and walker order
+    void seedGenerator(size_t seed, int rank, int index);
+
     void setDet(std::array<Eigen::MatrixXcd, 2> pdet);
     void setDet(Eigen::MatrixXcd pdet);
     void setDet(std::vector<std::complex<double>>& serial, std::complex<double> ptrialOverlap);
     std::complex<double> getDet(std::vector<std::complex<double>>& serial);
+    // the serialized determinant is followed by the back propagation window if there is one
+    int historySize();
+
+    // allocates the field buffer, the walker does not record until startBackProp
+    void initBackProp(int window, int nfields);
+    void startBackProp();
+    bool backPropReady() { return bpFields.size() > 0 && bpStep == bpFields.size(); };
 
+    void setOrthoMethod(std::string method);
     void orthogonalize();
+    double conditionEstimate();
 
     void propagate(Hamiltonian& ham);
     double propagatePhaseless(Wavefunction& wave, Hamiltonian& ham, double eshift);
     double propagatePhaselessRG(Wavefunction& wave, Hamiltonian& ham, double eshift);
     double propagatePhaselessU(Wavefunction& wave, Hamiltonian& ham, double eshift);
+    void applyExp(const Eigen::MatrixXcd& propc, Eigen::Ref<Eigen::MatrixXcd> det, int defaultOrder = 5);
+    void applyExp(const Eigen::MatrixXcf& propc, Eigen::Ref<Eigen::MatrixXcf> det, int defaultOrder = 5);
+    void applyPropFloat(const Eigen::MatrixXcf& expOneBody, Eigen::MatrixXcf& propc, Eigen::MatrixXcd& det);
+    void sampleFields(Eigen::VectorXcd& fb, Eigen::VectorXcf& fields, std::complex<double>& shift, std::complex<double>& fbTerm);
+    double phaselessRatio(std::complex<double> oldOverlap, std::complex<double> newOverlap, std::complex<double> shift, std::complex<double> fbTerm, double eshift);
 
     std::complex<double> overlap(Wavefunction& wave);
     void forceBias(Wavefunction& wave, Hamiltonian& ham, Eigen::VectorXcd& fb);
     void oneRDM(Wavefunction& wave, Eigen::MatrixXcd& rdmSample);
     void oneRDM(Wavefunction& wave, std::array<Eigen::MatrixXcd, 2>& rdmSample);
+    // 1-RDM between the reference propagated backwards over the window and the walker at its start
+    void backPropOneRDM(std::array<Eigen::MatrixXcd, 2>& ref, Hamiltonian& ham, int orthoSteps, std::array<Eigen::MatrixXcd, 2>& rdmSample);
+    void backPropOneRDM(Eigen::MatrixXcd& ref, Hamiltonian& ham, int orthoSteps, Eigen::MatrixXcd& rdmSample);
     std::array<std::complex<double>, 2> hamAndOverlap(Wavefunction& wave, Hamiltonian& ham);
 };
+
+// batched propagation of all walkers with nonzero weights, weights are updated in place
+void propagatePhaselessBatch(std::vector<DQMCWalker>& walkers, Eigen::ArrayXd& weights, Wavefunction& wave, Hamiltonian& ham, double eshift);
+
+// adaptive orthogonalization of the walkers with nonzero weights, a walker is orthogonalized if its
+// condition estimate, computed every checkSteps steps, exceeds condThresh or if it has not been
+// orthogonalized in maxAge steps
+void stabilizeWalkers(std::vector<DQMCWalker>& walkers, Eigen::ArrayXd& weights, double condThresh, int maxAge, int checkSteps, bool threadsQ);
+
+// batched local energy of all walkers with nonzero weights
+void hamAndOverlapBatch(std::vector<DQMCWalker>& walkers, Eigen::ArrayXd& weights, Wavefunction& wave, Hamiltonian& ham, std::vector<std::array<std::complex<double>, 2>>& hamOverlaps);
 #endif
@@ -73,6 +73,37 @@ void GHF::forceBias(Eigen::MatrixXcd& psi, Hamiltonian& ham, Eigen::VectorXcd& f
 };
  
 
+void GHF::overlapBatch(std::vector<Eigen::MatrixXcd*>& psi, Eigen::VectorXcd& overlaps)
+{
+  MatrixXcd overlapMat;
+  if (complexQ) overlapMat = overlapMatBatch(detCAd, psi);
+  else overlapMat = overlapMatBatch(detT, psi);
+  int nocc = psi[0]->cols();
+  overlaps.resize(psi.size());
+  for (int w = 0; w < psi.size(); w++) overlaps(w) = overlapMat.middleCols(w * nocc, nocc).determinant();
+};
+
+
+// theta matrices of all walkers are flattened into the columns of a (rotSize x nwalk) matrix
+// so that the contraction with the rotated cholesky vectors is a single gemm
+// soc integrals are not stored as a matrix and use the walker by walker version
+void GHF::forceBiasBatch(std::vector<Eigen::MatrixXcd*>& psi, Hamiltonian& ham, Eigen::MatrixXcd& fb)
+{
+  if (ham.socQ) {
+    Wavefunction::forceBiasBatch(psi, ham, fb);
+    return;
+  }
+  MatrixXcd overlapMat = overlapMatBatch(detT, psi);
+  int nrows = psi[0]->rows(), nocc = psi[0]->cols();
+  MatrixXcd thetaTFlat(nocc * nrows, psi.size());
+  for (int w = 0; w < psi.size(); w++) {
+    MatrixXcd thetaT = (*psi[w] * overlapMat.middleCols(w * nocc, nocc).inverse()).transpose();
+    thetaTFlat.col(w) = Eigen::Map<VectorXcd>(thetaT.data(), thetaT.rows() * thetaT.cols());
+  }
+  fb.noalias() = thetaTFlat.transpose() * rotCholMat[0];
+};
+
+
 void GHF::oneRDM(Eigen::MatrixXcd& psi, Eigen::MatrixXcd& rdmSample)
 {
   if (complexQ) rdmSample = (psi * (detCAd * psi).inverse() * detCAd).transpose();
@@ -105,7 +136,8 @@ std::array<std::complex<double>, 2> GHF::hamAndOverlap(Eigen::MatrixXcd& psi, Ha
     int norbs = ham.norbs, nelec = ham.nelec;
     MatrixXcd fup = MatrixXcd::Zero(nelec, nelec);
     MatrixXcd fdn = MatrixXcd::Zero(nelec, nelec);
-    for (int i = 0; i < ham.ncholEne; i++) {
+    for (int m = 0; m < ham.ncholEne; m++) {
+      int i = ham.cholEneIndex(m);
       fup.noalias() = rotCholC[i][0] * theta.block(0, 0, norbs, nelec);
       fdn.noalias() = rotCholC[i][1] * theta.block(norbs, 0, norbs, nelec);
       complex<double> cup = fup.trace();
@@ -116,25 +148,10 @@ std::array<std::complex<double>, 2> GHF::hamAndOverlap(Eigen::MatrixXcd& psi, Ha
     }
   }
   else {
-    MatrixXcd overlapMat = detT * psi;
-    overlap = overlapMat.determinant();
-    ene = ham.ecore;
-
-    // calculate theta and green
-    MatrixXcd theta = psi * overlapMat.inverse();
-    MatrixXcd green = (theta * detT).transpose();
-
-    // one body part
-    ene += green.cwiseProduct(ham.h1).sum();
-
-    // two body part
-    int norbs = ham.norbs, nelec = ham.nelec;
-    MatrixXcd f = MatrixXcd::Zero(nelec, nelec);
-    for (int i = 0; i < ham.ncholEne; i++) {
-      f.noalias() = rotChol[i] * theta;
-      complex<double> c = f.trace();
-      ene += (c * c - f.cwiseProduct(f.transpose()).sum()) / 2.;
-    }
+    std::vector<Eigen::MatrixXcd*> psiBatch(1, &psi);
+    std::vector<std::array<complex<double>, 2>> hamOverlaps;
+    hamAndOverlapBatch(psiBatch, ham, hamOverlaps);
+    return hamOverlaps[0];
   }
 
   std::array<complex<double>, 2> hamOverlap;
@@ -142,3 +159,39 @@ std::array<std::complex<double>, 2> GHF::hamAndOverlap(Eigen::MatrixXcd& psi, Ha
   hamOverlap[1] = overlap;
   return hamOverlap;
 };
+
+
+// coulomb part is a single gemm for all walkers, exchange is blocked over cholesky vectors
+// soc integrals are not stored as a matrix and use the walker by walker version
+void GHF::hamAndOverlapBatch(std::vector<Eigen::MatrixXcd*>& psi, Hamiltonian& ham, std::vector<std::array<std::complex<double>, 2>>& hamOverlaps)
+{
+  if (ham.socQ) {
+    Wavefunction::hamAndOverlapBatch(psi, ham, hamOverlaps);
+    return;
+  }
+  int nwalk = psi.size();
+
+  // calculate theta
+  std::vector<MatrixXcd> theta;
+  VectorXcd overlaps = VectorXcd::Ones(nwalk);
+  thetaBatch(detT, psi, theta, overlaps);
+  std::vector<MatrixXcd*> thetaPtr;
+  for (int w = 0; w < nwalk; w++) thetaPtr.push_back(&theta[w]);
+
+  // two body part
+  MatrixXcd coulomb;
+  VectorXcd exchange;
+  ham.rotatedCoulomb(rotCholMat[0], thetaPtr, coulomb);
+  ham.rotatedExchange(rotChol, thetaPtr, exchange);
+
+  hamOverlaps.resize(nwalk);
+  for (int w = 0; w < nwalk; w++) {
+    complex<double> ene = ham.ecore;
+    // one body part
+    MatrixXcd green = (theta[w] * detT).transpose();
+    ene += green.cwiseProduct(ham.h1).sum();
+    ene += (coulomb.col(w).cwiseProduct(coulomb.col(w)).sum() - exchange(w)) / 2.;
+    hamOverlaps[w][0] = ene * overlaps(w);
+    hamOverlaps[w][1] = overlaps(w);
+  }
+};
@@ -21,8 +21,11 @@ class GHF : public Wavefunction {
     virtual std::complex<double> overlap(Eigen::MatrixXcd& psi);
     //virtual void forceBias(std::array<Eigen::MatrixXcd, 2>& psi, Hamiltonian& ham, Eigen::VectorXcd& fb);
     virtual void forceBias(Eigen::MatrixXcd& psi, Hamiltonian& ham, Eigen::VectorXcd& fb);
+    virtual void overlapBatch(std::vector<Eigen::MatrixXcd*>& psi, Eigen::VectorXcd& overlaps);
+    virtual void forceBiasBatch(std::vector<Eigen::MatrixXcd*>& psi, Hamiltonian& ham, Eigen::MatrixXcd& fb);
     virtual void oneRDM(Eigen::MatrixXcd& det, Eigen::MatrixXcd& rdmSample);
     virtual std::array<std::complex<double>, 2> hamAndOverlap(std::array<Eigen::MatrixXcd, 2>& psi, Hamiltonian& ham);
     virtual std::array<std::complex<double>, 2> hamAndOverlap(Eigen::MatrixXcd& psi, Hamiltonian& ham);
+    virtual void hamAndOverlapBatch(std::vector<Eigen::MatrixXcd*>& psi, Hamiltonian& ham, std::vector<std::array<std::complex<double>, 2>>& hamOverlaps);
 };
 #endif
@@ -11,11 +11,8 @@ using matPair = std::array<MatrixXcd, 2>;
 
 GHFMultislater::GHFMultislater(Hamiltonian& ham, std::string fname, int pnact, int pncore, bool prightQ) 
 {
-  std::vector<int> refDetVec;
-  readDeterminantsGHFBinary(fname, refDetVec, ciExcitations, ciParity, ciCoeffs);
-  
-  refDet = VectorXi::Zero(refDetVec.size());
-  for (int i = 0; i < refDetVec.size(); i++) refDet[i] = refDetVec[i];
+  ci.load(fname, 1, schd.compactDeterminantFile);
+  refDet = ci.ref(0);
 
   nact = pnact;
   ncore = pncore;
@@ -25,8 +22,8 @@ GHFMultislater::GHFMultislater(Hamiltonian& ham, std::string fname, int pnact, i
 
   if (rightQ) {
     double sum = 0.;
-    for (int i = 0; i < ciCoeffs.size(); i++) {
-      sum += abs(ciCoeffs[i]);
+    for (int i = 0; i < ci.ndets; i++) {
+      sum += abs(ci.coeffs[i]);
       cumulativeCoeffs.push_back(sum);
     }
     uniform = uniform_real_distribution<double> (0., 1.);
@@ -44,7 +41,7 @@ std::complex<double> GHFMultislater::overlap(Eigen::MatrixXcd& psi)
 {
   int norbs = psi.rows();
   int nelec = refDet.size();
-  size_t ndets = ciCoeffs.size();
+  size_t ndets = ci.ndets;
 
   MatrixXcd phi0T = MatrixXcd::Zero(nelec, norbs);
   for (int i = 0; i < nelec; i++) phi0T(i, refDet[i]) = 1.;
@@ -61,45 +58,45 @@ std::complex<double> GHFMultislater::overlap(Eigen::MatrixXcd& psi)
   complex<double> overlap0 = (phi0T * psi).determinant();
  
   // ref contribution
-  overlap += ciCoeffs[0];
+  overlap += ci.coeffs[0];
 
   // iterate over excitations
   for (int i = 1; i < ndets; i++) {
     complex<double> dets;
-    int rank = ciExcitations[i][0].size();
+    int rank = ci.holes(0, i).size();
     if (rank == 0) {
       dets = 1.;
     }
     else if (rank == 1) {
-      dets = greeno(ciExcitations[i][0](0), ciExcitations[i][1](0));
+      dets = greeno(ci.holes(0, i)(0), ci.particles(0, i)(0));
     }
     else if (rank == 2) {
-      dets = greeno(ciExcitations[i][0](0), ciExcitations[i][1](0)) * greeno(ciExcitations[i][0](1), ciExcitations[i][1](1)) 
-           - greeno(ciExcitations[i][0](1), ciExcitations[i][1](0)) * greeno(ciExcitations[i][0](0), ciExcitations[i][1](1));
+      dets = greeno(ci.holes(0, i)(0), ci.particles(0, i)(0)) * greeno(ci.holes(0, i)(1), ci.particles(0, i)(1)) 
+           - greeno(ci.holes(0, i)(1), ci.particles(0, i)(0)) * greeno(ci.holes(0, i)(0), ci.particles(0, i)(1));
     }
     else if (rank == 3) {
       Matrix3cd temp = Matrix3cd::Zero(3, 3);
       for (int p = 0; p < rank; p++) 
         for (int t = 0; t < rank; t++) 
-          temp(p, t) = greeno(ciExcitations[i][0](p), ciExcitations[i][1](t));
+          temp(p, t) = greeno(ci.holes(0, i)(p), ci.particles(0, i)(t));
       dets = temp.determinant();
     }
     else if (rank == 4) {
       Matrix4cd temp = Matrix4cd::Zero(4, 4);
       for (int p = 0; p < rank; p++) 
         for (int t = 0; t < rank; t++) 
-          temp(p, t) = greeno(ciExcitations[i][0](p), ciExcitations[i][1](t));
+          temp(p, t) = greeno(ci.holes(0, i)(p), ci.particles(0, i)(t));
       dets = temp.determinant();
     }
     else {
       MatrixXcd temp = MatrixXcd::Zero(rank, rank);
       for (int p = 0; p < rank; p++) 
         for (int t = 0; t < rank; t++) 
-          temp(p, t) = greeno(ciExcitations[i][0](p), ciExcitations[i][1](t));
+          temp(p, t) = greeno(ci.holes(0, i)(p), ci.particles(0, i)(t));
       dets = temp.determinant();
     }
 
-    overlap += ciCoeffs[i] * ciParity[i] * dets;
+    overlap += ci.coeffs[i] * ci.parity[i] * dets;
   }
   overlap *= overlap0;
   return overlap;
@@ -111,7 +108,7 @@ void GHFMultislater::forceBias(Eigen::MatrixXcd& psi, Hamiltonian& ham, Eigen::V
   int norbs = ham.norbs;
   int nelec = refDet.size();
   int nchol = ham.nchol;
-  size_t ndets = ciCoeffs.size();
+  size_t ndets = ci.ndets;
   fb = VectorXcd::Zero(nchol);
 
   MatrixXcd phi0T;
@@ -127,7 +124,7 @@ void GHFMultislater::forceBias(Eigen::MatrixXcd& psi, Hamiltonian& ham, Eigen::V
   // most quantities henceforth will be calculated in "units" of overlap0 = < phi_0 | psi >
   complex<double> overlap0 = (psi(refDet, Eigen::placeholders::all)).determinant();
   complex<double> overlap(0., 0.);
-  overlap += ciCoeffs[0];
+  overlap += ci.coeffs[0];
   MatrixXcd intermediate, greenMulti;
   intermediate = MatrixXcd::Zero(norbs, nelec);
 
@@ -135,21 +132,21 @@ void GHFMultislater::forceBias(Eigen::MatrixXcd& psi, Hamiltonian& ham, Eigen::V
   for (int i = 1; i < ndets; i++) {
     MatrixXcd temp;
     complex<double> dets;
-    int rank = ciExcitations[i][0].size();
+    int rank = ci.holes(0, i).size();
     if (rank == 0) {
       dets = 1.;
     }
     else if (rank == 1) {
-      dets = greeno(ciExcitations[i][0](0), ciExcitations[i][1](0));
+      dets = greeno(ci.holes(0, i)(0), ci.particles(0, i)(0));
       temp = MatrixXcd::Zero(1, 1);
       temp(0, 0) = -1.;
     }
     else if (rank == 2) {
       Matrix2cd cofactors = Matrix2cd::Zero(2, 2);
-      cofactors(0, 0) = greeno(ciExcitations[i][0](1), ciExcitations[i][1](1));
-      cofactors(1, 1) = greeno(ciExcitations[i][0](0), ciExcitations[i][1](0));
-      cofactors(0, 1) = -greeno(ciExcitations[i][0](1), ciExcitations[i][1](0));
-      cofactors(1, 0) = -greeno(ciExcitations[i][0](0), ciExcitations[i][1](1));
+      cofactors(0, 0) = greeno(ci.holes(0, i)(1), ci.particles(0, i)(1));
+      cofactors(1, 1) = greeno(ci.holes(0, i)(0), ci.particles(0, i)(0));
+      cofactors(0, 1) = -greeno(ci.holes(0, i)(1), ci.particles(0, i)(0));
+      cofactors(1, 0) = -greeno(ci.holes(0, i)(0), ci.particles(0, i)(1));
       dets = cofactors.determinant();
       temp = -cofactors;
     }
@@ -163,12 +160,12 @@ void GHFMultislater::forceBias(Eigen::MatrixXcd& psi, Hamiltonian& ham, Eigen::V
             int q1 = q < p ? q : q + 1;
             for (int u = 0; u < rank - 1; u++) { 
               int u1 = u < t ? u : u + 1;
-              minorMat(q, u) = greeno(ciExcitations[i][0](q1), ciExcitations[i][1](u1));
+              minorMat(q, u) = greeno(ci.holes(0, i)(q1), ci.particles(0, i)(u1));
             }
           }
           double parity_pt = ((p + t)%2 == 0) ? 1. : -1.;
           cofactors(p, t) = parity_pt * minorMat.determinant();
-          dets += greeno(ciExcitations[i][0](p), ciExcitations[i][1](t)) * cofactors(p, t);
+          dets += greeno(ci.holes(0, i)(p), ci.particles(0, i)(t)) * cofactors(p, t);
         }
       }
       temp = -cofactors;
@@ -183,12 +180,12 @@ void GHFMultislater::forceBias(Eigen::MatrixXcd& psi, Hamiltonian& ham, Eigen::V
             int q1 = q < p ? q : q + 1;
             for (int u = 0; u < rank - 1; u++) { 
               int u1 = u < t ? u : u + 1;
-              minorMat(q, u) = greeno(ciExcitations[i][0](q1), ciExcitations[i][1](u1));
+              minorMat(q, u) = greeno(ci.holes(0, i)(q1), ci.particles(0, i)(u1));
             }
           }
           double parity_pt = ((p + t)%2 == 0) ? 1. : -1.;
           cofactors(p, t) = parity_pt * minorMat.determinant();
-          dets += greeno(ciExcitations[i][0](p), ciExcitations[i][1](t)) * cofactors(p, t);
+          dets += greeno(ci.holes(0, i)(p), ci.particles(0, i)(t)) * cofactors(p, t);
         }
       }
       temp = -cofactors;
@@ -203,22 +200,22 @@ void GHFMultislater::forceBias(Eigen::MatrixXcd& psi, Hamiltonian& ham, Eigen::V
             int q1 = q < p ? q : q + 1;
             for (int u = 0; u < rank - 1; u++) { 
               int u1 = u < t ? u : u + 1;
-              minorMat(q, u) = greeno(ciExcitations[i][0](q1), ciExcitations[i][1](u1));
+              minorMat(q, u) = greeno(ci.holes(0, i)(q1), ci.particles(0, i)(u1));
             }
           }
           double parity_pt = ((p + t)%2 == 0) ? 1. : -1.;
           cofactors(p, t) = parity_pt * minorMat.determinant();
-          dets += greeno(ciExcitations[i][0](p), ciExcitations[i][1](t)) * cofactors(p, t);
+          dets += greeno(ci.holes(0, i)(p), ci.particles(0, i)(t)) * cofactors(p, t);
         }
       }
       temp = cofactors;
     }
 
-    overlap += ciCoeffs[i] * ciParity[i] * dets;
+    overlap += ci.coeffs[i] * ci.parity[i] * dets;
     if (rank > 0) {
       for (int p = 0; p < rank; p++) 
         for (int t = 0; t < rank; t++)
-          intermediate(ciExcitations[i][1](t), ciExcitations[i][0](p)) += ciCoeffs[i] * ciParity[i] * temp(p, t);
+          intermediate(ci.particles(0, i)(t), ci.holes(0, i)(p)) += ci.coeffs[i] * ci.parity[i] * temp(p, t);
     }
   }
   
@@ -235,7 +232,7 @@ void GHFMultislater::oneRDM(Eigen::MatrixXcd& psi, Eigen::MatrixXcd& rdmSample)
 { 
   int norbs = psi.rows();
   int nelec = psi.cols();
-  size_t ndets = ciCoeffs.size();
+  size_t ndets = ci.ndets;
   rdmSample = MatrixXcd::Zero(norbs, norbs);
 
   MatrixXcd phi0T;
@@ -251,7 +248,7 @@ void GHFMultislater::oneRDM(Eigen::MatrixXcd& psi, Eigen::MatrixXcd& rdmSample)
   // most quantities henceforth will be calculated in "units" of overlap0 = < phi_0 | psi >
   complex<double> overlap0 = (psi(refDet, Eigen::placeholders::all)).determinant();
   complex<double> overlap(0., 0.);
-  overlap += ciCoeffs[0];
+  overlap += ci.coeffs[0];
   MatrixXcd intermediate, greenMulti;
   intermediate = MatrixXcd::Zero(norbs, nelec);
 
@@ -259,21 +256,21 @@ void GHFMultislater::oneRDM(Eigen::MatrixXcd& psi, Eigen::MatrixXcd& rdmSample)
   for (int i = 1; i < ndets; i++) {
     MatrixXcd temp;
     complex<double> dets;
-    int rank = ciExcitations[i][0].size();
+    int rank = ci.holes(0, i).size();
     if (rank == 0) {
       dets = 1.;
     }
     else if (rank == 1) {
-      dets = greeno(ciExcitations[i][0](0), ciExcitations[i][1](0));
+      dets = greeno(ci.holes(0, i)(0), ci.particles(0, i)(0));
       temp = MatrixXcd::Zero(1, 1);
       temp(0, 0) = -1.;
     }
     else if (rank == 2) {
       Matrix2cd cofactors = Matrix2cd::Zero(2, 2);
-      cofactors(0, 0) = greeno(ciExcitations[i][0](1), ciExcitations[i][1](1));
-      cofactors(1, 1) = greeno(ciExcitations[i][0](0), ciExcitations[i][1](0));
-      cofactors(0, 1) = -greeno(ciExcitations[i][0](1), ciExcitations[i][1](0));
-      cofactors(1, 0) = -greeno(ciExcitations[i][0](0), ciExcitations[i][1](1));
+      cofactors(0, 0) = greeno(ci.holes(0, i)(1), ci.particles(0, i)(1));
+      cofactors(1, 1) = greeno(ci.holes(0, i)(0), ci.particles(0, i)(0));
+      cofactors(0, 1) = -greeno(ci.holes(0, i)(1), ci.particles(0, i)(0));
+      cofactors(1, 0) = -greeno(ci.holes(0, i)(0), ci.particles(0, i)(1));
       dets = cofactors.determinant();
       temp = -cofactors;
     }
@@ -287,12 +284,12 @@ void GHFMultislater::oneRDM(Eigen::MatrixXcd& psi, Eigen::MatrixXcd& rdmSample)
             int q1 = q < p ? q : q + 1;
             for (int u = 0; u < rank - 1; u++) { 
               int u1 = u < t ? u : u + 1;
-              minorMat(q, u) = greeno(ciExcitations[i][0](q1), ciExcitations[i][1](u1));
+              minorMat(q, u) = greeno(ci.holes(0, i)(q1), ci.particles(0, i)(u1));
             }
           }
           double parity_pt = ((p + t)%2 == 0) ? 1. : -1.;
           cofactors(p, t) = parity_pt * minorMat.determinant();
-          dets += greeno(ciExcitations[i][0](p), ciExcitations[i][1](t)) * cofactors(p, t);
+          dets += greeno(ci.holes(0, i)(p), ci.particles(0, i)(t)) * cofactors(p, t);
         }
       }
       temp = -cofactors;
@@ -307,12 +304,12 @@ void GHFMultislater::oneRDM(Eigen::MatrixXcd& psi, Eigen::MatrixXcd& rdmSample)
             int q1 = q < p ? q : q + 1;
             for (int u = 0; u < rank - 1; u++) { 
               int u1 = u < t ? u : u + 1;
-              minorMat(q, u) = greeno(ciExcitations[i][0](q1), ciExcitations[i][1](u1));
+              minorMat(q, u) = greeno(ci.holes(0, i)(q1), ci.particles(0, i)(u1));
             }
           }
           double parity_pt = ((p + t)%2 == 0) ? 1. : -1.;
           cofactors(p, t) = parity_pt * minorMat.determinant();
-          dets += greeno(ciExcitations[i][0](p), ciExcitations[i][1](t)) * cofactors(p, t);
+          dets += greeno(ci.holes(0, i)(p), ci.particles(0, i)(t)) * cofactors(p, t);
         }
       }
       temp = -cofactors;
@@ -327,22 +324,22 @@ void GHFMultislater::oneRDM(Eigen::MatrixXcd& psi, Eigen::MatrixXcd& rdmSample)
             int q1 = q < p ? q : q + 1;
             for (int u = 0; u < rank - 1; u++) { 
               int u1 = u < t ? u : u + 1;
-              minorMat(q, u) = greeno(ciExcitations[i][0](q1), ciExcitations[i][1](u1));
+              minorMat(q, u) = greeno(ci.holes(0, i)(q1), ci.particles(0, i)(u1));
             }
           }
           double parity_pt = ((p + t)%2 == 0) ? 1. : -1.;
           cofactors(p, t) = parity_pt * minorMat.determinant();
-          dets += greeno(ciExcitations[i][0](p), ciExcitations[i][1](t)) * cofactors(p, t);
+          dets += greeno(ci.holes(0, i)(p), ci.particles(0, i)(t)) * cofactors(p, t);
         }
       }
       temp = cofactors;
     }
 
-    overlap += ciCoeffs[i] * ciParity[i] * dets;
+    overlap += ci.coeffs[i] * ci.parity[i] * dets;
     if (rank > 0) {
       for (int p = 0; p < rank; p++) 
         for (int t = 0; t < rank; t++)
-          intermediate(ciExcitations[i][1](t), ciExcitations[i][0](p)) += ciCoeffs[i] * ciParity[i] * temp(p, t);
+          intermediate(ci.particles(0, i)(t), ci.holes(0, i)(p)) += ci.coeffs[i] * ci.parity[i] * temp(p, t);
     }
   }
   
@@ -359,7 +356,7 @@ void GHFMultislater::oneRDM(Eigen::MatrixXcd& psi, Eigen::MatrixXcd& rdmSample)
 //  int nbeta = ham.nbeta;
 //  int nchol = ham.chol.size();
 //  std::array<int, 2> nelec{nalpha, nbeta};
-//  size_t ndets = ciCoeffs.size();
+//  size_t ndets = ci.ndets;
 //  fb = VectorXcd::Zero(ham.chol.size());
 //
 //  matPair phi0T;
@@ -391,8 +388,8 @@ void GHFMultislater::oneRDM(Eigen::MatrixXcd& psi, Eigen::MatrixXcd& rdmSample)
 //    hG[1] = greeno[1].cwiseProduct(ham.chol[gamma].block(0, 0, nbeta, norbs)).sum();
 //    complex<double> ene(0., 0.), overlap(0., 0.);
 //    // ref contribution
-//    overlap += ciCoeffs[0];
-//    ene += ciCoeffs[0] * (hG[0] + hG[1]);
+//    overlap += ci.coeffs[0];
+//    ene += ci.coeffs[0] * (hG[0] + hG[1]);
 //    
 //    // 1e intermediate
 //    matPair roth1;
@@ -434,8 +431,8 @@ void GHFMultislater::oneRDM(Eigen::MatrixXcd& psi, Eigen::MatrixXcd& rdmSample)
 //          }
 //        }
 //      }
-//      overlap += ciCoeffs[i] * ciParity[i] * dets[0] * dets[1];
-//      ene += ciCoeffs[i] * ciParity[i] * (oneEne[0] * dets[1] + dets[0] * oneEne[1]);
+//      overlap += ci.coeffs[i] * ci.parity[i] * dets[0] * dets[1];
+//      ene += ci.coeffs[i] * ci.parity[i] * (oneEne[0] * dets[1] + dets[0] * oneEne[1]);
 //    }
 //    overlap *= overlap0;
 //    ene *= (overlap0 / overlap);
@@ -449,7 +446,7 @@ std::array<std::complex<double>, 2> GHFMultislater::hamAndOverlap(Eigen::MatrixX
   int norbs = ham.norbs;
   int nelec = refDet.size();
   int nchol = ham.ncholEne;
-  size_t ndets = ciCoeffs.size();
+  size_t ndets = ci.ndets;
 
   MatrixXcd phi0T;
   phi0T = MatrixXcd::Zero(nelec, norbs);
@@ -467,10 +464,10 @@ std::array<std::complex<double>, 2> GHFMultislater::hamAndOverlap(Eigen::MatrixX
   complex<double> overlap0 = (phi0T * psi).determinant();
  
   // ref contribution
-  overlap += ciCoeffs[0];
+  overlap += ci.coeffs[0];
   complex<double> hG;
   hG = greeno.cwiseProduct(ham.h1(refDet, Eigen::placeholders::all)).sum();
-  ene += ciCoeffs[0] * hG;
+  ene += ci.coeffs[0] * hG;
   
   // 1e intermediate
   MatrixXcd roth1;
@@ -487,7 +484,7 @@ std::array<std::complex<double>, 2> GHFMultislater::hamAndOverlap(Eigen::MatrixX
   for (int i = 1; i < ndets; i++) {
     MatrixXcd blocks;
     complex<double> oneEne, dets;
-    int rank = ciExcitations[i][0].size();
+    int rank = ci.holes(0, i).size();
     if (rank == 0) {
       dets = 1.;
       oneEne = hG;
@@ -496,7 +493,7 @@ std::array<std::complex<double>, 2> GHFMultislater::hamAndOverlap(Eigen::MatrixX
       blocks = MatrixXcd::Zero(rank, rank);
       for (int p = 0; p < rank; p++) 
         for (int t = 0; t < rank; t++) 
-          blocks(p, t) = greeno(ciExcitations[i][0](p), ciExcitations[i][1](t));
+          blocks(p, t) = greeno(ci.holes(0, i)(p), ci.particles(0, i)(t));
       
       dets = blocks.determinant();
       oneEne = hG * dets;
@@ -505,13 +502,13 @@ std::array<std::complex<double>, 2> GHFMultislater::hamAndOverlap(Eigen::MatrixX
       for (int p = 0; p < rank; p++) {
         temp = blocks;
         for (int t = 0; t < rank; t++)
-          temp(p, t) = roth1(ciExcitations[i][0](p), ciExcitations[i][1](t));
+          temp(p, t) = roth1(ci.holes(0, i)(p), ci.particles(0, i)(t));
         oneEne -= temp.determinant();
       }
     }
 
-    overlap += ciCoeffs[i] * ciParity[i] * dets;
-    ene += ciCoeffs[i] * ciParity[i] * oneEne;
+    overlap += ci.coeffs[i] * ci.parity[i] * dets;
+    ene += ci.coeffs[i] * ci.parity[i] * oneEne;
     gBlocks.push_back(blocks);
     gBlockDets.push_back(dets);
   }
@@ -522,7 +519,10 @@ std::array<std::complex<double>, 2> GHFMultislater::hamAndOverlap(Eigen::MatrixX
   int2 = 0. * greeno.block(0, 0, nelec, nact);
   complex<double> l2G2Tot(0., 0.);
   
-  for (int n = 0; n < nchol; n++) {
+  MatrixXd cholBuffer;
+  for (int m = 0; m < nchol; m++) {
+    int n = ham.cholEneIndex(m);
+    Eigen::Map<const MatrixXd> cholN = ham.choleskyMatrix(n, cholBuffer);
     complex<double> lG, l2G2;
     MatrixXcd exc;
     //exc.noalias() = ham.chol[n].block(0, 0, nelec[0], norbs) * theta;
@@ -533,38 +533,38 @@ std::array<std::complex<double>, 2> GHFMultislater::hamAndOverlap(Eigen::MatrixX
     //int1.noalias() += lG * int2;
     //int1.noalias() -= (greeno * ham.chol[n].block(0, 0, norbs, nelec[0])) * int2;
         
-    exc.noalias() = ham.chol[n](refDet, Eigen::placeholders::all) * theta;
+    exc.noalias() = cholN(refDet, Eigen::placeholders::all) * theta;
     lG = exc.trace();
     l2G2 = lG * lG - exc.cwiseProduct(exc.transpose()).sum();
     l2G2Tot += l2G2;
-    int2.noalias() = (greeno * ham.chol[n].block(0, 0, norbs, nact + ncore)) * greenp.block(0, ncore, nact + ncore, nact);
+    int2.noalias() = (greeno * cholN.block(0, 0, norbs, nact + ncore)) * greenp.block(0, ncore, nact + ncore, nact);
     int1.noalias() += lG * int2;
-    int1.noalias() -= (greeno * ham.chol[n](Eigen::placeholders::all, refDet)) * int2;
+    int1.noalias() -= (greeno * cholN(Eigen::placeholders::all, refDet)) * int2;
 
     // ref contribution
-    ene += ciCoeffs[0] * l2G2 / 2.;
+    ene += ci.coeffs[0] * l2G2 / 2.;
     
     // iterate over excitations
     for (int i = 1; i < ndets; i++) {
       complex<double> oneEne, twoEne;
-      int rank = ciExcitations[i][0].size();
+      int rank = ci.holes(0, i).size();
       if (rank == 0) {
         oneEne = lG;
       }
       if (rank == 1) {
-        oneEne = lG * gBlockDets[i] - int2(ciExcitations[i][0](0), ciExcitations[i][1](0) - ncore);
+        oneEne = lG * gBlockDets[i] - int2(ci.holes(0, i)(0), ci.particles(0, i)(0) - ncore);
       }
       else if (rank == 2) {
         oneEne = lG * gBlockDets[i] 
-                   - int2(ciExcitations[i][0](0), ciExcitations[i][1](0) - ncore) * gBlocks[i](1, 1)
-                   + int2(ciExcitations[i][0](0), ciExcitations[i][1](1) - ncore) * gBlocks[i](1, 0)
-                   + int2(ciExcitations[i][0](1), ciExcitations[i][1](0) - ncore) * gBlocks[i](0, 1)
-                   - int2(ciExcitations[i][0](1), ciExcitations[i][1](1) - ncore) * gBlocks[i](0, 0);
-
-        twoEne = 2. * (  int2(ciExcitations[i][0](0), ciExcitations[i][1](0) - ncore)    
-                           * int2(ciExcitations[i][0](1), ciExcitations[i][1](1) - ncore) 
-                           - int2(ciExcitations[i][0](1), ciExcitations[i][1](0) - ncore) 
-                           * int2(ciExcitations[i][0](0), ciExcitations[i][1](1) - ncore)  );
+                   - int2(ci.holes(0, i)(0), ci.particles(0, i)(0) - ncore) * gBlocks[i](1, 1)
+                   + int2(ci.holes(0, i)(0), ci.particles(0, i)(1) - ncore) * gBlocks[i](1, 0)
+                   + int2(ci.holes(0, i)(1), ci.particles(0, i)(0) - ncore) * gBlocks[i](0, 1)
+                   - int2(ci.holes(0, i)(1), ci.particles(0, i)(1) - ncore) * gBlocks[i](0, 0);
+
+        twoEne = 2. * (  int2(ci.holes(0, i)(0), ci.particles(0, i)(0) - ncore)    
+                           * int2(ci.holes(0, i)(1), ci.particles(0, i)(1) - ncore) 
+                           - int2(ci.holes(0, i)(1), ci.particles(0, i)(0) - ncore) 
+                           * int2(ci.holes(0, i)(0), ci.particles(0, i)(1) - ncore)  );
       }
       else if (rank == 3) {
         // oneEne
@@ -575,7 +575,7 @@ std::array<std::complex<double>, 2> GHFMultislater::hamAndOverlap(Eigen::MatrixX
           for (int p = 0; p < rank; p++) {
             temp = gBlocks[i];
             for (int t = 0; t < rank; t++)
-              temp(p, t) = int2(ciExcitations[i][0](p), ciExcitations[i][1](t) - ncore);
+              temp(p, t) = int2(ci.holes(0, i)(p), ci.particles(0, i)(t) - ncore);
             oneEne -= temp.determinant();
           }
         }
@@ -591,10 +591,10 @@ std::array<std::complex<double>, 2> GHFMultislater::hamAndOverlap(Eigen::MatrixX
                 for (int u = t + 1; u < rank; u++) {
                   double parity_tu = ((t + u + 1)%2 == 0) ? 1. : -1.;
                   complex<double> blockBlockDet = gBlocks[i](3 - p - q, 3 - t - u);
-                  twoEne += 2. * parity_pq * parity_tu * blockBlockDet * (  int2(ciExcitations[i][0](p), ciExcitations[i][1](t) - ncore) 
-                                                                              * int2(ciExcitations[i][0](q), ciExcitations[i][1](u) - ncore) 
-                                                                              - int2(ciExcitations[i][0](q), ciExcitations[i][1](t) - ncore) 
-                                                                              * int2(ciExcitations[i][0](p), ciExcitations[i][1](u) - ncore)  );
+                  twoEne += 2. * parity_pq * parity_tu * blockBlockDet * (  int2(ci.holes(0, i)(p), ci.particles(0, i)(t) - ncore) 
+                                                                              * int2(ci.holes(0, i)(q), ci.particles(0, i)(u) - ncore) 
+                                                                              - int2(ci.holes(0, i)(q), ci.particles(0, i)(t) - ncore) 
+                                                                              * int2(ci.holes(0, i)(p), ci.particles(0, i)(u) - ncore)  );
                 }
               }
             }
@@ -610,7 +610,7 @@ std::array<std::complex<double>, 2> GHFMultislater::hamAndOverlap(Eigen::MatrixX
           for (int p = 0; p < rank; p++) {
             temp = gBlocks[i];
             for (int t = 0; t < rank; t++)
-              temp(p, t) = int2(ciExcitations[i][0](p), ciExcitations[i][1](t) - ncore);
+              temp(p, t) = int2(ci.holes(0, i)(p), ci.particles(0, i)(t) - ncore);
             oneEne -= temp.determinant();
           }
         }
@@ -642,10 +642,10 @@ std::array<std::complex<double>, 2> GHFMultislater::hamAndOverlap(Eigen::MatrixX
                   
                   complex<double> blockBlockDet = gBlocks[i](pp, tp) * gBlocks[i](qp, up) - gBlocks[i](pp, up) * gBlocks[i](qp, tp);
 
-                  twoEne += 2. * parity_pq * parity_tu * blockBlockDet * (  int2(ciExcitations[i][0](p), ciExcitations[i][1](t) - ncore) 
-                                                                              * int2(ciExcitations[i][0](q), ciExcitations[i][1](u) - ncore) 
-                                                                              - int2(ciExcitations[i][0](q), ciExcitations[i][1](t) - ncore) 
-                                                                              * int2(ciExcitations[i][0](p), ciExcitations[i][1](u) - ncore)  );
+                  twoEne += 2. * parity_pq * parity_tu * blockBlockDet * (  int2(ci.holes(0, i)(p), ci.particles(0, i)(t) - ncore) 
+                                                                              * int2(ci.holes(0, i)(q), ci.particles(0, i)(u) - ncore) 
+                                                                              - int2(ci.holes(0, i)(q), ci.particles(0, i)(t) - ncore) 
+                                                                              * int2(ci.holes(0, i)(p), ci.particles(0, i)(u) - ncore)  );
                 }
               }
             }
@@ -661,7 +661,7 @@ std::array<std::complex<double>, 2> GHFMultislater::hamAndOverlap(Eigen::MatrixX
           for (int p = 0; p < rank; p++) {
             temp = gBlocks[i];
             for (int t = 0; t < rank; t++)
-              temp(p, t) = int2(ciExcitations[i][0](p), ciExcitations[i][1](t) - ncore);
+              temp(p, t) = int2(ci.holes(0, i)(p), ci.particles(0, i)(t) - ncore);
             oneEne -= temp.determinant();
           }
         }
@@ -691,10 +691,10 @@ std::array<std::complex<double>, 2> GHFMultislater::hamAndOverlap(Eigen::MatrixX
                       blockBlock(mup, nup) = gBlocks[i](diff0[mup], diff1[nup]);
                   complex<double> blockBlockDet = blockBlock.determinant();
 
-                  twoEne += 2. * parity_pq * parity_tu * blockBlockDet * (  int2(ciExcitations[i][0](p), ciExcitations[i][1](t) - ncore) 
-                                                                              * int2(ciExcitations[i][0](q), ciExcitations[i][1](u) - ncore) 
-                                                                              - int2(ciExcitations[i][0](q), ciExcitations[i][1](t) - ncore) 
-                                                                              * int2(ciExcitations[i][0](p), ciExcitations[i][1](u) - ncore)  );
+                  twoEne += 2. * parity_pq * parity_tu * blockBlockDet * (  int2(ci.holes(0, i)(p), ci.particles(0, i)(t) - ncore) 
+                                                                              * int2(ci.holes(0, i)(q), ci.particles(0, i)(u) - ncore) 
+                                                                              - int2(ci.holes(0, i)(q), ci.particles(0, i)(t) - ncore) 
+                                                                              * int2(ci.holes(0, i)(p), ci.particles(0, i)(u) - ncore)  );
                 }
               }
             }
@@ -702,7 +702,7 @@ std::array<std::complex<double>, 2> GHFMultislater::hamAndOverlap(Eigen::MatrixX
         }
       } 
 
-      ene += ciParity[i] * ciCoeffs[i] * twoEne / 2.;
+      ene += ci.parity[i] * ci.coeffs[i] * twoEne / 2.;
     
     } // dets
   } // chol
@@ -710,19 +710,19 @@ std::array<std::complex<double>, 2> GHFMultislater::hamAndOverlap(Eigen::MatrixX
   // iterate over excitations
   for (int i = 1; i < ndets; i++) {
     complex<double> oneEne, twoEne;
-    int rank = ciExcitations[i][0].size();
+    int rank = ci.holes(0, i).size();
     if (rank == 0) {
       twoEne = l2G2Tot;
     }
     else if (rank == 1) {
-      twoEne = l2G2Tot * gBlockDets[i] - 2. * int1(ciExcitations[i][0](0), ciExcitations[i][1](0) - ncore);
+      twoEne = l2G2Tot * gBlockDets[i] - 2. * int1(ci.holes(0, i)(0), ci.particles(0, i)(0) - ncore);
     }
     else if (rank == 2) {
       twoEne = l2G2Tot * gBlockDets[i]
-                 + 2. * (- int1(ciExcitations[i][0](0), ciExcitations[i][1](0) - ncore) * gBlocks[i](1, 1)
-                         + int1(ciExcitations[i][0](0), ciExcitations[i][1](1) - ncore) * gBlocks[i](1, 0)
-                         + int1(ciExcitations[i][0](1), ciExcitations[i][1](0) - ncore) * gBlocks[i](0, 1)
-                         - int1(ciExcitations[i][0](1), ciExcitations[i][1](1) - ncore) * gBlocks[i](0, 0)  );
+                 + 2. * (- int1(ci.holes(0, i)(0), ci.particles(0, i)(0) - ncore) * gBlocks[i](1, 1)
+                         + int1(ci.holes(0, i)(0), ci.particles(0, i)(1) - ncore) * gBlocks[i](1, 0)
+                         + int1(ci.holes(0, i)(1), ci.particles(0, i)(0) - ncore) * gBlocks[i](0, 1)
+                         - int1(ci.holes(0, i)(1), ci.particles(0, i)(1) - ncore) * gBlocks[i](0, 0)  );
     }
     else if (rank == 3) {
       // twoEne
@@ -735,7 +735,7 @@ std::array<std::complex<double>, 2> GHFMultislater::hamAndOverlap(Eigen::MatrixX
         for (int p = 0; p < rank; p++) {
           temp = gBlocks[i];
           for (int t = 0; t < rank; t++)
-            temp(p, t) = int1(ciExcitations[i][0](p), ciExcitations[i][1](t) - ncore);
+            temp(p, t) = int1(ci.holes(0, i)(p), ci.particles(0, i)(t) - ncore);
           twoEne -= 2. * temp.determinant();
         }
       }
@@ -751,7 +751,7 @@ std::array<std::complex<double>, 2> GHFMultislater::hamAndOverlap(Eigen::MatrixX
         for (int p = 0; p < rank; p++) {
           temp = gBlocks[i];
           for (int t = 0; t < rank; t++)
-            temp(p, t) = int1(ciExcitations[i][0](p), ciExcitations[i][1](t) - ncore);
+            temp(p, t) = int1(ci.holes(0, i)(p), ci.particles(0, i)(t) - ncore);
           twoEne -= 2. * temp.determinant();
         }
       }
@@ -767,13 +767,13 @@ std::array<std::complex<double>, 2> GHFMultislater::hamAndOverlap(Eigen::MatrixX
         for (int p = 0; p < rank; p++) {
           temp = gBlocks[i];
           for (int t = 0; t < rank; t++)
-            temp(p, t) = int1(ciExcitations[i][0](p), ciExcitations[i][1](t) - ncore);
+            temp(p, t) = int1(ci.holes(0, i)(p), ci.particles(0, i)(t) - ncore);
           twoEne -= 2. * temp.determinant();
         }
       }
     } 
 
-    ene += ciParity[i] * ciCoeffs[i] * twoEne / 2.;
+    ene += ci.parity[i] * ci.coeffs[i] * twoEne / 2.;
   
   } // dets
 
@@ -4,14 +4,13 @@
 #include <random>
 #include "Hamiltonian.h"
 #include "Wavefunction.h"
+#include "CIExpansion.h"
 
 // multislater wave function
 class GHFMultislater : public Wavefunction {
   public:
     Eigen::VectorXi refDet; 
-    std::vector<std::array<Eigen::VectorXi, 2>> ciExcitations;
-    std::vector<double> ciParity; 
-    std::vector<double> ciCoeffs;
+    CIExpansion ci;
     int nact, ncore;
     bool rightQ;
     std::vector<double> cumulativeCoeffs;
@@ -6,10 +6,69 @@ using namespace std;
 using namespace Eigen;
 
 // constructor
-Hamiltonian::Hamiltonian(string fname, bool psocQ, std::string pintType) 
+Hamiltonian::Hamiltonian(string fname, bool psocQ, std::string pintType, bool pthcQ, std::string pcholStorage) 
 {
   intType = pintType;
   socQ = psocQ;
+  thcQ = pthcQ;
+  cholStorage = pcholStorage;
+  floatChol = nullptr;
+  packedChol = nullptr;
+  if (thcQ) {
+    if (socQ || intType != "r") {
+      if (commrank == 0) cout << "THC integrals are only supported with intType r\n";
+      exit(0);
+    }
+    readDQMCIntegralsTHC(fname, norbs, nalpha, nbeta, ecore, h1, thcOrbs, thcV);
+    nelec = nalpha + nbeta;
+
+    // fields from the eigendecomposition of the central tensor
+    SelfAdjointEigenSolver<MatrixXd> eigen(thcV);
+    double maxEval = eigen.eigenvalues().cwiseAbs().maxCoeff();
+    if (eigen.eigenvalues().minCoeff() < -1.e-8 * maxEval && commrank == 0) 
+      cout << "Dropping negative eigenvalues of the THC tensor, smallest:  " << eigen.eigenvalues().minCoeff() << endl;
+    vector<int> kept;
+    for (int i = 0; i < thcV.rows(); i++) if (eigen.eigenvalues()(i) > 1.e-10 * maxEval) kept.push_back(i);
+    thcU = MatrixXd::Zero(thcV.rows(), kept.size());
+    for (int i = 0; i < kept.size(); i++) thcU.col(i) = sqrt(eigen.eigenvalues()(kept[i])) * eigen.eigenvectors().col(kept[i]);
+    nchol = thcU.cols();
+    ncholEne = thcU.cols();
+
+    // h1Mod = h1 - sum_n L_n L_n / 2
+    MatrixXd overlap = thcOrbs * thcOrbs.transpose();
+    h1Mod = h1 - thcOrbs.transpose() * thcV.cwiseProduct(overlap) * thcOrbs / 2.;
+    rotFlag = false;
+    return;
+  }
+  if (cholStorage != "full") {
+    if (cholStorage != "double" && cholStorage != "float") {
+      if (commrank == 0) cout << "Cholesky storage " << cholStorage << " not supported, use full, double or float\n";
+      exit(0);
+    }
+    if (socQ) {
+      if (commrank == 0) cout << "Packed cholesky storage is not supported with soc integrals\n";
+      exit(0);
+    }
+    std::array<MatrixXd, 2> h1s, h1sMod;
+    readDQMCIntegralsPacked(fname, intType, cholStorage == "float", norbs, nalpha, nbeta, nchol, ecore, h1s, h1sMod, packedChol, floatChol);
+    if (intType == "u") {
+      h1u = h1s;
+      h1uMod = h1sMod;
+    }
+    else {
+      h1 = h1s[0];
+      h1Mod = h1sMod[0];
+    }
+    nelec = nalpha + nbeta;
+    if (intType == "g") {
+      nalpha = 0;
+      nbeta = 0;
+    }
+    ncholEne = nchol;
+    mapPackedCholesky();
+    rotFlag = false;
+    return;
+  }
   if (socQ) {
     readDQMCIntegralsSOC(fname, norbs, nelec, ecore, h1soc, h1socMod, chol);
     nalpha = 0;
@@ -48,18 +107,48 @@ void Hamiltonian::setNcholEne(int pnchol)
 };
 
 
+Eigen::Map<const Eigen::MatrixXd> Hamiltonian::choleskyMatrix(int n, Eigen::MatrixXd& buffer, int sz, bool packedQ) const
+{
+  if (!packedQ && intType == "u" && !cholu.empty()) return Eigen::Map<const MatrixXd>(cholu[n][sz].data(), norbs, norbs);
+  if (!packedQ && intType != "u" && !chol.empty()) return Eigen::Map<const MatrixXd>(chol[n].data(), norbs, norbs);
+  size_t triSize = (norbs * (norbs + 1)) / 2;
+  size_t counter = ((intType == "u" ? sz : 0) * size_t(nchol) + n) * triSize;
+  buffer.resize(norbs, norbs);
+  if (packedChol != nullptr) {
+    for (int i = 0; i < norbs; i++) {
+      for (int j = 0; j <= i; j++) {
+        buffer(i, j) = packedChol[counter];
+        buffer(j, i) = packedChol[counter];
+        counter++;
+      }
+    }
+  }
+  else {
+    for (int i = 0; i < norbs; i++) {
+      for (int j = 0; j <= i; j++) {
+        buffer(i, j) = floatChol[counter];
+        buffer(j, i) = floatChol[counter];
+        counter++;
+      }
+    }
+  }
+  return Eigen::Map<const MatrixXd>(buffer.data(), norbs, norbs);
+};
+
+
 // rotate cholesky ri or gi
 void Hamiltonian::rotateCholesky(Eigen::MatrixXd& phiT, std::vector<Eigen::Map<Eigen::MatrixXd>>& rotChol, std::vector<Eigen::Map<Eigen::MatrixXd>>& rotCholMat, bool deleteOriginalChol) 
 {
   double* rotCholSHM;
   double* rotChol0;
   size_t rotSize = phiT.rows() * norbs;
-  size_t size = chol.size() * rotSize;
+  size_t size = nchol * rotSize;
 
   if (commrank == 0) {
     rotChol0 = new double[size];
-    for (int i = 0; i < chol.size(); i++) {
-      MatrixXd rot = phiT * chol[i];
+    MatrixXd cholBuffer;
+    for (int i = 0; i < nchol; i++) {
+      MatrixXd rot = phiT * choleskyMatrix(i, cholBuffer);
       for (int nu = 0; nu < rot.cols(); nu++)
         for (int mu = 0; mu < rot.rows(); mu++)
           rotChol0[i * rotSize + nu * rot.rows() + mu] = rot(mu, nu);
@@ -71,7 +160,7 @@ void Hamiltonian::rotateCholesky(Eigen::MatrixXd& phiT, std::vector<Eigen::Map<E
   MPI_Barrier(MPI_COMM_WORLD);
   
   // create eigen matrix maps to shared memory
-  for (size_t n = 0; n < chol.size(); n++) {
+  for (size_t n = 0; n < nchol; n++) {
     Eigen::Map<MatrixXd> rotCholMatMap(static_cast<double*>(rotCholSHM) + n * rotSize, phiT.rows(), norbs);
     rotChol.push_back(rotCholMatMap);
   }
@@ -95,16 +184,13 @@ void Hamiltonian::rotateCholesky(std::array<Eigen::MatrixXd, 2>& phiT, std::arra
 
   if (commrank == 0) {
     rotChol0 = new double[size];
+    MatrixXd cholBuffer;
     for (size_t i = 0; i < nchol; i++) {
-      MatrixXd rot0;
-      if (intType == "r") rot0 = phiT[0] * chol[i];
-      else if (intType == "u") rot0 = phiT[0] * cholu[i][0];
+      MatrixXd rot0 = phiT[0] * choleskyMatrix(i, cholBuffer, 0);
       for (size_t nu = 0; nu < rot0.cols(); nu++)
         for (size_t mu = 0; mu < rot0.rows(); mu++)
           rotChol0[i * rotSize0 + nu * rot0.rows() + mu] = rot0(mu, nu);
-      MatrixXd rot1;
-      if (intType == "r") rot1 = phiT[1] * chol[i];
-      else if (intType == "u") rot1 = phiT[1] * cholu[i][1];
+      MatrixXd rot1 = phiT[1] * choleskyMatrix(i, cholBuffer, 1);
       for (size_t nu = 0; nu < rot1.cols(); nu++)
         for (size_t mu = 0; mu < rot1.rows(); mu++)
           rotChol0[nchol * rotSize0 + i * rotSize1 + nu * rot1.rows() + mu] = rot1(mu, nu);
@@ -145,18 +231,122 @@ void Hamiltonian::rotateCholesky(Eigen::MatrixXcd& phiAd, std::vector<std::array
 };
 
     
+void Hamiltonian::rotatedCoulomb(Eigen::Map<Eigen::MatrixXd>& rotCholMat, std::vector<Eigen::MatrixXcd*>& theta, Eigen::MatrixXcd& coulomb)
+{
+  int nrows = theta[0]->rows(), nocc = theta[0]->cols();
+  MatrixXcd thetaTFlat(nrows * nocc, theta.size());
+  for (int w = 0; w < theta.size(); w++) {
+    MatrixXcd thetaT = theta[w]->transpose();
+    thetaTFlat.col(w) = Eigen::Map<VectorXcd>(thetaT.data(), thetaT.rows() * thetaT.cols());
+  }
+  if (cholEneOrder.empty()) coulomb.noalias() = rotCholMat.leftCols(ncholEne).transpose() * thetaTFlat;
+  else {
+    // ranked vectors are not contiguous, the coulomb gemm is cheap compared to exchange
+    MatrixXcd coulombAll = rotCholMat.transpose() * thetaTFlat;
+    coulomb.resize(ncholEne, theta.size());
+    for (int i = 0; i < ncholEne; i++) coulomb.row(i) = coulombAll.row(cholEneOrder[i]);
+  }
+};
+
+
+void Hamiltonian::rotatedExchange(std::vector<Eigen::Map<Eigen::MatrixXd>>& rotChol, std::vector<Eigen::MatrixXcd*>& theta, Eigen::VectorXcd& exchange)
+{
+  int nocc = rotChol[0].rows(), nrows = rotChol[0].cols();
+  // block of cholesky vectors stacked vertically, limited to about 8 MB
+  int blockSize = std::max(1, std::min(ncholEne, (1 << 20) / (nocc * nrows)));
+  MatrixXd cholBlock(blockSize * nocc, nrows);
+  MatrixXcd f(blockSize * nocc, nocc);
+  exchange = VectorXcd::Zero(theta.size());
+  for (int i0 = 0; i0 < ncholEne; i0 += blockSize) {
+    int nblock = std::min(blockSize, ncholEne - i0);
+    for (int i = 0; i < nblock; i++) cholBlock.middleRows(i * nocc, nocc) = rotChol[cholEneIndex(i0 + i)];
+    for (int w = 0; w < theta.size(); w++) {
+      f.topRows(nblock * nocc).noalias() = cholBlock.topRows(nblock * nocc) * (*theta[w]);
+      for (int i = 0; i < nblock; i++) 
+        exchange(w) += f.middleRows(i * nocc, nocc).cwiseProduct(f.middleRows(i * nocc, nocc).transpose()).sum();
+    }
+  }
+};
+
+
+// the cholesky vectors are distributed over processes
+void Hamiltonian::cholEnergyContributions(std::array<Eigen::MatrixXcd, 2>& ref, Eigen::VectorXd& contributions)
+{
+  std::array<MatrixXcd, 2> refInvT;
+  for (int sz = 0; sz < 2; sz++) refInvT[sz] = (ref[sz].adjoint() * ref[sz]).inverse() * ref[sz].adjoint();
+  contributions = VectorXd::Zero(nchol);
+  MatrixXd cholBuffer;
+  for (int n = commrank; n < nchol; n += commsize) {
+    complex<double> coul(0., 0.), exch(0., 0.);
+    for (int sz = 0; sz < 2; sz++) {
+      if (ref[sz].cols() == 0) continue;
+      MatrixXcd a = refInvT[sz] * choleskyMatrix(n, cholBuffer, sz) * ref[sz];
+      coul += a.trace();
+      exch += a.cwiseProduct(a.transpose()).sum();
+    }
+    contributions(n) = ((coul * coul - exch) / 2.).real();
+  }
+  MPI_Allreduce(MPI_IN_PLACE, contributions.data(), nchol, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+};
+
+
+void Hamiltonian::cholEnergyContributions(Eigen::MatrixXcd& ref, Eigen::VectorXd& contributions)
+{
+  MatrixXcd refInvT = (ref.adjoint() * ref).inverse() * ref.adjoint();
+  contributions = VectorXd::Zero(nchol);
+  MatrixXd cholBuffer;
+  for (int n = commrank; n < nchol; n += commsize) {
+    Eigen::Map<const MatrixXd> cholN = choleskyMatrix(n, cholBuffer);
+    MatrixXcd a = refInvT.leftCols(norbs) * cholN * ref.topRows(norbs) + refInvT.rightCols(norbs) * cholN * ref.bottomRows(norbs);
+    complex<double> coul = a.trace();
+    contributions(n) = ((coul * coul - a.cwiseProduct(a.transpose()).sum()) / 2.).real();
+  }
+  MPI_Allreduce(MPI_IN_PLACE, contributions.data(), nchol, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+};
+
+
+// theta of all walkers is stacked so that thcOrbs * theta is a single gemm
+void Hamiltonian::thcCoulombExchange(Eigen::MatrixXd& rotOrbs, std::vector<Eigen::MatrixXcd*>& theta, Eigen::MatrixXcd& coulomb, Eigen::VectorXcd* exchange)
+{
+  int nwalk = theta.size(), nocc = theta[0]->cols();
+  MatrixXcd thetaStacked(norbs, nwalk * nocc);
+  for (int w = 0; w < nwalk; w++) thetaStacked.middleCols(w * nocc, nocc) = *theta[w];
+  MatrixXcd rotTheta = thcOrbs * thetaStacked;
+  MatrixXcd rho(thcOrbs.rows(), nwalk);
+  for (int w = 0; w < nwalk; w++) rho.col(w) = rotTheta.middleCols(w * nocc, nocc).cwiseProduct(rotOrbs).rowwise().sum();
+  coulomb.noalias() = thcU.transpose() * rho;
+  if (exchange == nullptr) return;
+  exchange->resize(nwalk);
+  for (int w = 0; w < nwalk; w++) {
+    MatrixXcd m = rotOrbs * rotTheta.middleCols(w * nocc, nocc).transpose();
+    (*exchange)(w) = m.cwiseProduct(m.transpose()).cwiseProduct(thcV).sum();
+  }
+};
+
+
+void Hamiltonian::thcVHS(const Eigen::VectorXcd& fields, Eigen::MatrixXcd& propc)
+{
+  VectorXd diagr = thcU * fields.real();
+  VectorXd diagi = thcU * fields.imag();
+  MatrixXd propr = thcOrbs.transpose() * diagr.asDiagonal() * thcOrbs;
+  MatrixXd propi = thcOrbs.transpose() * diagi.asDiagonal() * thcOrbs;
+  propc = complex<double>(0., 1.) * propr - propi;
+};
+
+
 // for multislater where rotation <-> block
 void Hamiltonian::blockCholesky(std::vector<Eigen::Map<Eigen::MatrixXd>>& blockChol, int ncol)
 {
   double* rotCholSHM;
   double* rotChol0;
   size_t rotSize = ncol * norbs;
-  size_t size = chol.size() * rotSize;
+  size_t size = nchol * rotSize;
 
   if (commrank == 0) {
     rotChol0 = new double[size];
-    for (int i = 0; i < chol.size(); i++) {
-      MatrixXd rot = chol[i].block(0, 0, norbs, ncol);
+    MatrixXd cholBuffer;
+    for (int i = 0; i < nchol; i++) {
+      MatrixXd rot = choleskyMatrix(i, cholBuffer).block(0, 0, norbs, ncol);
       for (int nu = 0; nu < rot.cols(); nu++)
         for (int mu = 0; mu < rot.rows(); mu++)
           rotChol0[i * rotSize + nu * rot.rows() + mu] = rot(mu, nu);
@@ -204,17 +394,50 @@ void Hamiltonian::floattenCholesky()
   SHMVecFromVecs(floatChol0, size, floatChol, floatCholSHMName, floatCholSegment, floatCholRegion); 
   MPI_Barrier(MPI_COMM_WORLD);
     
-  if (intType == "r" || intType == "g") {
-    Eigen::Map<Eigen::MatrixXf> floatCholMatMap(static_cast<float*>(floatChol), triSize, nchol);
-    floatCholMat.push_back(floatCholMatMap);
-  }
-  else if (intType == "u") {
-    Eigen::Map<Eigen::MatrixXf> floatCholMatUp(static_cast<float*>(floatChol), triSize, nchol);
-    floatCholMat.push_back(floatCholMatUp);
-    Eigen::Map<Eigen::MatrixXf> floatCholMatDn(static_cast<float*>(floatChol) + size/2, triSize, nchol);
-    floatCholMat.push_back(floatCholMatDn);
-  }
+  mapPackedCholesky();
   
   if (commrank == 0) delete [] floatChol0; 
 
 };
+
+
+void Hamiltonian::mapPackedCholesky()
+{
+  size_t triSize = (norbs * (norbs + 1)) / 2;
+  int nspin = (intType == "u") ? 2 : 1;
+  for (int sz = 0; sz < nspin; sz++) {
+    if (packedChol != nullptr) {
+      Eigen::Map<Eigen::MatrixXd> packedCholMatMap(packedChol + sz * nchol * triSize, triSize, nchol);
+      packedCholMat.push_back(packedCholMatMap);
+    }
+    else {
+      Eigen::Map<Eigen::MatrixXf> floatCholMatMap(floatChol + sz * nchol * triSize, triSize, nchol);
+      floatCholMat.push_back(floatCholMatMap);
+    }
+  }
+};
+
+
+// the segments are shrunk to zero so that their pages are returned to the node
+void Hamiltonian::releaseFullCholesky()
+{
+  if (cholStorage != "full" || socQ) return;
+  chol.clear();
+  cholMat.clear();
+  cholu.clear();
+  MPI_Barrier(MPI_COMM_WORLD);
+  if (intType == "u") {
+    cholRegionUp = boost::interprocess::mapped_region();
+    cholRegionDn = boost::interprocess::mapped_region();
+  }
+  else cholRegion = boost::interprocess::mapped_region();
+  MPI_Barrier(MPI_COMM_WORLD);
+  if (localrank == 0) {
+    if (intType == "u") {
+      cholSegmentUp.truncate(0);
+      cholSegmentDn.truncate(0);
+    }
+    else cholSegment.truncate(0);
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+};
@@ -15,27 +15,69 @@ class Hamiltonian {
     std::vector<std::array<Eigen::Map<Eigen::MatrixXd>, 2>> cholu;
     float* floatChol;
     std::vector<Eigen::Map<Eigen::MatrixXf>> floatCholMat;
+    double* packedChol;          // packed double cholesky for cholStorage double, null otherwise
+    std::vector<Eigen::Map<Eigen::MatrixXd>> packedCholMat;
+    std::string cholStorage;     // full (square double and packed float copies) or a single packed copy in double or float
     std::string intType;
     bool socQ;
+    bool thcQ;                   // thc factorized integrals instead of cholesky vectors
+    Eigen::MatrixXd thcOrbs;     // nthc x norbs
+    Eigen::MatrixXd thcV;        // nthc x nthc central tensor
+    Eigen::MatrixXd thcU;        // thcV = thcU * thcU^T, nthc x nchol, one field per column
     double ecore;
-    bool rotFlag;
+    bool rotFlag;                // the left state evaluates energies with its rotated cholesky only
     int norbs, nalpha, nbeta, nelec, ncholEne, nchol;
+    std::vector<int> cholEneOrder;   // importance order of cholesky vectors for energy evaluation, file order if empty
 
     // constructor
-    Hamiltonian(std::string fname, bool psocQ = false, std::string pintType = "r");
+    Hamiltonian(std::string fname, bool psocQ = false, std::string pintType = "r", bool pthcQ = false, std::string pcholStorage = "full");
 
     void setNcholEne(int pnchol);
 
+    // index of the i-th cholesky vector used in energy evaluation, i < ncholEne
+    int cholEneIndex(int i) const { return cholEneOrder.empty() ? i : cholEneOrder[i]; }
+
+    // cholesky vector n (spin sz for u) as a square matrix, maps the full copy if it is stored
+    // and unpacks the packed copy into buffer otherwise or if packedQ
+    Eigen::Map<const Eigen::MatrixXd> choleskyMatrix(int n, Eigen::MatrixXd& buffer, int sz = 0, bool packedQ = false) const;
+
+    // two body energy contribution (J_n^2 - K_n) / 2 of each cholesky vector in a reference determinant
+    // spin pair for r and u, ghf determinant (2 norbs x nelec) for g and soc
+    void cholEnergyContributions(std::array<Eigen::MatrixXcd, 2>& ref, Eigen::VectorXd& contributions);
+    void cholEnergyContributions(Eigen::MatrixXcd& ref, Eigen::VectorXd& contributions);
+
     // rotate cholesky
     void rotateCholesky(Eigen::MatrixXd& phiT, std::vector<Eigen::Map<Eigen::MatrixXd>>& rotChol, std::vector<Eigen::Map<Eigen::MatrixXd>>& rotCholMat, bool deleteOriginalChol=false);
     void rotateCholesky(std::array<Eigen::MatrixXd, 2>& phiT, std::array<std::vector<Eigen::Map<Eigen::MatrixXd>>, 2>& rotChol, std::array<std::vector<Eigen::Map<Eigen::MatrixXd>>, 2>& rotCholMat, bool deleteOriginalChol=false);
     void rotateCholesky(Eigen::MatrixXcd& phiAd, std::vector<std::array<Eigen::MatrixXcd, 2>>& rotChol);
+
+    // two body energy contractions of rotated cholesky vectors with a batch of theta matrices
+    // coulomb(i, w) = tr(rotChol[cholEneIndex(i)] * theta_w) for the first ncholEne vectors, a single gemm
+    void rotatedCoulomb(Eigen::Map<Eigen::MatrixXd>& rotCholMat, std::vector<Eigen::MatrixXcd*>& theta, Eigen::MatrixXcd& coulomb);
+    // exchange(w) = sum_i tr((rotChol[i] * theta_w)^2), cholesky vectors are stacked in memory bounded blocks
+    void rotatedExchange(std::vector<Eigen::Map<Eigen::MatrixXd>>& rotChol, std::vector<Eigen::MatrixXcd*>& theta, Eigen::VectorXcd& exchange);
     
+    // thc analogues of rotatedCoulomb and rotatedExchange, rotOrbs = thcOrbs * trial orbitals (nthc x nocc)
+    // coulomb(i, w) = sum_P thcU(P, i) rho_w(P) with rho_w(P) = (thcOrbs * theta_w)(P, :) . rotOrbs(P, :)
+    // exchange(w) = sum_PQ thcV_PQ M_PQ M_QP with M = rotOrbs * (thcOrbs * theta_w)^T, skipped if null
+    // O(nthc * norbs * nocc + nthc^2 * nocc) per walker
+    void thcCoulombExchange(Eigen::MatrixXd& rotOrbs, std::vector<Eigen::MatrixXcd*>& theta, Eigen::MatrixXcd& coulomb, Eigen::VectorXcd* exchange = nullptr);
+
+    // propc = i sum_n fields_n L_n = i thcOrbs^T diag(thcU * fields) thcOrbs
+    void thcVHS(const Eigen::VectorXcd& fields, Eigen::MatrixXcd& propc);
+
     // block cholesky
     // for multislater where rotation <-> block
     void blockCholesky(std::vector<Eigen::Map<Eigen::MatrixXd>>& blockChol, int ncol);
 
     // flatten and convert to float
     void floattenCholesky();
+
+    // eigen maps to the packed copy, triSize x nchol for each spin
+    void mapPackedCholesky();
+
+    // unmaps the full cholesky once setup is done and the left state only reads its rotated copy (rotFlag),
+    // propagation reads the packed float copy
+    void releaseFullCholesky();
 };
 #endif
@@ -17,14 +17,16 @@ KSGHF::KSGHF(Hamiltonian& ham, bool pleftQ, std::string fname)
   detT = det.transpose();
   leftQ = pleftQ;
   if (leftQ) {
+    MatrixXd cholBuffer;
     for (int i = 0; i < ham.nchol; i++) {
-      MatrixXcd rotUp = detT.block(0, 0, nelec, norbs) * ham.chol[i];
-      MatrixXcd rotDn = detT.block(0, norbs, nelec, norbs)  * ham.chol[i];
+      Eigen::Map<const MatrixXd> cholN = ham.choleskyMatrix(i, cholBuffer);
+      MatrixXcd rotUp = detT.block(0, 0, nelec, norbs) * cholN;
+      MatrixXcd rotDn = detT.block(0, norbs, nelec, norbs)  * cholN;
       rotCholT[0].push_back(rotUp);
       rotCholT[1].push_back(rotDn);
 
-      rotUp = detAd.block(0, 0, nelec, norbs) * ham.chol[i];
-      rotDn = detAd.block(0, norbs, nelec, norbs) * ham.chol[i];
+      rotUp = detAd.block(0, 0, nelec, norbs) * cholN;
+      rotDn = detAd.block(0, norbs, nelec, norbs) * cholN;
       rotCholAd[0].push_back(rotUp);
       rotCholAd[1].push_back(rotDn);
     }
@@ -1,5 +1,9 @@
 #include <iostream>
 #include <iomanip>
+#include <sstream>
+#include <cstdio>
+#include <algorithm>
+#include <numeric>
 #include "global.h"
 #include "input.h"
 #include "DQMCStatistics.h"
@@ -49,10 +53,10 @@ std::array<double, 2> blocking(const ArrayXd& weights, const ArrayXd& energies,
 }
 
 
-void writeOneRDM(Eigen::MatrixXd oneRDM, double cumulativeWeight) 
+void writeOneRDM(Eigen::MatrixXd oneRDM, double cumulativeWeight, std::string name = "rdm") 
 {
   std::string scratch_dir = schd.scratchDir;
-  string fname = scratch_dir + "/rdm_";
+  string fname = scratch_dir + "/" + name + "_";
   fname.append(to_string(commrank));
   fname.append(".dat");
   ofstream rdmdump(fname);
@@ -67,11 +71,11 @@ void writeOneRDM(Eigen::MatrixXd oneRDM, double cumulativeWeight)
 }
 
 
-void writeOneRDM(std::array<Eigen::MatrixXd, 2> oneRDM, double cumulativeWeight) 
+void writeOneRDM(std::array<Eigen::MatrixXd, 2> oneRDM, double cumulativeWeight, std::string name = "rdm") 
 {
   std::string scratch_dir = schd.scratchDir;
   {
-    string fname = scratch_dir + "/rdm_up_";
+    string fname = scratch_dir + "/" + name + "_up_";
     fname.append(to_string(commrank));
     fname.append(".dat");
     ofstream rdmdump(fname);
@@ -91,7 +95,7 @@ void writeOneRDM(std::array<Eigen::MatrixXd, 2> oneRDM, double cumulativeWeight)
   }
   
   {
-    string fname = scratch_dir + "/rdm_dn_";
+    string fname = scratch_dir + "/" + name + "_dn_";
     fname.append(to_string(commrank));
     fname.append(".dat");
     ofstream rdmdump(fname);
@@ -112,6 +116,52 @@ void writeOneRDM(std::array<Eigen::MatrixXd, 2> oneRDM, double cumulativeWeight)
 }
 
 
+// truncates the cholesky vectors used in energy evaluation after ranking them by their energy contribution
+// in the reference state, the smallest prefix with a dropped contribution below the threshold is used
+// and grown until the measured bias in the trial energy is also below it, returns the number of vectors
+template <typename RefType> int rankCholesky(Wavefunction& waveLeft, RefType& ref, Hamiltonian& ham, complex<double> refEnergy, complex<double>& delta, ostream& out, string prefix)
+{
+  int nchol = ham.nchol;
+  VectorXd contributions;
+  ham.cholEnergyContributions(ref, contributions);
+  vector<int> order(nchol);
+  iota(order.begin(), order.end(), 0);
+  stable_sort(order.begin(), order.end(), [&contributions](int a, int b) { return abs(contributions(a)) > abs(contributions(b)); });
+  ham.cholEneOrder = order;
+
+  // dropped[k]: absolute contribution of the vectors after the first k
+  VectorXd dropped = VectorXd::Zero(nchol + 1);
+  for (int k = nchol - 1; k >= 0; k--) dropped(k) = dropped(k + 1) + abs(contributions(order[k]));
+  int ncholEne = 1;
+  while (ncholEne < nchol && dropped(ncholEne) >= schd.choleskyThreshold) ncholEne++;
+  double predictedBias = 0.;
+  for (int k = ncholEne; k < nchol; k++) predictedBias += contributions(order[k]);
+
+  int step = max(1, nchol / 20);
+  complex<double> trefEnergy = refEnergy;
+  while (ncholEne < nchol) {
+    ham.setNcholEne(ncholEne);
+    auto thamOverlap = waveLeft.hamAndOverlap(ref, ham);
+    trefEnergy = thamOverlap[0] / thamOverlap[1];
+    if (abs(refEnergy - trefEnergy) < schd.choleskyThreshold) break;
+    ncholEne = min(nchol, ncholEne + step);
+  }
+  if (ncholEne == nchol) {
+    ham.cholEneOrder.clear();
+    trefEnergy = refEnergy;
+  }
+  delta = refEnergy - trefEnergy;
+  if (commrank == 0) {
+    out << prefix << "Using ranked Cholesky with " << ncholEne << " vectors for energy calculations\n";
+    out << prefix << "Predicted truncation bias:  " << -predictedBias << endl;
+    out << prefix << "Measured truncation bias:  " << -delta.real() << endl;
+    out << prefix << "Initial state energy with truncated Cholesky:  " << trefEnergy << endl;
+    out.flush();
+  }
+  return ncholEne;
+};
+
+
 void calcMixedEstimator(Wavefunction& waveLeft, Wavefunction& waveRight, DQMCWalker& walker, Hamiltonian& ham)
 {
   int norbs = ham.norbs;
@@ -142,7 +192,9 @@ void calcMixedEstimator(Wavefunction& waveLeft, Wavefunction& waveRight, DQMCWal
   int nchol = ham.nchol;
   complex<double> delta(0., 0.);
   if (commrank == 0) cout << "Number of Cholesky vectors: " << nchol << endl;
-  vector<int> ncholVec = { int(0.3 * nchol), int(0.4 * nchol), int(0.5 * nchol), int(0.6 * nchol), int(0.7 * nchol) };
+  vector<int> ncholVec;
+  if (schd.choleskyRanking) nchol = rankCholesky(waveLeft, ref, ham, refEnergy, delta, cout, "");
+  else ncholVec = { int(0.3 * nchol), int(0.4 * nchol), int(0.5 * nchol), int(0.6 * nchol), int(0.7 * nchol) };
   for (int i = 0; i < ncholVec.size(); i++) {
     ham.setNcholEne(ncholVec[i]);
     auto thamOverlap = waveLeft.hamAndOverlap(ref, ham);
@@ -160,6 +212,7 @@ void calcMixedEstimator(Wavefunction& waveLeft, Wavefunction& waveRight, DQMCWal
   ham.setNcholEne(nchol);
   
   walker.prepProp(ref, ham, dt, ene0.real());
+  if (ham.rotFlag) ham.releaseFullCholesky();
   int nEneSteps = eneSteps.size();
   DQMCStatistics stats(nEneSteps);
   auto iterTime = getTime();
@@ -246,7 +299,9 @@ void calcMixedEstimatorNoProp(Wavefunction& waveLeft, Wavefunction& waveRight, D
   int nchol = ham.nchol;
   complex<double> delta(0., 0.);
   if (commrank == 0) cout << "Number of Cholesky vectors: " << nchol << endl;
-  vector<int> ncholVec = { int(0.3 * nchol), int(0.4 * nchol), int(0.5 * nchol), int(0.6 * nchol), int(0.7 * nchol) };
+  vector<int> ncholVec;
+  if (schd.choleskyRanking) nchol = rankCholesky(waveLeft, ref, ham, refEnergy, delta, cout, "");
+  else ncholVec = { int(0.3 * nchol), int(0.4 * nchol), int(0.5 * nchol), int(0.6 * nchol), int(0.7 * nchol) };
   for (int i = 0; i < ncholVec.size(); i++) {
     ham.setNcholEne(ncholVec[i]);
     auto thamOverlap = waveLeft.hamAndOverlap(ref, ham);
@@ -306,22 +361,331 @@ void calcMixedEstimatorNoProp(Wavefunction& waveLeft, Wavefunction& waveRight, D
 };
 
 
-void calcMixedEstimatorLongProp(Wavefunction& waveLeft, Wavefunction& waveRight, Wavefunction& waveGuide, DQMCWalker& walker, Hamiltonian& ham)
+// binary checkpoint helpers
+template <typename T> void writeBinary(ofstream& file, const T& val)
+{
+  file.write(reinterpret_cast<const char*>(&val), sizeof(T));
+}
+
+
+template <typename T> void readBinary(ifstream& file, T& val)
+{
+  file.read(reinterpret_cast<char*>(&val), sizeof(T));
+}
+
+
+template <typename Derived> void writeBinaryMat(ofstream& file, const Eigen::DenseBase<Derived>& mat)
+{
+  long rows = mat.rows(), cols = mat.cols();
+  writeBinary(file, rows);
+  writeBinary(file, cols);
+  typename Derived::PlainObject matCopy = mat;
+  file.write(reinterpret_cast<const char*>(matCopy.data()), rows * cols * sizeof(typename Derived::Scalar));
+}
+
+
+template <typename Derived> void readBinaryMat(ifstream& file, Eigen::PlainObjectBase<Derived>& mat)
+{
+  long rows, cols;
+  readBinary(file, rows);
+  readBinary(file, cols);
+  mat.resize(rows, cols);
+  file.read(reinterpret_cast<char*>(mat.data()), rows * cols * sizeof(typename Derived::Scalar));
+}
+
+
+// random engines and distributions are stored through their text representation
+template <typename T> void writeRandomState(ofstream& file, const T& engine)
+{
+  ostringstream ss;
+  ss << engine;
+  string state = ss.str();
+  long length = state.size();
+  writeBinary(file, length);
+  file.write(state.data(), length);
+}
+
+
+template <typename T> void readRandomState(ifstream& file, T& engine)
+{
+  long length;
+  readBinary(file, length);
+  string state(length, ' ');
+  file.read(&state[0], length);
+  istringstream ss(state);
+  ss >> engine;
+}
+
+
+string checkpointName(int rank) 
+{
+  return schd.scratchDir + "/afqmc_checkpoint_" + to_string(rank) + ".bin";
+}
+
+
+// step and number of processes of the last complete set of checkpoints
+string checkpointManifestName() 
+{
+  return schd.scratchDir + "/afqmc_checkpoint.manifest";
+}
+
+
+// per process binary checkpoint of the phaseless state, written after reconfiguration
+// the files are written under temporary names and renamed only once all processes have written theirs,
+// the manifest naming the step is written last so that an interrupted checkpoint is detected on restart
+// layout: header, weights, walker determinants (fixed size records), accumulators, estimators, random states
+void writeCheckpoint(int step, vector<DQMCWalker>& walkers, ArrayXd& weights, int matSize, vector<double>& accumulators, 
+                     ArrayXd& totalWeights, ArrayXd& totalEnergies, MatrixXd& oneRDM, std::array<MatrixXd, 2>& oneRDMU)
+{
+  string fname = checkpointName(commrank);
+  string tmpName = fname + ".tmp";
+  ofstream file(tmpName, ios::binary);
+  int nwalk = walkers.size();
+  writeBinary(file, commsize);
+  writeBinary(file, nwalk);
+  writeBinary(file, matSize);
+  writeBinary(file, step);
+  file.write(reinterpret_cast<const char*>(weights.data()), nwalk * sizeof(double));
+  vector<complex<double>> serialw(matSize, complex<double>(0., 0.));
+  for (int w = 0; w < nwalk; w++) {
+    complex<double> overlap = walkers[w].getDet(serialw);
+    file.write(reinterpret_cast<const char*>(serialw.data()), matSize * sizeof(complex<double>));
+    writeBinary(file, overlap);
+    writeBinary(file, walkers[w].orthoFac);
+  }
+  long naccumulators = accumulators.size();
+  writeBinary(file, naccumulators);
+  file.write(reinterpret_cast<const char*>(accumulators.data()), naccumulators * sizeof(double));
+  writeBinaryMat(file, totalWeights);
+  writeBinaryMat(file, totalEnergies);
+  writeBinaryMat(file, oneRDM);
+  writeBinaryMat(file, oneRDMU[0]);
+  writeBinaryMat(file, oneRDMU[1]);
+  writeRandomState(file, generator);
+  for (int w = 0; w < nwalk; w++) {
+    writeRandomState(file, walkers[w].normal);
+    writeRandomState(file, walkers[w].walkerGenerator);
+  }
+  file.close();
+  int writtenQ = file ? 1 : 0;
+  MPI_Allreduce(MPI_IN_PLACE, &writtenQ, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+  if (!writtenQ) {
+    if (commrank == 0) cout << "Error writing checkpoint at step " << step << ", keeping the previous one\n";
+    std::remove(tmpName.c_str());
+    return;
+  }
+  std::rename(tmpName.c_str(), fname.c_str());
+  MPI_Barrier(MPI_COMM_WORLD);
+  if (commrank == 0) {
+    string manifestName = checkpointManifestName();
+    ofstream manifest(manifestName + ".tmp");
+    manifest << step << "  " << commsize << endl;
+    manifest.close();
+    std::rename((manifestName + ".tmp").c_str(), manifestName.c_str());
+  }
+}
+
+
+// reads the checkpoint written by writeCheckpoint and returns the step it was written at
+// with the same number of processes and walkers the state is restored exactly
+// otherwise walkers are redistributed cyclically over the new processes with equal weights
+// and random states are reseeded
+int readCheckpoint(vector<DQMCWalker>& walkers, ArrayXd& weights, int matSize, vector<double>& accumulators, 
+                   ArrayXd& totalWeights, ArrayXd& totalEnergies, MatrixXd& oneRDM, std::array<MatrixXd, 2>& oneRDMU)
+{
+  int nwalk = walkers.size();
+  int oldCommsize, oldNwalk, oldMatSize, step;
+  ifstream manifest(checkpointManifestName());
+  manifest >> step >> oldCommsize;
+  if (!manifest) {
+    if (commrank == 0) cout << "Checkpoint manifest " << checkpointManifestName() << " not found\n";
+    exit(0);
+  }
+  manifest.close();
+  // every process checks all headers, so that they all stop on an incomplete set
+  for (int rank = 0; rank < oldCommsize; rank++) {
+    int fileCommsize = -1, fileNwalk, fileMatSize, fileStep = -1;
+    ifstream header(checkpointName(rank), ios::binary);
+    readBinary(header, fileCommsize);
+    readBinary(header, fileNwalk);
+    readBinary(header, fileMatSize);
+    readBinary(header, fileStep);
+    if (!header || fileCommsize != oldCommsize || fileStep != step || (rank > 0 && fileNwalk != oldNwalk)) {
+      if (commrank == 0) cout << "Checkpoint " << checkpointName(rank) << " is missing or not from step " << step << "\n";
+      exit(0);
+    }
+    if (rank == 0) {
+      oldNwalk = fileNwalk;
+      oldMatSize = fileMatSize;
+    }
+  }
+  if (oldMatSize != matSize) {
+    if (commrank == 0) cout << "Checkpoint walker size does not match\n";
+    exit(0);
+  }
+  bool sameQ = (oldCommsize == commsize && oldNwalk == nwalk);
+  size_t headerSize = 3 * sizeof(int) + sizeof(int);
+  size_t walkerSize = (matSize + 2) * sizeof(complex<double>);
+
+  // accumulators and estimators, from the same process or cyclically from the old ones
+  int oldRank = commrank % oldCommsize;
+  ifstream file(checkpointName(oldRank), ios::binary);
+  file.seekg(headerSize + oldNwalk * (sizeof(double) + walkerSize));
+  long naccumulators;
+  readBinary(file, naccumulators);
+  accumulators.resize(naccumulators);
+  file.read(reinterpret_cast<char*>(accumulators.data()), naccumulators * sizeof(double));
+  // the number of blocks may have been changed for the restarted run
+  ArrayXd oldTotalWeights, oldTotalEnergies;
+  readBinaryMat(file, oldTotalWeights);
+  readBinaryMat(file, oldTotalEnergies);
+  int nblocks = min(oldTotalWeights.size(), totalWeights.size());
+  totalWeights.head(nblocks) = oldTotalWeights.head(nblocks);
+  totalEnergies.head(nblocks) = oldTotalEnergies.head(nblocks);
+  readBinaryMat(file, oneRDM);
+  readBinaryMat(file, oneRDMU[0]);
+  readBinaryMat(file, oneRDMU[1]);
+  
+  vector<complex<double>> serialw(matSize, complex<double>(0., 0.));
+  if (sameQ) {
+    readRandomState(file, generator);
+    for (int w = 0; w < nwalk; w++) {
+      readRandomState(file, walkers[w].normal);
+      readRandomState(file, walkers[w].walkerGenerator);
+    }
+    file.seekg(headerSize);
+    file.read(reinterpret_cast<char*>(weights.data()), nwalk * sizeof(double));
+    for (int w = 0; w < nwalk; w++) {
+      complex<double> overlap;
+      file.read(reinterpret_cast<char*>(serialw.data()), matSize * sizeof(complex<double>));
+      readBinary(file, overlap);
+      walkers[w].setDet(serialw, overlap);
+      readBinary(file, walkers[w].orthoFac);
+    }
+  }
+  else {
+    // checkpoints are written after reconfiguration, so all weights are equal
+    // accumulators[1] is the total weight per process
+    double totalCumulativeWeight = accumulators[1] * oldCommsize;
+    int nwalkOld = oldCommsize * oldNwalk;
+    for (int w = 0; w < nwalk; w++) {
+      int src = (commrank * nwalk + w) % nwalkOld;
+      ifstream srcFile(checkpointName(src / oldNwalk), ios::binary);
+      srcFile.seekg(headerSize + oldNwalk * sizeof(double) + (src % oldNwalk) * walkerSize);
+      complex<double> overlap;
+      srcFile.read(reinterpret_cast<char*>(serialw.data()), matSize * sizeof(complex<double>));
+      readBinary(srcFile, overlap);
+      walkers[w].setDet(serialw, overlap);
+      readBinary(srcFile, walkers[w].orthoFac);
+      weights[w] = totalCumulativeWeight / commsize / nwalk;
+      if (walkers[w].walkerGeneratorQ) walkers[w].seedGenerator(schd.seed + step, commrank, w);
+    }
+    accumulators[1] = totalCumulativeWeight / commsize;
+    generator.seed(schd.seed + step + commrank);
+  }
+  file.close();
+  return step;
+}
+
+
+// stochastic comb over the walkers of all processes
+// only weights are gathered, every process computes the comb and walkers are sent directly
+// to the processes that need them, walkers that stay in place are not copied
+// zeta < 0: the comb offset is drawn here, otherwise the given offset is used (the same on all processes)
+void reconfigure(vector<DQMCWalker>& walkers, ArrayXd& weights, int matSize, double& totalWeight, bool nanQ, double zeta = -1.)
+{
+  int nwalk = walkers.size();
+  int nwalkTotal = commsize * nwalk;
+  vector<double> weightsGather(nwalkTotal, 0.);
+  MPI_Allgather(weights.data(), nwalk, MPI_DOUBLE, weightsGather.data(), nwalk, MPI_DOUBLE, MPI_COMM_WORLD);
+  if (commrank == 0 && nanQ) {
+    cout << "\nweights:  ";
+    for (int i = 0; i < weightsGather.size(); i++) cout << weightsGather[i] << "  ";
+    cout << endl << endl;
+    exit(0);
+  }
+  
+  // comb, zeta is drawn on the root so the random stream is the same as for a serial comb
+  vector<double> cumulativeWeights(nwalkTotal, 0.);
+  cumulativeWeights[0] = weightsGather[0];
+  for (int i = 1; i < nwalkTotal; i++) cumulativeWeights[i] = cumulativeWeights[i - 1] + weightsGather[i];
+  double totalCumulativeWeight = cumulativeWeights[nwalkTotal - 1];
+  if (zeta < 0.) {
+    zeta = 0.;
+    if (commrank == 0) {
+      std::uniform_real_distribution<double> uniform = std::uniform_real_distribution<double>(0., 1.);
+      zeta = uniform(generator);
+    }
+    MPI_Bcast(&zeta, 1, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+  }
+  vector<int> source(nwalkTotal);
+  for (int w = 0; w < nwalkTotal; w++) {
+    double z = (w + zeta) / nwalk / commsize;
+    source[w] = std::lower_bound(cumulativeWeights.begin(), cumulativeWeights.end(), z * totalCumulativeWeight) - cumulativeWeights.begin();
+  }
+
+  // pack walkers needed by other processes, ordered by destination
+  // each walker is sent as its determinant followed by its trial overlap
+  int packSize = matSize + 1;
+  vector<int> sendCounts(commsize, 0), recvCounts(commsize, 0), sendDispls(commsize, 0), recvDispls(commsize, 0);
+  vector<complex<double>> sendBuffer, serialw(matSize, complex<double>(0., 0.));
+  for (int proc = 0; proc < commsize; proc++) {
+    if (proc == commrank) continue;
+    for (int w = proc * nwalk; w < (proc + 1) * nwalk; w++) {
+      if (source[w] / nwalk != commrank) continue;
+      complex<double> overlap = walkers[source[w] % nwalk].getDet(serialw);
+      sendBuffer.insert(sendBuffer.end(), serialw.begin(), serialw.end());
+      sendBuffer.push_back(overlap);
+      sendCounts[proc] += packSize;
+    }
+  }
+  for (int w = commrank * nwalk; w < (commrank + 1) * nwalk; w++) 
+    if (source[w] / nwalk != commrank) recvCounts[source[w] / nwalk] += packSize;
+  for (int proc = 1; proc < commsize; proc++) {
+    sendDispls[proc] = sendDispls[proc - 1] + sendCounts[proc - 1];
+    recvDispls[proc] = recvDispls[proc - 1] + recvCounts[proc - 1];
+  }
+  vector<complex<double>> recvBuffer(recvDispls[commsize - 1] + recvCounts[commsize - 1]);
+  sendBuffer.resize(max(sendBuffer.size(), size_t(1)));
+  recvBuffer.resize(max(recvBuffer.size(), size_t(1)));
+  MPI_Alltoallv(sendBuffer.data(), sendCounts.data(), sendDispls.data(), MPI_DOUBLE_COMPLEX, recvBuffer.data(), recvCounts.data(), recvDispls.data(), MPI_DOUBLE_COMPLEX, MPI_COMM_WORLD);
+
+  // local copies are taken before any walker on this process is overwritten
+  vector<vector<complex<double>>> localSerial(nwalk);
+  vector<complex<double>> localOverlaps(nwalk);
+  for (int w = commrank * nwalk; w < (commrank + 1) * nwalk; w++) {
+    int src = source[w] - commrank * nwalk;
+    if (src == w - commrank * nwalk || source[w] / nwalk != commrank || localSerial[src].size() > 0) continue;
+    localSerial[src] = vector<complex<double>>(matSize);
+    localOverlaps[src] = walkers[src].getDet(localSerial[src]);
+  }
+  
+  // unpack
+  vector<int> recvOffsets = recvDispls;
+  for (int w = commrank * nwalk; w < (commrank + 1) * nwalk; w++) {
+    int local = w - commrank * nwalk;
+    int proc = source[w] / nwalk;
+    if (proc != commrank) {
+      for (int i = 0; i < matSize; i++) serialw[i] = recvBuffer[recvOffsets[proc] + i];
+      walkers[local].setDet(serialw, recvBuffer[recvOffsets[proc] + matSize]);
+      recvOffsets[proc] += packSize;
+    }
+    else if (source[w] != w) walkers[local].setDet(localSerial[source[w] % nwalk], localOverlaps[source[w] % nwalk]);
+    weights[local] = totalCumulativeWeight / commsize / nwalk;
+  }
+  totalWeight = totalCumulativeWeight / commsize;
+};
+
+
+// reads the reference state, prints its energy and truncates the cholesky vectors used for
+// the local energy, delta is the energy correction for the truncation
+// returns the energy of the reference state
+static complex<double> prepPhaseless(Wavefunction& waveLeft, DQMCWalker& walker, Hamiltonian& ham, ofstream& afqmcFile, matPair& ref, MatrixXcd& refSOC, complex<double>& delta)
 {
   int norbs = ham.norbs;
   int nalpha = ham.nalpha;
   int nbeta = ham.nbeta;
   int nelec = ham.nelec;
-  size_t nsweeps = schd.stochasticIter;  // number of energy evaluations
-  size_t nsteps = schd.nsteps;           // number of steps per energy evaluation
-  size_t nburn = schd.burnIter;          // number of equilibration steps
-  size_t orthoSteps = schd.orthoSteps;
-  size_t nwalk = schd.nwalk;             // number of walkers per process
-  double dt = schd.dt;
-  ofstream afqmcFile("afqmc.dat", ios::app);
-
-  matPair ref;
-  MatrixXcd refSOC;
   std::array<std::complex<double>, 2> hamOverlap;
   if (schd.soc) {
     MatrixXcd hf = MatrixXcd::Zero(2*norbs, 2*norbs);
@@ -352,18 +716,21 @@ void calcMixedEstimatorLongProp(Wavefunction& waveLeft, Wavefunction& waveRight,
     hamOverlap = waveLeft.hamAndOverlap(ref, ham);
   }
   complex<double> refEnergy = hamOverlap[0] / hamOverlap[1];
-  complex<double> ene0;
-  if (schd.ene0Guess == 1.e10) ene0 = refEnergy;
-  else ene0 = schd.ene0Guess;
   if (commrank == 0) {
     afqmcFile << "# Initial state energy:  " << refEnergy.real() << endl;
     afqmcFile.flush();
   }
   
   int nchol = ham.nchol;
-  complex<double> delta(0., 0.);
+  delta = complex<double>(0., 0.);
   if (commrank == 0) afqmcFile << "# Number of Cholesky vectors: " << nchol << endl;
-  vector<int> ncholVec = { int(0.3 * nchol), int(0.4 * nchol), int(0.5 * nchol), int(0.6 * nchol), int(0.7 * nchol) };
+  // the thc energy does not depend on ncholEne
+  vector<int> ncholVec;
+  if (!ham.thcQ && schd.choleskyRanking) {
+    if (walker.szQ) nchol = rankCholesky(waveLeft, refSOC, ham, refEnergy, delta, afqmcFile, "# ");
+    else nchol = rankCholesky(waveLeft, ref, ham, refEnergy, delta, afqmcFile, "# ");
+  }
+  else if (!ham.thcQ) ncholVec = { int(0.3 * nchol), int(0.4 * nchol), int(0.5 * nchol), int(0.6 * nchol), int(0.7 * nchol) };
   for (int i = 0; i < ncholVec.size(); i++) {
     ham.setNcholEne(ncholVec[i]);
     std::array<complex<double>, 2> thamOverlap;
@@ -387,11 +754,47 @@ void calcMixedEstimatorLongProp(Wavefunction& waveLeft, Wavefunction& waveRight,
     afqmcFile.flush();
   }
 
+  return refEnergy;
+};
+
+
+void calcMixedEstimatorLongProp(Wavefunction& waveLeft, Wavefunction& waveRight, Wavefunction& waveGuide, DQMCWalker& walker, Hamiltonian& ham)
+{
+  int norbs = ham.norbs;
+  int nalpha = ham.nalpha;
+  int nbeta = ham.nbeta;
+  int nelec = ham.nelec;
+  size_t nsweeps = schd.stochasticIter;  // number of energy evaluations
+  size_t nsteps = schd.nsteps;           // number of steps per energy evaluation
+  size_t nburn = schd.burnIter;          // number of equilibration steps
+  size_t orthoSteps = schd.orthoSteps;
+  size_t nwalk = schd.nwalk;             // number of walkers per process
+  double dt = schd.dt;
+  int bpSteps = schd.backPropSteps;      // back propagation window length
+  int bpInterval = schd.backPropFreq * nsteps;
+  if (bpSteps > bpInterval) {
+    if (commrank == 0) cout << "backPropSteps should not be larger than backPropFreq * nsteps\n";
+    exit(0);
+  }
+  ofstream afqmcFile("afqmc.dat", ios::app);
+
+  matPair ref;
+  MatrixXcd refSOC;
+  std::array<std::complex<double>, 2> hamOverlap;
+  complex<double> delta;
+  complex<double> refEnergy = prepPhaseless(waveLeft, walker, ham, afqmcFile, ref, refSOC, delta);
+  complex<double> ene0;
+  if (schd.ene0Guess == 1.e10) ene0 = refEnergy;
+  else ene0 = schd.ene0Guess;
+
   vector<DQMCWalker> walkers;
   ArrayXd weights = ArrayXd::Zero(nwalk);
   ArrayXd localEnergy = ArrayXd::Zero(nwalk);
   ArrayXd totalWeights = ArrayXd::Zero(nsweeps);
   ArrayXd totalEnergies = ArrayXd::Zero(nsweeps);
+  walker.floatQ = schd.floatProp;
+  walker.expProp = PropagatorExp(schd.expMethod, schd.expOrder, schd.expTol);
+  walker.setOrthoMethod(schd.orthoMethod);
   if (walker.szQ) walker.prepProp(refSOC, ham, dt, ene0.real());
   else walker.prepProp(ref, ham, dt, ene0.real());
   auto calcInitTime = getTime();
@@ -407,6 +810,8 @@ void calcMixedEstimatorLongProp(Wavefunction& waveLeft, Wavefunction& waveRight,
       waveRight.getSample(rn);
       walkerCopy.setDet(rn);
     }
+    if (schd.walkerThreads) walkerCopy.seedGenerator(schd.seed, commrank, w);
+    if (bpSteps > 0) walkerCopy.initBackProp(bpSteps, ham.nchol);
     walkers.push_back(walkerCopy);
     weights(w) = 1.;
     walkers[w].overlap(waveLeft);  // this initializes the trialOverlap in the walker, used in propagation
@@ -414,6 +819,8 @@ void calcMixedEstimatorLongProp(Wavefunction& waveLeft, Wavefunction& waveRight,
     hamOverlap = walkers[w].hamAndOverlap(waveLeft, ham);
     localEnergy(w) = (hamOverlap[0]/hamOverlap[1]).real();
   }
+  // setup is done, the full cholesky is no longer read
+  if (ham.rotFlag) ham.releaseFullCholesky();
   
   totalWeights(0) = nwalk * commsize;
   double weightedEnergy = localEnergy.sum();
@@ -449,17 +856,46 @@ void calcMixedEstimatorLongProp(Wavefunction& waveLeft, Wavefunction& waveRight,
   std::array<MatrixXcd, 2> rdmSampleU;
   rdmSampleU[0] = MatrixXcd::Zero(norbs, norbs);
   rdmSampleU[1] = MatrixXcd::Zero(norbs, norbs);
+  MatrixXd oneRDMBP = MatrixXd::Zero(oneRDM.rows(), oneRDM.cols());
+  std::array<MatrixXd, 2> oneRDMUBP = oneRDMU;
+  double cumulativeWeightBP = 0.;
+  int bpWindows = 0;
   double weightCap = 0.;
   if (schd.weightCap > 0) weightCap = schd.weightCap;
   else weightCap = std::max(100., walkers.size() / 10.);
-  for (int step = 1; step < nsweeps * nsteps; step++) {
+  int matSize;
+  if (schd.soc) matSize = 2 * ham.norbs * ham.nelec;
+  else if (walker.szQ) matSize = ham.norbs * ham.nelec;
+  else matSize = ham.norbs * (ham.nalpha  + ham.nbeta);
+  matSize += walkers[0].historySize();
+  int startStep = 1;
+  if (schd.restartAFQMC) {
+    vector<double> accumulators;
+    startStep = readCheckpoint(walkers, weights, matSize, accumulators, totalWeights, totalEnergies, oneRDM, oneRDMU) + 1;
+    eshift = accumulators[0]; totalWeight = accumulators[1]; cumulativeWeight = accumulators[2];
+    averageEnergy = accumulators[3]; averageNum = accumulators[4]; averageDenom = accumulators[5];
+    averageEnergyEql = accumulators[6]; averageNumEql = accumulators[7]; averageDenomEql = accumulators[8];
+    eEstimate = accumulators[9]; nLargeDeviations = accumulators[10]; measureCounter = accumulators[11];
+    if (commrank == 0) {
+      afqmcFile << "# restarting from step " << startStep - 1 << "\n";
+      afqmcFile.flush();
+    }
+  }
+  for (int step = startStep; step < nsweeps * nsteps; step++) {
     // average before eql
     if (step * dt < 10.) averageEnergy = averageEnergyEql;
 
     // propagate
     double init = getTime();
+    if (schd.batchProp) propagatePhaselessBatch(walkers, weights, waveLeft, ham, eshift);
+    else if (schd.walkerThreads) {
+      // walkers use their own random streams, so the result does not depend on the number of threads
+#pragma omp parallel for schedule(dynamic)
+      for (int w = 0; w < walkers.size(); w++) 
+        if (weights[w] > 1.e-8) weights[w] *= walkers[w].propagatePhaseless(waveLeft, ham, eshift);
+    }
     for (int w = 0; w < walkers.size(); w++) {
-      if (weights[w] > 1.e-8) weights[w] *= walkers[w].propagatePhaseless(waveLeft, ham, eshift);
+      if (!schd.batchProp && !schd.walkerThreads && weights[w] > 1.e-8) weights[w] *= walkers[w].propagatePhaseless(waveLeft, ham, eshift);
       if (weights[w] > weightCap) {
         weights[w] = 0.;
         nLargeDeviations++;
@@ -475,7 +911,9 @@ void calcMixedEstimatorLongProp(Wavefunction& waveLeft, Wavefunction& waveRight,
     eshift = eEstimate - 0.1 * log(totalWeight/(nwalk * commsize)) / dt;
 
     // orthogonalize for stability
-    if (step % orthoSteps == 0) {
+    if (schd.orthoCond > 0.) stabilizeWalkers(walkers, weights, schd.orthoCond, orthoSteps, schd.orthoCheckSteps, schd.walkerThreads);
+    else if (step % orthoSteps == 0) {
+#pragma omp parallel for schedule(dynamic) if (schd.walkerThreads)
       for (int w = 0; w < walkers.size(); w++) walkers[w].orthogonalize();
     }
 
@@ -486,19 +924,39 @@ void calcMixedEstimatorLongProp(Wavefunction& waveLeft, Wavefunction& waveRight,
       int block = step / nsteps;
       init = getTime();
       //ArrayXd overlapRatios = ArrayXd::Zero(walkers.size());
+      std::vector<std::array<std::complex<double>, 2>> hamOverlaps;
+      bool rdmQ = (step * dt > 10. && step > schd.burnIter * nsteps);
+      vector<MatrixXcd> rdmSamples;
+      vector<std::array<MatrixXcd, 2>> rdmSamplesU;
+      if (schd.batchProp) hamAndOverlapBatch(walkers, weights, waveLeft, ham, hamOverlaps);
+      if (schd.walkerThreads) {
+        // walker contributions are evaluated in parallel and accumulated below in walker order
+        if (!schd.batchProp) hamOverlaps.resize(walkers.size());
+        if (rdmQ && ham.intType == "u") rdmSamplesU.resize(walkers.size());
+        else if (rdmQ) rdmSamples.resize(walkers.size());
+#pragma omp parallel for schedule(dynamic)
+        for (int w = 0; w < walkers.size(); w++) {
+          if (weights(w) == 0.) continue;
+          if (!schd.batchProp) hamOverlaps[w] = walkers[w].hamAndOverlap(waveLeft, ham);
+          if (rdmQ && ham.intType == "u") walkers[w].oneRDM(waveLeft, rdmSamplesU[w]);
+          else if (rdmQ) walkers[w].oneRDM(waveLeft, rdmSamples[w]);
+        }
+      }
       for (int w = 0; w < walkers.size(); w++) {
         if (weights(w) != 0.) {
           // one rdm
-          if (step * dt > 10. && step > schd.burnIter * nsteps) {
+          if (rdmQ) {
             if (ham.intType == "r" || ham.intType == "g") {
-              walkers[w].oneRDM(waveLeft, rdmSample);
+              if (schd.walkerThreads) rdmSample = rdmSamples[w];
+              else walkers[w].oneRDM(waveLeft, rdmSample);
               oneRDM *= cumulativeWeight;
               oneRDM += weights(w) * rdmSample.real();
               cumulativeWeight += weights(w);
               oneRDM /= cumulativeWeight;
             }
             else if (ham.intType == "u") {
-              walkers[w].oneRDM(waveLeft, rdmSampleU);
+              if (schd.walkerThreads) rdmSampleU = rdmSamplesU[w];
+              else walkers[w].oneRDM(waveLeft, rdmSampleU);
               oneRDMU[0] *= cumulativeWeight;
               oneRDMU[1] *= cumulativeWeight;
               oneRDMU[0] += weights(w) * rdmSampleU[0].real();
@@ -510,7 +968,7 @@ void calcMixedEstimatorLongProp(Wavefunction& waveLeft, Wavefunction& waveRight,
           }
 
           // energy
-          auto hamOverlap = walkers[w].hamAndOverlap(waveLeft, ham);
+          auto hamOverlap = (schd.batchProp || schd.walkerThreads) ? hamOverlaps[w] : walkers[w].hamAndOverlap(waveLeft, ham);
           localEnergy(w) = (hamOverlap[0]/hamOverlap[1]).real() + delta.real();
           if (std::isnan(localEnergy(w)) || std::isinf(localEnergy(w))) {
             cout << "local energy:  " << localEnergy(w) << endl;
@@ -532,6 +990,43 @@ void calcMixedEstimatorLongProp(Wavefunction& waveLeft, Wavefunction& waveRight,
         else localEnergy(w) = 0.;
       }
       eneTime += getTime() - init;
+
+      // back propagated rdm, the window ends here
+      if (bpSteps > 0 && step % bpInterval == 0 && rdmQ) {
+        bpWindows++;
+        if (ham.intType == "u") rdmSamplesU.resize(walkers.size());
+        else rdmSamples.resize(walkers.size());
+#pragma omp parallel for schedule(dynamic) if (schd.walkerThreads)
+        for (int w = 0; w < walkers.size(); w++) {
+          if (weights(w) == 0. || !walkers[w].backPropReady()) continue;
+          if (walkers[w].szQ) walkers[w].backPropOneRDM(refSOC, ham, orthoSteps, rdmSamples[w]);
+          else if (ham.intType == "u") walkers[w].backPropOneRDM(ref, ham, orthoSteps, rdmSamplesU[w]);
+          else {
+            matPair rdmPair;
+            walkers[w].backPropOneRDM(ref, ham, orthoSteps, rdmPair);
+            rdmSamples[w] = rdmPair[0] + rdmPair[1];
+          }
+        }
+        for (int w = 0; w < walkers.size(); w++) {
+          if (weights(w) == 0. || !walkers[w].backPropReady()) continue;
+          if (ham.intType == "u") {
+            oneRDMUBP[0] *= cumulativeWeightBP;
+            oneRDMUBP[1] *= cumulativeWeightBP;
+            oneRDMUBP[0] += weights(w) * rdmSamplesU[w][0].real();
+            oneRDMUBP[1] += weights(w) * rdmSamplesU[w][1].real();
+            cumulativeWeightBP += weights(w);
+            oneRDMUBP[0] /= cumulativeWeightBP;
+            oneRDMUBP[1] /= cumulativeWeightBP;
+          }
+          else {
+            oneRDMBP *= cumulativeWeightBP;
+            oneRDMBP += weights(w) * rdmSamples[w].real();
+            cumulativeWeightBP += weights(w);
+            oneRDMBP /= cumulativeWeightBP;
+          }
+        }
+      }
+
       weightedEnergy = (localEnergy * weights).sum();
       MPI_Allreduce(MPI_IN_PLACE, &weightedEnergy, 1, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
       totalWeights(block) = totalWeight;
@@ -556,82 +1051,18 @@ void calcMixedEstimatorLongProp(Wavefunction& waveLeft, Wavefunction& waveRight,
     }
 
     // reconfigure for efficiency
-    if (step % nsteps == 0) {
-      // serialize walkers
-      int matSize;
-      if (schd.soc) matSize = 2 * ham.norbs * ham.nelec;
-      else if (walker.szQ) matSize = ham.norbs * ham.nelec;
-      else matSize = ham.norbs * (ham.nalpha  + ham.nbeta);
-      vector<complex<double>> serial(nwalk * matSize, complex<double>(0., 0.)), serialw(matSize, complex<double>(0., 0.)), overlaps(nwalk, complex<double>(0., 0.));
-      for (int w = 0; w < walkers.size(); w++) {
-        overlaps[w] = walkers[w].getDet(serialw);
-        for (int i = 0; i < matSize; i++) serial[w * matSize + i] = serialw[i];
-      }
-
-      // gather on the root 
-      vector<complex<double>> serialGather, overlapsGather;
-      vector<double> weightsGather;
-      if (commrank == 0) {
-        serialGather = vector<complex<double>>(commsize * nwalk * matSize, complex<double>(0., 0.));
-        overlapsGather = vector<complex<double>>(commsize * nwalk, complex<double>(0., 0.));
-        weightsGather = vector<double>(commsize * nwalk, 0.);
-      }
-      MPI_Gather(serial.data(), nwalk * matSize, MPI_DOUBLE_COMPLEX, serialGather.data(), nwalk * matSize, MPI_DOUBLE_COMPLEX, 0, MPI_COMM_WORLD);
-      MPI_Gather(overlaps.data(), nwalk, MPI_DOUBLE_COMPLEX, overlapsGather.data(), nwalk, MPI_DOUBLE_COMPLEX, 0, MPI_COMM_WORLD);
-      MPI_Gather(weights.data(), nwalk, MPI_DOUBLE, weightsGather.data(), nwalk, MPI_DOUBLE, 0, MPI_COMM_WORLD);
-      
-      // reconfigure
-      vector<complex<double>> newSerialGather, newOverlapsGather;
-      double totalCumulativeWeight;
-      if (commrank == 0) {
-        if (std::isnan(averageEnergy)) {
-          cout << "overlaps:  ";
-          for (int i = 0; i < overlapsGather.size(); i++) cout << overlapsGather[i] << "  ";
-          cout << "\n\nweights:  ";
-          for (int i = 0; i < weightsGather.size(); i++) cout << weightsGather[i] << "  ";
-          cout << endl << endl;
-          exit(0);
-        }
-        vector<double> cumulativeWeights(weightsGather.size(), 0.);
-        cumulativeWeights[0] = weightsGather[0];
-        for (int i = 1; i < weightsGather.size(); i++) cumulativeWeights[i] = cumulativeWeights[i - 1] + weightsGather[i];
-        totalCumulativeWeight = cumulativeWeights[cumulativeWeights.size() - 1];
-        std::uniform_real_distribution<double> uniform = std::uniform_real_distribution<double>(0., 1.);
-        double zeta = uniform(generator);
-        newSerialGather = vector<complex<double>>(commsize * nwalk * matSize, complex<double>(0., 0.));
-        newOverlapsGather = vector<complex<double>>(commsize * nwalk, complex<double>(0., 0.));
-        for (int w = 0; w < commsize * nwalk; w++) {
-          double z = (w + zeta) / nwalk / commsize;
-          int index = std::lower_bound(cumulativeWeights.begin(), cumulativeWeights.end(), z * totalCumulativeWeight) - cumulativeWeights.begin();
-          for (int i = 0; i < matSize; i++) newSerialGather[w * matSize + i] = serialGather[index * matSize + i];
-          newOverlapsGather[w] = overlapsGather[index];
-        }
-      }
+    if (step % nsteps == 0) reconfigure(walkers, weights, matSize, totalWeight, std::isnan(averageEnergy));
 
-      // scatter
-      MPI_Scatter(newSerialGather.data(), nwalk * matSize, MPI_DOUBLE_COMPLEX, serial.data(), nwalk * matSize, MPI_DOUBLE_COMPLEX, 0, MPI_COMM_WORLD);
-      MPI_Scatter(newOverlapsGather.data(), nwalk, MPI_DOUBLE_COMPLEX, overlaps.data(), nwalk, MPI_DOUBLE_COMPLEX, 0, MPI_COMM_WORLD);
-      MPI_Bcast(&totalCumulativeWeight, 1, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+    // start recording fields so that the back propagation window ends at a measurement
+    if (bpSteps > 0 && (step + bpSteps) % bpInterval == 0) {
+      for (int w = 0; w < walkers.size(); w++) walkers[w].startBackProp();
+    }
 
-      // deserialize
-      for (int w = 0; w < walkers.size(); w++) {
-        for (int i = 0; i < matSize; i++) serialw[i] = serial[w * matSize + i];
-        walkers[w].setDet(serialw, overlaps[w]);
-        weights[w] = totalCumulativeWeight / commsize / nwalk;
-      }
-      totalWeight = totalCumulativeWeight / commsize;
-      //MPI_Barrier(MPI_COMM_WORLD);
-      //if (commrank == 0) {
-      //  for (int w = 0; w < walkers.size(); w++) {
-      //    cout << w << "  " << overlaps[w] << "  " << walkers[w].trialOverlap << endl;
-      //  }
-      //  cout << "weights:\n" << weights << endl << endl;
-      //  for (int w = 0; w < walkers.size(); w++) {
-      //    cout << w << endl << walkers[w].det[0] << endl << endl;
-      //  }
-      //}
-      //MPI_Barrier(MPI_COMM_WORLD);
-      //exit(0);
+    // checkpoint
+    if (schd.checkpointFreq > 0 && step % (schd.checkpointFreq * nsteps) == 0) {
+      vector<double> accumulators {eshift, totalWeight, cumulativeWeight, averageEnergy, averageNum, averageDenom, 
+                                   averageEnergyEql, averageNumEql, averageDenomEql, eEstimate, double(nLargeDeviations), double(measureCounter)};
+      writeCheckpoint(step, walkers, weights, matSize, accumulators, totalWeights, totalEnergies, oneRDM, oneRDMU);
     }
 
     // periodically carry out blocking analysis and print to disk
@@ -651,9 +1082,11 @@ void calcMixedEstimatorLongProp(Wavefunction& waveLeft, Wavefunction& waveRight,
         std::string scratch_dir = schd.scratchDir;
         if (ham.intType == "r" || ham.intType == "g") {
           writeOneRDM(oneRDM, cumulativeWeight);
+          if (bpWindows > 0) writeOneRDM(oneRDMBP, cumulativeWeightBP, "rdm_bp");
         }
         else if (ham.intType == "u") {
           writeOneRDM(oneRDMU, cumulativeWeight);
+          if (bpWindows > 0) writeOneRDM(oneRDMUBP, cumulativeWeightBP, "rdm_bp");
         }
       }
     }
@@ -662,17 +1095,32 @@ void calcMixedEstimatorLongProp(Wavefunction& waveLeft, Wavefunction& waveRight,
 
   if (commrank == 0) {
     double totalVhsTime = 0., totalExpTime = 0., totalFbTime = 0.;
+    long totalExpCalls = 0, totalExpTerms = 0;
+    double totalOrthoTime = 0., totalBpTime = 0.;
+    long totalOrthoChecks = 0, totalOrthoCalls = 0;
     for (int w = 0; w < walkers.size(); w++) {
+      totalOrthoTime += walkers[w].orthoTime;
+      totalBpTime += walkers[w].bpTime;
+      totalOrthoChecks += walkers[w].orthoChecks;
+      totalOrthoCalls += walkers[w].orthoCalls;
       totalVhsTime += walkers[w].vhsTime;
       totalExpTime += walkers[w].expTime;
       totalFbTime += walkers[w].fbTime;
+      totalExpCalls += walkers[w].expCalls;
+      totalExpTerms += walkers[w].expTerms;
     }
     afqmcFile << "#\n# Total propagation time:  " << propTime << " s\n"; 
     afqmcFile << "#    VHS Time: " << totalVhsTime << " s\n";
     afqmcFile << "#    Matmul Time: " << totalExpTime << " s\n";
+    if (totalExpCalls > 0) afqmcFile << "#    Exponential terms per application: " << double(totalExpTerms) / totalExpCalls << " (" << schd.expMethod << ")\n";
     afqmcFile << "#    Force bias Time: " << totalFbTime << " s\n";
-    afqmcFile << "# Energy evaluation time:  " << eneTime << " s\n#\n";
-    afqmcFile << "# Number of large deviations:  " << nLargeDeviations << "\n";
+    afqmcFile << "# Orthogonalization time:  " << totalOrthoTime << " s\n";
+    afqmcFile << "#    Orthogonalizations: " << totalOrthoCalls << " (" << schd.orthoMethod << ")";
+    if (totalOrthoChecks > 0) afqmcFile << " in " << totalOrthoChecks << " condition checks";
+    afqmcFile << "\n";
+    afqmcFile << "# Energy evaluation time:  " << eneTime << " s\n";
+    if (bpSteps > 0) afqmcFile << "# Back propagation time:  " << totalBpTime << " s for " << bpWindows << " windows of " << bpSteps << " steps\n";
+    afqmcFile << "#\n# Number of large deviations:  " << nLargeDeviations << "\n";
     afqmcFile.flush();
 
     string fname = "samples.dat";
@@ -690,11 +1138,242 @@ void calcMixedEstimatorLongProp(Wavefunction& waveLeft, Wavefunction& waveRight,
     std::string scratch_dir = schd.scratchDir;
     if (ham.intType == "r" || ham.intType == "g") {
       writeOneRDM(oneRDM, cumulativeWeight);
+      if (bpWindows > 0) writeOneRDM(oneRDMBP, cumulativeWeightBP, "rdm_bp");
     }
     else if (ham.intType == "u") {
       writeOneRDM(oneRDMU, cumulativeWeight);
+      if (bpWindows > 0) writeOneRDM(oneRDMUBP, cumulativeWeightBP, "rdm_bp");
     }
   }
 
 };
 
+
+
+// phaseless propagation of replicas of the walkers with time steps dt / m_k, m_k in schd.dtSubsteps
+// the replicas of a walker use the same normal draws: those of the finest time step, summed over
+// each step of a coarser replica and scaled by 1 / sqrt(number summed), and all replicas are
+// reconfigured with the same comb, so their energies are correlated and the dt -> 0 extrapolation
+// has a smaller error bar than that of independent runs
+void calcMixedEstimatorLongPropDt(Wavefunction& waveLeft, Wavefunction& waveRight, DQMCWalker& walker, Hamiltonian& ham)
+{
+  size_t nsweeps = schd.stochasticIter;  // number of energy evaluations
+  size_t nsteps = schd.nsteps;           // number of steps per energy evaluation
+  size_t orthoSteps = schd.orthoSteps;
+  size_t nwalk = schd.nwalk;             // number of walkers per process
+  double dt = schd.dt;                   // imaginary time per step, the same for all replicas
+  int nfields = ham.nchol;
+  vector<int> substeps = schd.dtSubsteps;
+  int nreplicas = substeps.size();
+  int maxSubsteps = *max_element(substeps.begin(), substeps.end());
+  for (int k = 0; k < nreplicas; k++) {
+    if (substeps[k] < 1 || maxSubsteps % substeps[k] != 0) {
+      if (commrank == 0) cout << "dtSubsteps should be positive divisors of the largest entry\n";
+      exit(0);
+    }
+  }
+  if (schd.batchProp || schd.restartAFQMC || schd.checkpointFreq > 0) {
+    if (commrank == 0) cout << "Correlated time step replicas are not supported with batchProp or checkpoints\n";
+    exit(0);
+  }
+  ofstream afqmcFile("afqmc.dat", ios::app);
+
+  matPair ref;
+  MatrixXcd refSOC;
+  complex<double> delta;
+  complex<double> refEnergy = prepPhaseless(waveLeft, walker, ham, afqmcFile, ref, refSOC, delta);
+  complex<double> ene0;
+  if (schd.ene0Guess == 1.e10) ene0 = refEnergy;
+  else ene0 = schd.ene0Guess;
+
+  // replicas differ only in their propagators
+  walker.floatQ = schd.floatProp;
+  walker.expProp = PropagatorExp(schd.expMethod, schd.expOrder, schd.expTol);
+  walker.setOrthoMethod(schd.orthoMethod);
+  vector<double> dts(nreplicas);
+  vector<vector<DQMCWalker>> walkers(nreplicas);
+  vector<ArrayXd> weights(nreplicas, ArrayXd::Ones(nwalk));
+  for (int k = 0; k < nreplicas; k++) {
+    dts[k] = dt / substeps[k];
+    DQMCWalker replica = walker;
+    if (walker.szQ) replica.prepProp(refSOC, ham, dts[k], ene0.real());
+    else replica.prepProp(ref, ham, dts[k], ene0.real());
+    walkers[k] = vector<DQMCWalker>(nwalk, replica);
+  }
+  auto calcInitTime = getTime();
+  ArrayXd localEnergy = ArrayXd::Zero(nwalk);
+  for (int w = 0; w < nwalk; w++) {
+    if (walker.szQ) {
+      MatrixXcd rn;
+      waveRight.getSample(rn);
+      for (int k = 0; k < nreplicas; k++) walkers[k][w].setDet(rn);
+    }
+    else {
+      matPair rn;
+      waveRight.getSample(rn);
+      for (int k = 0; k < nreplicas; k++) walkers[k][w].setDet(rn);
+    }
+    for (int k = 0; k < nreplicas; k++) walkers[k][w].overlap(waveLeft);
+    std::array<complex<double>, 2> hamOverlap = walkers[0][w].hamAndOverlap(waveLeft, ham);
+    localEnergy(w) = (hamOverlap[0]/hamOverlap[1]).real();
+  }
+  // setup is done, the full cholesky is no longer read
+  if (ham.rotFlag) ham.releaseFullCholesky();
+
+  MatrixXd totalWeights = MatrixXd::Zero(nreplicas, nsweeps);
+  MatrixXd totalEnergies = MatrixXd::Zero(nreplicas, nsweeps);
+  double weightedEnergy = localEnergy.sum();
+  MPI_Allreduce(MPI_IN_PLACE, &weightedEnergy, 1, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+  totalWeights.col(0).setConstant(nwalk * commsize);
+  totalEnergies.col(0).setConstant(weightedEnergy / (nwalk * commsize) + delta.real());
+  if (commrank == 0) {
+    double initializationTime = getTime() - calcInitTime;
+    afqmcFile << "# Correlated time step replicas, dt:";
+    for (int k = 0; k < nreplicas; k++) afqmcFile << "  " << dts[k];
+    afqmcFile << "\n#\n# block     propTime     energy of each replica     walltime\n";
+    afqmcFile << boost::format(" %5d     %.3e ") % 0 % 0.;
+    for (int k = 0; k < nreplicas; k++) afqmcFile << boost::format("     %.9e") % totalEnergies(k, 0);
+    afqmcFile << boost::format("      %.2e \n") % initializationTime;
+    afqmcFile.flush();
+  }
+
+  double propTime = 0., eneTime = 0.;
+  ArrayXd eshift = totalEnergies.col(0).array(), eEstimate = totalEnergies.col(0).array();
+  ArrayXd totalWeight = ArrayXd::Constant(nreplicas, nwalk * commsize);
+  long nLargeDeviations = 0;
+  double weightCap = 0.;
+  if (schd.weightCap > 0) weightCap = schd.weightCap;
+  else weightCap = std::max(100., nwalk / 10.);
+  int matSize;
+  if (schd.soc) matSize = 2 * ham.norbs * ham.nelec;
+  else if (walker.szQ) matSize = ham.norbs * ham.nelec;
+  else matSize = ham.norbs * (ham.nalpha  + ham.nbeta);
+  normal_distribution<double> normal(0., 1.);
+  vector<VectorXd> noise(maxSubsteps, VectorXd::Zero(nfields));
+  for (int step = 1; step < nsweeps * nsteps; step++) {
+    // propagate, fields are drawn for every walker so that the streams of the replicas stay aligned
+    double init = getTime();
+    for (int w = 0; w < nwalk; w++) {
+      for (int f = 0; f < maxSubsteps; f++) 
+        for (int n = 0; n < nfields; n++) noise[f](n) = normal(generator);
+      for (int k = 0; k < nreplicas; k++) {
+        int stride = maxSubsteps / substeps[k];
+        for (int s = 0; s < substeps[k] && weights[k](w) > 1.e-8; s++) {
+          walkers[k][w].noise = VectorXd::Zero(nfields);
+          for (int f = s * stride; f < (s + 1) * stride; f++) walkers[k][w].noise += noise[f];
+          walkers[k][w].noise /= sqrt(stride);
+          weights[k](w) *= walkers[k][w].propagatePhaseless(waveLeft, ham, eshift(k));
+        }
+        if (weights[k](w) > weightCap) {
+          weights[k](w) = 0.;
+          nLargeDeviations++;
+        }
+      }
+    }
+    propTime += getTime() - init;
+
+    // population control
+    for (int k = 0; k < nreplicas; k++) {
+      totalWeight(k) = weights[k].sum();
+      MPI_Allreduce(MPI_IN_PLACE, &totalWeight(k), 1, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+      eshift(k) = eEstimate(k) - 0.1 * log(totalWeight(k)/(nwalk * commsize)) / dt;
+    }
+
+    // orthogonalize for stability
+    for (int k = 0; k < nreplicas; k++) {
+      if (schd.orthoCond > 0.) stabilizeWalkers(walkers[k], weights[k], schd.orthoCond, orthoSteps, schd.orthoCheckSteps, false);
+      else if (step % orthoSteps == 0) 
+        for (int w = 0; w < nwalk; w++) walkers[k][w].orthogonalize();
+    }
+
+    // measure
+    if (step % nsteps == 0) {
+      int block = step / nsteps;
+      init = getTime();
+      for (int k = 0; k < nreplicas; k++) {
+        localEnergy.setZero();
+        for (int w = 0; w < nwalk; w++) {
+          if (weights[k](w) == 0.) continue;
+          std::array<complex<double>, 2> hamOverlap = walkers[k][w].hamAndOverlap(waveLeft, ham);
+          localEnergy(w) = (hamOverlap[0]/hamOverlap[1]).real() + delta.real();
+          if (std::isnan(localEnergy(w)) || std::isinf(localEnergy(w))) {
+            localEnergy(w) = 0.;
+            weights[k](w) = 0.;
+          }
+          else if (abs(localEnergy(w) - eEstimate(k)) > sqrt(2./dts[k])) {
+            nLargeDeviations++;
+            if (localEnergy(w) > eEstimate(k)) localEnergy(w) = eEstimate(k) + sqrt(2./dts[k]);
+            else localEnergy(w) = eEstimate(k) - sqrt(2./dts[k]);
+          }
+        }
+        weightedEnergy = (localEnergy * weights[k]).sum();
+        MPI_Allreduce(MPI_IN_PLACE, &weightedEnergy, 1, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+        totalWeights(k, block) = totalWeight(k);
+        totalEnergies(k, block) = weightedEnergy / totalWeight(k);
+        eEstimate(k) = 0.9 * eEstimate(k) + 0.1 * totalEnergies(k, block);
+      }
+      eneTime += getTime() - init;
+      if (commrank == 0) {
+        afqmcFile << boost::format(" %5d     %.3e ") % block % (dt * step);
+        for (int k = 0; k < nreplicas; k++) afqmcFile << boost::format("     %.9e") % totalEnergies(k, block);
+        afqmcFile << boost::format("      %.2e \n") % (getTime() - calcInitTime);
+        afqmcFile.flush();
+      }
+
+      // reconfigure all replicas with the same comb
+      double zeta = 0.;
+      if (commrank == 0) {
+        std::uniform_real_distribution<double> uniform = std::uniform_real_distribution<double>(0., 1.);
+        zeta = uniform(generator);
+      }
+      MPI_Bcast(&zeta, 1, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+      for (int k = 0; k < nreplicas; k++) reconfigure(walkers[k], weights[k], matSize, totalWeight(k), std::isnan(eEstimate(k)), zeta);
+    }
+  }
+  MPI_Allreduce(MPI_IN_PLACE, &nLargeDeviations, 1, MPI_LONG, MPI_SUM, MPI_COMM_WORLD);
+
+  if (commrank == 0) {
+    // linear extrapolation E(dt) = E_0 + b dt, E_0 = sum_k c_k E(dt_k) is evaluated block by block
+    // so that its error bar includes the correlation between the replicas
+    MatrixXd design(nreplicas, 2);
+    for (int k = 0; k < nreplicas; k++) { design(k, 0) = 1.; design(k, 1) = dts[k]; }
+    VectorXd coeffs = design * (design.transpose() * design).inverse().col(0);
+    ArrayXd extrapolated = (coeffs.transpose() * totalEnergies).transpose().array();
+    ArrayXd meanWeights = totalWeights.colwise().mean().transpose().array();
+
+    afqmcFile << "#\n# Total propagation time:  " << propTime << " s\n"; 
+    afqmcFile << "# Energy evaluation time:  " << eneTime << " s\n#\n";
+    afqmcFile << "# Number of large deviations:  " << nLargeDeviations << "\n";
+    string fname = "samples.dat";
+    ofstream samplesFile(fname);
+    for (int i = 0; i < nsweeps; i++) {
+      samplesFile << boost::format("%.7e      %.10e ") % meanWeights(i) % extrapolated(i);
+      for (int k = 0; k < nreplicas; k++) samplesFile << boost::format("     %.10e") % totalEnergies(k, i);
+      samplesFile << "\n";
+    }
+    samplesFile.close();
+
+    int nburn = max(40, schd.burnIter);
+    if (nsweeps > nburn + 1) {
+      int nsamples = nsweeps - nburn;
+      afqmcFile << "#\n#      dt            energy              error\n";
+      cout << "\n       dt            energy              error\n";
+      // errors are -1 if the blocking analysis did not plateau
+      double uncorrelatedVar = 0.;
+      for (int k = 0; k < nreplicas; k++) {
+        ArrayXd replicaWeights = totalWeights.row(k).transpose().array(), replicaEnergies = totalEnergies.row(k).transpose().array();
+        auto ene_err = blocking(replicaWeights.tail(nsamples), replicaEnergies.tail(nsamples), "blocking_dt" + to_string(k) + ".tmp");
+        if (ene_err[1] > 0. && uncorrelatedVar >= 0.) uncorrelatedVar += pow(coeffs(k) * ene_err[1], 2);
+        else uncorrelatedVar = -1.;
+        afqmcFile << boost::format("# %.3e     %.9e     %.3e\n") % dts[k] % ene_err[0] % ene_err[1];
+        cout << boost::format("  %.3e     %.9e     %.3e\n") % dts[k] % ene_err[0] % ene_err[1];
+      }
+      auto ene_err = blocking(meanWeights.tail(nsamples), extrapolated.tail(nsamples), "blocking.tmp");
+      double uncorrelatedError = uncorrelatedVar >= 0. ? sqrt(uncorrelatedVar) : -1.;
+      afqmcFile << boost::format("# %9s     %.9e     %.3e   (independent replicas: %.3e)\n") % "0" % ene_err[0] % ene_err[1] % uncorrelatedError;
+      cout << boost::format("  %9s     %.9e     %.3e   (independent replicas: %.3e)\n") % "0" % ene_err[0] % ene_err[1] % uncorrelatedError;
+    }
+    afqmcFile.flush();
+  }
+  afqmcFile.close();
+};
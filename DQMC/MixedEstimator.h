@@ -8,4 +8,7 @@ void calcMixedEstimatorNoProp(Wavefunction& waveLeft, Wavefunction& waveRight, D
 
 void calcMixedEstimatorLongProp(Wavefunction& waveLeft, Wavefunction& waveRight, Wavefunction& waveGuide, DQMCWalker& walker, Hamiltonian& ham);
 
+// phaseless with correlated replicas of the walkers for several time steps, and extrapolation to dt = 0
+void calcMixedEstimatorLongPropDt(Wavefunction& waveLeft, Wavefunction& waveRight, DQMCWalker& walker, Hamiltonian& ham);
+
 #endif
@@ -1,5 +1,7 @@
 #include <algorithm>
 #include <iostream>
+#include <fstream>
+#include <map>
 #include "global.h"
 #include "input.h"
 #include "Multislater.h"
@@ -11,15 +13,55 @@ using matPair = std::array<MatrixXcd, 2>;
 
 Multislater::Multislater(Hamiltonian& ham, std::string fname, int pnact, int pncore, bool prightQ) 
 {
-  std::array<std::vector<int>, 2> refDetVec;
-  if (fname == "dets") readDeterminants(fname, refDetVec, ciExcitations, ciParity, ciCoeffs);
-  else readDeterminantsBinary(fname, refDetVec, ciExcitations, ciParity, ciCoeffs);
-  
+  // energies and force biases read the full cholesky vectors
+  ham.rotFlag = false;
+  ci.load(fname, 2, schd.compactDeterminantFile);
+  for (int sz = 0; sz < 2; sz++) refDet[sz] = ci.ref(sz);
+
+
+  // unique alpha and beta strings, the reference string is string 0 of each spin
   for (int sz = 0; sz < 2; sz++) {
-    refDet[sz] = VectorXi::Zero(refDetVec[sz].size());
-    for (int i = 0; i < refDetVec[sz].size(); i++) refDet[sz][i] = refDetVec[sz][i];
+    std::map<std::vector<int>, int> stringIndices;
+    for (int i = 0; i < ci.ndets; i++) {
+      std::array<VectorXi, 2> exc;
+      exc[0] = ci.holes(sz, i);
+      exc[1] = ci.particles(sz, i);
+      std::vector<int> key(exc[0].data(), exc[0].data() + exc[0].size());
+      key.push_back(-1);
+      key.insert(key.end(), exc[1].data(), exc[1].data() + exc[1].size());
+      auto it = stringIndices.find(key);
+      if (it == stringIndices.end()) {
+        it = stringIndices.emplace(key, ciStrings[sz].size()).first;
+        ciStrings[sz].push_back(exc);
+      }
+      ciStringIndex[sz].push_back(it->second);
+    }
   }
 
+  // rank buckets of the strings
+  for (int sz = 0; sz < 2; sz++) {
+    int maxRank = 0;
+    for (int s = 0; s < ciStrings[sz].size(); s++) maxRank = max(maxRank, int(ciStrings[sz][s][0].size()));
+    stringBuckets[sz].resize(maxRank);
+    for (int s = 0; s < ciStrings[sz].size(); s++) {
+      int rank = ciStrings[sz][s][0].size();
+      if (rank > 0) stringBuckets[sz][rank - 1].strings.push_back(s);
+    }
+    for (int k = 0; k < maxRank; k++) {
+      StringBucket& bucket = stringBuckets[sz][k];
+      bucket.rows.resize(k + 1, bucket.strings.size());
+      bucket.cols.resize(k + 1, bucket.strings.size());
+      for (int j = 0; j < bucket.strings.size(); j++) {
+        bucket.rows.col(j) = ciStrings[sz][bucket.strings[j]][0];
+        bucket.cols.col(j) = ciStrings[sz][bucket.strings[j]][1];
+      }
+    }
+  }
+  if (commrank == 0) {
+    ofstream afqmcFile("afqmc.dat", ios::app);
+    afqmcFile << "# Number of unique alpha and beta strings " << ciStrings[0].size() << "  " << ciStrings[1].size() << "\n#\n";
+    afqmcFile.close();
+  }
 
   nact = pnact;
   ncore = pncore;
@@ -29,8 +71,8 @@ Multislater::Multislater(Hamiltonian& ham, std::string fname, int pnact, int pnc
 
   if (rightQ) {
     double sum = 0.;
-    for (int i = 0; i < ciCoeffs.size(); i++) {
-      sum += abs(ciCoeffs[i]);
+    for (int i = 0; i < ci.ndets; i++) {
+      sum += abs(ci.coeffs[i]);
       cumulativeCoeffs.push_back(sum);
     }
     uniform = uniform_real_distribution<double> (0., 1.);
@@ -53,26 +95,168 @@ void Multislater::getSample(std::array<Eigen::MatrixXcd, 2>& sampleDet)
   for (int i = 0; i < nbeta; i++) phi0[1](refDet[1][i], i) = 1.;
 
   for (int sz = 0; sz < 2; sz++) {
-    for (int mu = 0; mu < ciExcitations[sz][sampleIt][0].size(); mu++) {
-      int p = ciExcitations[sz][sampleIt][0](mu);
+    for (int mu = 0; mu < ci.holes(sz, sampleIt).size(); mu++) {
+      int p = ci.holes(sz, sampleIt)(mu);
       p = lower_bound(refDet[sz].begin(), refDet[sz].end(), p) - refDet[sz].begin();
-      int t = ciExcitations[sz][sampleIt][1](mu);
+      int t = ci.particles(sz, sampleIt)(mu);
       phi0[sz](refDet[sz][p], p) = 0.;
       phi0[sz](t, p) = 1.;
     }
   }
-  phi0[0].col(0) *= abs(ciCoeffs[sampleIt])/ciCoeffs[sampleIt];
+  phi0[0].col(0) *= abs(ci.coeffs[sampleIt])/ci.coeffs[sampleIt];
   sampleDet = phi0;
 };
 
 
+// determinant of the excitation block of greeno for one string
+static complex<double> stringDet(const MatrixXcd& greeno, const std::array<VectorXi, 2>& exc)
+{
+  int rank = exc[0].size();
+  if (rank == 0) return 1.;
+  else if (rank == 1) return greeno(exc[0](0), exc[1](0));
+  else if (rank == 2) return greeno(exc[0](0), exc[1](0)) * greeno(exc[0](1), exc[1](1)) - greeno(exc[0](1), exc[1](0)) * greeno(exc[0](0), exc[1](1));
+  else if (rank == 3) {
+    Matrix3cd temp = Matrix3cd::Zero(3, 3);
+    for (int p = 0; p < rank; p++) 
+      for (int t = 0; t < rank; t++) 
+        temp(p, t) = greeno(exc[0](p), exc[1](t));
+    return temp.determinant();
+  }
+  else if (rank == 4) {
+    Matrix4cd temp = Matrix4cd::Zero(4, 4);
+    for (int p = 0; p < rank; p++) 
+      for (int t = 0; t < rank; t++) 
+        temp(p, t) = greeno(exc[0](p), exc[1](t));
+    return temp.determinant();
+  }
+  MatrixXcd temp = MatrixXcd::Zero(rank, rank);
+  for (int p = 0; p < rank; p++) 
+    for (int t = 0; t < rank; t++) 
+      temp(p, t) = greeno(exc[0](p), exc[1](t));
+  return temp.determinant();
+};
+
+
+void Multislater::stringDets(std::array<Eigen::MatrixXcd, 2>& greeno, std::array<std::vector<std::complex<double>>, 2>& dets)
+{
+  for (int sz = 0; sz < 2; sz++) {
+    dets[sz].resize(ciStrings[sz].size());
+    for (int s = 0; s < ciStrings[sz].size(); s++) dets[sz][s] = stringDet(greeno[sz], ciStrings[sz][s]);
+  }
+};
+
+
+// cofactors(p, t) = -(-1)^(p + t) minor_pt of the excitation block
+void Multislater::stringCofactors(std::array<Eigen::MatrixXcd, 2>& greeno, std::array<std::vector<std::complex<double>>, 2>& dets, std::array<std::vector<Eigen::MatrixXcd>, 2>& cofactors)
+{
+  stringDets(greeno, dets);
+  for (int sz = 0; sz < 2; sz++) {
+    cofactors[sz].resize(ciStrings[sz].size());
+    for (int s = 0; s < ciStrings[sz].size(); s++) {
+      std::array<VectorXi, 2>& exc = ciStrings[sz][s];
+      int rank = exc[0].size();
+      if (rank == 0) continue;
+      cofactors[sz][s] = MatrixXcd::Zero(rank, rank);
+      if (rank == 1) cofactors[sz][s](0, 0) = -1.;
+      else if (rank == 2) {
+        cofactors[sz][s](0, 0) = -greeno[sz](exc[0](1), exc[1](1));
+        cofactors[sz][s](1, 1) = -greeno[sz](exc[0](0), exc[1](0));
+        cofactors[sz][s](0, 1) = greeno[sz](exc[0](1), exc[1](0));
+        cofactors[sz][s](1, 0) = greeno[sz](exc[0](0), exc[1](1));
+      }
+      else {
+        MatrixXcd minorMat(rank - 1, rank - 1);
+        for (int p = 0; p < rank; p++) {
+          for (int t = 0; t < rank; t++) {
+            for (int q = 0; q < rank - 1; q++) {
+              int q1 = q < p ? q : q + 1;
+              for (int u = 0; u < rank - 1; u++) { 
+                int u1 = u < t ? u : u + 1;
+                minorMat(q, u) = greeno[sz](exc[0](q1), exc[1](u1));
+              }
+            }
+            double parity_pt = ((p + t)%2 == 0) ? 1. : -1.;
+            cofactors[sz][s](p, t) = -parity_pt * minorMat.determinant();
+          }
+        }
+      }
+    }
+  }
+};
+
+
+// multi determinant green's function, returns the overlap
+// the cofactors of each string are weighted by the contraction of the sparse coefficient
+// matrix with the determinants of the strings of the other spin
+std::complex<double> Multislater::multiGreen(std::array<Eigen::MatrixXcd, 2>& psi, std::array<Eigen::MatrixXcd, 2>& greenMulti)
+{
+  int norbs = psi[0].rows();
+  int nalpha = refDet[0].size();
+  int nbeta = refDet[1].size();
+  size_t ndets = ci.ndets;
+
+  matPair phi0T;
+  phi0T[0] = MatrixXcd::Zero(nalpha, norbs);
+  phi0T[1] = MatrixXcd::Zero(nbeta, norbs);
+  for (int i = 0; i < nalpha; i++) phi0T[0](i, refDet[0][i]) = 1.;
+  for (int i = 0; i < nbeta; i++) phi0T[1](i, refDet[1][i]) = 1.;
+
+  matPair theta, green, greenp, greeno;
+  theta[0] = psi[0] * (psi[0](refDet[0], Eigen::placeholders::all)).inverse();
+  theta[1] = psi[1] * (psi[1](refDet[1], Eigen::placeholders::all)).inverse();
+  green[0] = (theta[0] * phi0T[0]).transpose();
+  green[1] = (theta[1] * phi0T[1]).transpose();
+  greenp[0] = green[0] - MatrixXcd::Identity(norbs, norbs);
+  greenp[1] = green[1] - MatrixXcd::Identity(norbs, norbs);
+  greeno[0] = green[0](refDet[0], Eigen::placeholders::all);
+  greeno[1] = green[1](refDet[1], Eigen::placeholders::all);
+
+  // most quantities henceforth will be calculated in "units" of overlap0 = < phi_0 | psi >
+  complex<double> overlap0 = (psi[0](refDet[0], Eigen::placeholders::all)).determinant() * (psi[1](refDet[1], Eigen::placeholders::all)).determinant();
+  complex<double> overlap(0., 0.);
+  overlap += ci.coeffs[0];
+
+  std::array<std::vector<complex<double>>, 2> dets, weights;
+  std::array<std::vector<MatrixXcd>, 2> cofactors;
+  stringCofactors(greeno, dets, cofactors);
+  weights[0] = std::vector<complex<double>>(ciStrings[0].size(), 0.);
+  weights[1] = std::vector<complex<double>>(ciStrings[1].size(), 0.);
+  for (int i = 1; i < ndets; i++) {
+    int a = ciStringIndex[0][i], b = ciStringIndex[1][i];
+    overlap += ci.coeffs[i] * ci.parity[i] * dets[0][a] * dets[1][b];
+    weights[0][a] += ci.coeffs[i] * ci.parity[i] * dets[1][b];
+    weights[1][b] += ci.coeffs[i] * ci.parity[i] * dets[0][a];
+  }
+
+  matPair intermediate;
+  intermediate[0] = MatrixXcd::Zero(norbs, nalpha);
+  intermediate[1] = MatrixXcd::Zero(norbs, nbeta);
+  for (int sz = 0; sz < 2; sz++) {
+    for (int s = 0; s < ciStrings[sz].size(); s++) {
+      std::array<VectorXi, 2>& exc = ciStrings[sz][s];
+      int rank = exc[0].size();
+      for (int p = 0; p < rank; p++) 
+        for (int t = 0; t < rank; t++)
+          intermediate[sz](exc[1](t), exc[0](p)) += weights[sz][s] * cofactors[sz][s](p, t);
+    }
+  }
+  
+  greenMulti[0] = greenp[0] * intermediate[0] * greeno[0] + overlap * green[0];
+  greenMulti[1] = greenp[1] * intermediate[1] * greeno[1] + overlap * green[1];
+  overlap *= overlap0;
+  greenMulti[0] *= (overlap0 / overlap);
+  greenMulti[1] *= (overlap0 / overlap);
+  return overlap;
+};
+
+
 std::complex<double> Multislater::overlap(std::array<Eigen::MatrixXcd, 2>& psi)
 {
   int norbs = psi[0].rows();
   int nalpha = refDet[0].size();
   int nbeta = refDet[1].size();
   std::array<int, 2> nelec{nalpha, nbeta};
-  size_t ndets = ciCoeffs.size();
+  size_t ndets = ci.ndets;
 
   matPair phi0T;
   phi0T[0] = MatrixXcd::Zero(nalpha, norbs);
@@ -96,48 +280,13 @@ std::complex<double> Multislater::overlap(std::array<Eigen::MatrixXcd, 2>& psi)
   complex<double> overlap0 = (phi0T[0] * psi[0]).determinant() * (phi0T[1] * psi[1]).determinant();
  
   // ref contribution
-  overlap += ciCoeffs[0];
-
-  // iterate over excitations
-  for (int i = 1; i < ndets; i++) {
-    std::array<complex<double>, 2> dets;
-    for (int sz = 0; sz < 2; sz++) {
-      int rank = ciExcitations[sz][i][0].size();
-      if (rank == 0) {
-        dets[sz] = 1.;
-      }
-      else if (rank == 1) {
-        dets[sz] = greeno[sz](ciExcitations[sz][i][0](0), ciExcitations[sz][i][1](0));
-      }
-      else if (rank == 2) {
-        dets[sz] = greeno[sz](ciExcitations[sz][i][0](0), ciExcitations[sz][i][1](0)) * greeno[sz](ciExcitations[sz][i][0](1), ciExcitations[sz][i][1](1)) 
-                 - greeno[sz](ciExcitations[sz][i][0](1), ciExcitations[sz][i][1](0)) * greeno[sz](ciExcitations[sz][i][0](0), ciExcitations[sz][i][1](1));
-      }
-      else if (rank == 3) {
-        Matrix3cd temp = Matrix3cd::Zero(3, 3);
-        for (int p = 0; p < rank; p++) 
-          for (int t = 0; t < rank; t++) 
-            temp(p, t) = greeno[sz](ciExcitations[sz][i][0](p), ciExcitations[sz][i][1](t));
-        dets[sz] = temp.determinant();
-      }
-      else if (rank == 4) {
-        Matrix4cd temp = Matrix4cd::Zero(4, 4);
-        for (int p = 0; p < rank; p++) 
-          for (int t = 0; t < rank; t++) 
-            temp(p, t) = greeno[sz](ciExcitations[sz][i][0](p), ciExcitations[sz][i][1](t));
-        dets[sz] = temp.determinant();
-      }
-      else {
-        MatrixXcd temp = MatrixXcd::Zero(rank, rank);
-        for (int p = 0; p < rank; p++) 
-          for (int t = 0; t < rank; t++) 
-            temp(p, t) = greeno[sz](ciExcitations[sz][i][0](p), ciExcitations[sz][i][1](t));
-        dets[sz] = temp.determinant();
-      }
-    }
+  overlap += ci.coeffs[0];
 
-    overlap += ciCoeffs[i] * ciParity[i] * dets[0] * dets[1];
-  }
+  // sparse bilinear contraction of the string determinants
+  std::array<std::vector<complex<double>>, 2> dets;
+  stringDets(greeno, dets);
+  for (int i = 1; i < ndets; i++) 
+    overlap += ci.coeffs[i] * ci.parity[i] * dets[0][ciStringIndex[0][i]] * dets[1][ciStringIndex[1][i]];
   overlap *= overlap0;
   return overlap;
 };
@@ -155,140 +304,11 @@ std::complex<double> Multislater::overlap(Eigen::MatrixXcd& psi)
 void Multislater::forceBias(std::array<Eigen::MatrixXcd, 2>& psi, Hamiltonian& ham, Eigen::VectorXcd& fb)
 {
   int norbs = ham.norbs;
-  int nalpha = ham.nalpha;
-  int nbeta = ham.nbeta;
   int nchol = ham.nchol;
-  std::array<int, 2> nelec{nalpha, nbeta};
-  size_t ndets = ciCoeffs.size();
   fb = VectorXcd::Zero(nchol);
 
-  matPair phi0T;
-  phi0T[0] = MatrixXcd::Zero(nalpha, norbs);
-  phi0T[1] = MatrixXcd::Zero(nbeta, norbs);
-  for (int i = 0; i < nalpha; i++) phi0T[0](i, refDet[0][i]) = 1.;
-  for (int i = 0; i < nbeta; i++) phi0T[1](i, refDet[1][i]) = 1.;
-
-  matPair theta, green, greenp, greeno;
-  theta[0] = psi[0] * (psi[0](refDet[0], Eigen::placeholders::all)).inverse();
-  theta[1] = psi[1] * (psi[1](refDet[1], Eigen::placeholders::all)).inverse();
-  green[0] = (theta[0] * phi0T[0]).transpose();
-  green[1] = (theta[1] * phi0T[1]).transpose();
-  greenp[0] = green[0] - MatrixXcd::Identity(norbs, norbs);
-  greenp[1] = green[1] - MatrixXcd::Identity(norbs, norbs);
-  
-  
-  greeno[0] = green[0](refDet[0], Eigen::placeholders::all);
-  greeno[1] = green[1](refDet[1], Eigen::placeholders::all);
-
-  // most quantities henceforth will be calculated in "units" of overlap0 = < phi_0 | psi >
-  complex<double> overlap0 = (psi[0](refDet[0], Eigen::placeholders::all)).determinant() * (psi[1](refDet[1], Eigen::placeholders::all)).determinant();
-  complex<double> overlap(0., 0.);
-  overlap += ciCoeffs[0];
-  matPair intermediate, greenMulti;
-  intermediate[0] = MatrixXcd::Zero(norbs, nalpha);
-  intermediate[1] = MatrixXcd::Zero(norbs, nbeta);
-
-  // iterate over excitations
-  for (int i = 1; i < ndets; i++) {
-    matPair temp;
-    std::array<complex<double>, 2> dets;
-    for (int sz = 0; sz < 2; sz++) {
-      int rank = ciExcitations[sz][i][0].size();
-      if (rank == 0) {
-        dets[sz] = 1.;
-      }
-      else if (rank == 1) {
-        dets[sz] = greeno[sz](ciExcitations[sz][i][0](0), ciExcitations[sz][i][1](0));
-        temp[sz] = MatrixXcd::Zero(1, 1);
-        temp[sz](0, 0) = -1.;
-      }
-      else if (rank == 2) {
-        Matrix2cd cofactors = Matrix2cd::Zero(2, 2);
-        cofactors(0, 0) = greeno[sz](ciExcitations[sz][i][0](1), ciExcitations[sz][i][1](1));
-        cofactors(1, 1) = greeno[sz](ciExcitations[sz][i][0](0), ciExcitations[sz][i][1](0));
-        cofactors(0, 1) = -greeno[sz](ciExcitations[sz][i][0](1), ciExcitations[sz][i][1](0));
-        cofactors(1, 0) = -greeno[sz](ciExcitations[sz][i][0](0), ciExcitations[sz][i][1](1));
-        dets[sz] = cofactors.determinant();
-        temp[sz] = -cofactors;
-      }
-      else if (rank == 3) {
-        Matrix3cd cofactors = Matrix3cd::Zero(3, 3);
-        Matrix2cd minorMat = Matrix2cd::Zero(2, 2);
-        for (int p = 0; p < rank; p++) {
-          for (int t = 0; t < rank; t++) {
-            minorMat.setZero();
-            for (int q = 0; q < rank - 1; q++) {
-              int q1 = q < p ? q : q + 1;
-              for (int u = 0; u < rank - 1; u++) { 
-                int u1 = u < t ? u : u + 1;
-                minorMat(q, u) = greeno[sz](ciExcitations[sz][i][0](q1), ciExcitations[sz][i][1](u1));
-              }
-            }
-            double parity_pt = ((p + t)%2 == 0) ? 1. : -1.;
-            cofactors(p, t) = parity_pt * minorMat.determinant();
-            dets[sz] += greeno[sz](ciExcitations[sz][i][0](p), ciExcitations[sz][i][1](t)) * cofactors(p, t);
-          }
-        }
-        temp[sz] = -cofactors;
-      }
-      else if (rank == 4) {
-        Matrix4cd cofactors = Matrix4cd::Zero(4, 4);
-        Matrix3cd minorMat = Matrix3cd::Zero(3, 3);
-        for (int p = 0; p < rank; p++) {
-          for (int t = 0; t < rank; t++) {
-            minorMat.setZero();
-            for (int q = 0; q < rank - 1; q++) {
-              int q1 = q < p ? q : q + 1;
-              for (int u = 0; u < rank - 1; u++) { 
-                int u1 = u < t ? u : u + 1;
-                minorMat(q, u) = greeno[sz](ciExcitations[sz][i][0](q1), ciExcitations[sz][i][1](u1));
-              }
-            }
-            double parity_pt = ((p + t)%2 == 0) ? 1. : -1.;
-            cofactors(p, t) = parity_pt * minorMat.determinant();
-            dets[sz] += greeno[sz](ciExcitations[sz][i][0](p), ciExcitations[sz][i][1](t)) * cofactors(p, t);
-          }
-        }
-        temp[sz] = -cofactors;
-      }
-      else {
-        MatrixXcd cofactors = MatrixXcd::Zero(rank, rank);
-        MatrixXcd minorMat = MatrixXcd::Zero(rank-1, rank-1);
-        for (int p = 0; p < rank; p++) {
-          for (int t = 0; t < rank; t++) {
-            minorMat.setZero();
-            for (int q = 0; q < rank - 1; q++) {
-              int q1 = q < p ? q : q + 1;
-              for (int u = 0; u < rank - 1; u++) { 
-                int u1 = u < t ? u : u + 1;
-                minorMat(q, u) = greeno[sz](ciExcitations[sz][i][0](q1), ciExcitations[sz][i][1](u1));
-              }
-            }
-            double parity_pt = ((p + t)%2 == 0) ? 1. : -1.;
-            cofactors(p, t) = parity_pt * minorMat.determinant();
-            dets[sz] += greeno[sz](ciExcitations[sz][i][0](p), ciExcitations[sz][i][1](t)) * cofactors(p, t);
-          }
-        }
-        temp[sz] = cofactors;
-      }
-    }
-
-    overlap += ciCoeffs[i] * ciParity[i] * dets[0] * dets[1];
-    for (int sz = 0; sz < 2; sz++) {
-      int rank = ciExcitations[sz][i][0].size();
-      if (rank > 0) {
-        for (int p = 0; p < rank; p++) 
-          for (int t = 0; t < rank; t++)
-            intermediate[sz](ciExcitations[sz][i][1](t), ciExcitations[sz][i][0](p)) += ciCoeffs[i] * ciParity[i] * temp[sz](p, t) * dets[1 - sz];
-      }
-    }
-  }
-  
-  greenMulti[0] = greenp[0] * intermediate[0] * greeno[0] + overlap * green[0];
-  greenMulti[1] = greenp[1] * intermediate[1] * greeno[1] + overlap * green[1];
-  overlap *= overlap0;
-  greenMulti[0] *= (overlap0 / overlap);
-  greenMulti[1] *= (overlap0 / overlap);
+  matPair greenMulti;
+  multiGreen(psi, greenMulti);
   greenMulti[0] = greenMulti[0].transpose().eval();
   greenMulti[1] = greenMulti[1].transpose().eval();
   if (ham.intType == "r") {
@@ -299,8 +319,11 @@ void Multislater::forceBias(std::array<Eigen::MatrixXcd, 2>& psi, Hamiltonian& h
     //  fb(i) = (greenMultiSA).cwiseProduct(ham.chol[i].block(0, 0, norbs, ncore + nact)).sum();
   }
   else if (ham.intType == "u") {
-    for (int i = 0; i < ham.nchol; i++) 
-      fb(i) = (greenMulti[0].block(0, 0, norbs, ncore + nact)).cwiseProduct(ham.cholu[i][0].block(0, 0, norbs, ncore + nact)).sum() + (greenMulti[1].block(0, 0, norbs, ncore + nact)).cwiseProduct(ham.cholu[i][1].block(0, 0, norbs, ncore + nact)).sum();
+    MatrixXd cholBuffer;
+    for (int i = 0; i < ham.nchol; i++) {
+      fb(i) = (greenMulti[0].block(0, 0, norbs, ncore + nact)).cwiseProduct(ham.choleskyMatrix(i, cholBuffer, 0).block(0, 0, norbs, ncore + nact)).sum();
+      fb(i) += (greenMulti[1].block(0, 0, norbs, ncore + nact)).cwiseProduct(ham.choleskyMatrix(i, cholBuffer, 1).block(0, 0, norbs, ncore + nact)).sum();
+    }
   }
   //for (int i = 0; i < ham.chol.size(); i++) 
   //  fb(i) = (greenMulti[0].block(0, 0, nact, norbs)).cwiseProduct(ham.chol[i].block(0, 0, nact, norbs)).sum() + (greenMulti[1].block(0, 0, nact, norbs)).cwiseProduct(ham.chol[i].block(0, 0, nact, norbs)).sum();
@@ -318,144 +341,11 @@ void Multislater::oneRDM(std::array<Eigen::MatrixXcd, 2>& psi, Eigen::MatrixXcd&
 
 void Multislater::oneRDM(std::array<Eigen::MatrixXcd, 2>& psi, std::array<Eigen::MatrixXcd, 2>& rdmSample) 
 { 
-  int norbs = psi[0].rows();
-  int nalpha = psi[0].cols();
-  int nbeta = psi[1].cols();
-  std::array<int, 2> nelec{nalpha, nbeta};
-  size_t ndets = ciCoeffs.size();
-  rdmSample[0] = MatrixXcd::Zero(norbs, norbs);
-  rdmSample[1] = MatrixXcd::Zero(norbs, norbs);
-
-  matPair phi0T;
-  phi0T[0] = MatrixXcd::Zero(nalpha, norbs);
-  phi0T[1] = MatrixXcd::Zero(nbeta, norbs);
-  for (int i = 0; i < nalpha; i++) phi0T[0](i, refDet[0][i]) = 1.;
-  for (int i = 0; i < nbeta; i++) phi0T[1](i, refDet[1][i]) = 1.;
-
-  matPair theta, green, greenp, greeno;
-  theta[0] = psi[0] * (psi[0](refDet[0], Eigen::placeholders::all)).inverse();
-  theta[1] = psi[1] * (psi[1](refDet[1], Eigen::placeholders::all)).inverse();
-  green[0] = (theta[0] * phi0T[0]).transpose();
-  green[1] = (theta[1] * phi0T[1]).transpose();
-  greenp[0] = green[0] - MatrixXcd::Identity(norbs, norbs);
-  greenp[1] = green[1] - MatrixXcd::Identity(norbs, norbs);
-  
-  
-  greeno[0] = green[0](refDet[0], Eigen::placeholders::all);
-  greeno[1] = green[1](refDet[1], Eigen::placeholders::all);
-
-  // most quantities henceforth will be calculated in "units" of overlap0 = < phi_0 | psi >
-  complex<double> overlap0 = (psi[0](refDet[0], Eigen::placeholders::all)).determinant() * (psi[1](refDet[1], Eigen::placeholders::all)).determinant();
-  complex<double> overlap(0., 0.);
-  overlap += ciCoeffs[0];
-  matPair intermediate, greenMulti;
-  intermediate[0] = MatrixXcd::Zero(norbs, nalpha);
-  intermediate[1] = MatrixXcd::Zero(norbs, nbeta);
-
-  // iterate over excitations
-  for (int i = 1; i < ndets; i++) {
-    matPair temp;
-    std::array<complex<double>, 2> dets;
-    for (int sz = 0; sz < 2; sz++) {
-      int rank = ciExcitations[sz][i][0].size();
-      if (rank == 0) {
-        dets[sz] = 1.;
-      }
-      else if (rank == 1) {
-        dets[sz] = greeno[sz](ciExcitations[sz][i][0](0), ciExcitations[sz][i][1](0));
-        temp[sz] = MatrixXcd::Zero(1, 1);
-        temp[sz](0, 0) = -1.;
-      }
-      else if (rank == 2) {
-        Matrix2cd cofactors = Matrix2cd::Zero(2, 2);
-        cofactors(0, 0) = greeno[sz](ciExcitations[sz][i][0](1), ciExcitations[sz][i][1](1));
-        cofactors(1, 1) = greeno[sz](ciExcitations[sz][i][0](0), ciExcitations[sz][i][1](0));
-        cofactors(0, 1) = -greeno[sz](ciExcitations[sz][i][0](1), ciExcitations[sz][i][1](0));
-        cofactors(1, 0) = -greeno[sz](ciExcitations[sz][i][0](0), ciExcitations[sz][i][1](1));
-        dets[sz] = cofactors.determinant();
-        temp[sz] = -cofactors;
-      }
-      else if (rank == 3) {
-        Matrix3cd cofactors = Matrix3cd::Zero(3, 3);
-        Matrix2cd minorMat = Matrix2cd::Zero(2, 2);
-        for (int p = 0; p < rank; p++) {
-          for (int t = 0; t < rank; t++) {
-            minorMat.setZero();
-            for (int q = 0; q < rank - 1; q++) {
-              int q1 = q < p ? q : q + 1;
-              for (int u = 0; u < rank - 1; u++) { 
-                int u1 = u < t ? u : u + 1;
-                minorMat(q, u) = greeno[sz](ciExcitations[sz][i][0](q1), ciExcitations[sz][i][1](u1));
-              }
-            }
-            double parity_pt = ((p + t)%2 == 0) ? 1. : -1.;
-            cofactors(p, t) = parity_pt * minorMat.determinant();
-            dets[sz] += greeno[sz](ciExcitations[sz][i][0](p), ciExcitations[sz][i][1](t)) * cofactors(p, t);
-          }
-        }
-        temp[sz] = -cofactors;
-      }
-      else if (rank == 4) {
-        Matrix4cd cofactors = Matrix4cd::Zero(4, 4);
-        Matrix3cd minorMat = Matrix3cd::Zero(3, 3);
-        for (int p = 0; p < rank; p++) {
-          for (int t = 0; t < rank; t++) {
-            minorMat.setZero();
-            for (int q = 0; q < rank - 1; q++) {
-              int q1 = q < p ? q : q + 1;
-              for (int u = 0; u < rank - 1; u++) { 
-                int u1 = u < t ? u : u + 1;
-                minorMat(q, u) = greeno[sz](ciExcitations[sz][i][0](q1), ciExcitations[sz][i][1](u1));
-              }
-            }
-            double parity_pt = ((p + t)%2 == 0) ? 1. : -1.;
-            cofactors(p, t) = parity_pt * minorMat.determinant();
-            dets[sz] += greeno[sz](ciExcitations[sz][i][0](p), ciExcitations[sz][i][1](t)) * cofactors(p, t);
-          }
-        }
-        temp[sz] = -cofactors;
-      }
-      else {
-        MatrixXcd cofactors = MatrixXcd::Zero(rank, rank);
-        MatrixXcd minorMat = MatrixXcd::Zero(rank-1, rank-1);
-        for (int p = 0; p < rank; p++) {
-          for (int t = 0; t < rank; t++) {
-            minorMat.setZero();
-            for (int q = 0; q < rank - 1; q++) {
-              int q1 = q < p ? q : q + 1;
-              for (int u = 0; u < rank - 1; u++) { 
-                int u1 = u < t ? u : u + 1;
-                minorMat(q, u) = greeno[sz](ciExcitations[sz][i][0](q1), ciExcitations[sz][i][1](u1));
-              }
-            }
-            double parity_pt = ((p + t)%2 == 0) ? 1. : -1.;
-            cofactors(p, t) = parity_pt * minorMat.determinant();
-            dets[sz] += greeno[sz](ciExcitations[sz][i][0](p), ciExcitations[sz][i][1](t)) * cofactors(p, t);
-          }
-        }
-        temp[sz] = cofactors;
-      }
-    }
-
-    overlap += ciCoeffs[i] * ciParity[i] * dets[0] * dets[1];
-    for (int sz = 0; sz < 2; sz++) {
-      int rank = ciExcitations[sz][i][0].size();
-      if (rank > 0) {
-        for (int p = 0; p < rank; p++) 
-          for (int t = 0; t < rank; t++)
-            intermediate[sz](ciExcitations[sz][i][1](t), ciExcitations[sz][i][0](p)) += ciCoeffs[i] * ciParity[i] * temp[sz](p, t) * dets[1 - sz];
-      }
-    }
-  }
-  
-  greenMulti[0] = greenp[0] * intermediate[0] * greeno[0] + overlap * green[0];
-  greenMulti[1] = greenp[1] * intermediate[1] * greeno[1] + overlap * green[1];
-  overlap *= overlap0;
-  greenMulti[0] *= (overlap0 / overlap);
-  greenMulti[1] *= (overlap0 / overlap);
-  rdmSample[0] = greenMulti[0];
-  rdmSample[1] = greenMulti[1];
-};
+  matPair greenMulti;
+  multiGreen(psi, greenMulti);
+  rdmSample[0] = greenMulti[0];
+  rdmSample[1] = greenMulti[1];
+};
 
 //void Multislater::forceBias(std::array<Eigen::MatrixXcd, 2>& psi, Hamiltonian& ham, Eigen::VectorXcd& fb)
 //{
@@ -464,7 +354,7 @@ void Multislater::oneRDM(std::array<Eigen::MatrixXcd, 2>& psi, std::array<Eigen:
 //  int nbeta = ham.nbeta;
 //  int nchol = ham.chol.size();
 //  std::array<int, 2> nelec{nalpha, nbeta};
-//  size_t ndets = ciCoeffs.size();
+//  size_t ndets = ci.ndets;
 //  fb = VectorXcd::Zero(ham.chol.size());
 //
 //  matPair phi0T;
@@ -496,8 +386,8 @@ void Multislater::oneRDM(std::array<Eigen::MatrixXcd, 2>& psi, std::array<Eigen:
 //    hG[1] = greeno[1].cwiseProduct(ham.chol[gamma].block(0, 0, nbeta, norbs)).sum();
 //    complex<double> ene(0., 0.), overlap(0., 0.);
 //    // ref contribution
-//    overlap += ciCoeffs[0];
-//    ene += ciCoeffs[0] * (hG[0] + hG[1]);
+//    overlap += ci.coeffs[0];
+//    ene += ci.coeffs[0] * (hG[0] + hG[1]);
 //    
 //    // 1e intermediate
 //    matPair roth1;
@@ -516,7 +406,7 @@ void Multislater::oneRDM(std::array<Eigen::MatrixXcd, 2>& psi, std::array<Eigen:
 //      matPair blocks;
 //      std::array<complex<double>, 2> oneEne, dets;
 //      for (int sz = 0; sz < 2; sz++) {
-//        int rank = ciExcitations[sz][i][0].size();
+//        int rank = ci.holes(sz, i).size();
 //        if (rank == 0) {
 //          dets[sz] = 1.;
 //          oneEne[sz] = hG[sz];
@@ -525,7 +415,7 @@ void Multislater::oneRDM(std::array<Eigen::MatrixXcd, 2>& psi, std::array<Eigen:
 //          blocks[sz] = MatrixXcd::Zero(rank, rank);
 //          for (int p = 0; p < rank; p++) 
 //            for (int t = 0; t < rank; t++) 
-//              blocks[sz](p, t) = green[sz](ciExcitations[sz][i][0](p), ciExcitations[sz][i][1](t));
+//              blocks[sz](p, t) = green[sz](ci.holes(sz, i)(p), ci.particles(sz, i)(t));
 //          
 //          dets[sz] = blocks[sz].determinant();
 //          oneEne[sz] = hG[sz] * dets[sz];
@@ -534,13 +424,13 @@ void Multislater::oneRDM(std::array<Eigen::MatrixXcd, 2>& psi, std::array<Eigen:
 //          for (int p = 0; p < rank; p++) {
 //            temp = blocks[sz];
 //            for (int t = 0; t < rank; t++)
-//              temp(p, t) = roth1[sz](ciExcitations[sz][i][0](p), ciExcitations[sz][i][1](t));
+//              temp(p, t) = roth1[sz](ci.holes(sz, i)(p), ci.particles(sz, i)(t));
 //            oneEne[sz] -= temp.determinant();
 //          }
 //        }
 //      }
-//      overlap += ciCoeffs[i] * ciParity[i] * dets[0] * dets[1];
-//      ene += ciCoeffs[i] * ciParity[i] * (oneEne[0] * dets[1] + dets[0] * oneEne[1]);
+//      overlap += ci.coeffs[i] * ci.parity[i] * dets[0] * dets[1];
+//      ene += ci.coeffs[i] * ci.parity[i] * (oneEne[0] * dets[1] + dets[0] * oneEne[1]);
 //    }
 //    overlap *= overlap0;
 //    ene *= (overlap0 / overlap);
@@ -559,6 +449,121 @@ void Multislater::forceBias(Eigen::MatrixXcd& psi, Hamiltonian& ham, Eigen::Vect
 };
 
 
+// rank bucketed kernels for hamAndOverlap, the blocks of all strings of a bucket are stored as the
+// columns of a (rank * rank) x nstrings matrix, block(p, t) = mat(rows(p, s), cols(t, s) - colShift)
+static void gatherBlocks(const MatrixXcd& mat, const Multislater::StringBucket& bucket, int colShift, MatrixXcd& blocks)
+{
+  int rank = bucket.rows.rows();
+  int n = bucket.rows.cols();
+  blocks.resize(rank * rank, n);
+  for (int s = 0; s < n; s++)
+    for (int t = 0; t < rank; t++)
+      for (int p = 0; p < rank; p++)
+        blocks(p + rank * t, s) = mat(bucket.rows(p, s), bucket.cols(t, s) - colShift);
+};
+
+
+// determinants of the blocks, closed form and vectorized over the strings for ranks 1 and 2
+static void blockDets(int rank, const MatrixXcd& blocks, PartialPivLU<MatrixXcd>& lu, VectorXcd& dets)
+{
+  int n = blocks.cols();
+  if (rank == 1) dets = blocks.row(0).transpose();
+  else if (rank == 2) dets = (blocks.row(0).array() * blocks.row(3).array() - blocks.row(1).array() * blocks.row(2).array()).transpose();
+  else {
+    dets.resize(n);
+    if (rank == 3) 
+      for (int s = 0; s < n; s++) dets(s) = Map<const Matrix3cd>(blocks.col(s).data()).determinant();
+    else if (rank == 4) 
+      for (int s = 0; s < n; s++) dets(s) = Map<const Matrix4cd>(blocks.col(s).data()).determinant();
+    else 
+      for (int s = 0; s < n; s++) dets(s) = lu.compute(Map<const MatrixXcd>(blocks.col(s).data(), rank, rank)).determinant();
+  }
+};
+
+
+// sum over p of the determinants of the blocks with row p replaced by the same row of others
+static void rowReplacedDets(int rank, const MatrixXcd& blocks, const MatrixXcd& others, PartialPivLU<MatrixXcd>& lu, VectorXcd& dets)
+{
+  int n = blocks.cols();
+  if (rank == 1) dets = others.row(0).transpose();
+  else if (rank == 2) dets = (  others.row(0).array() * blocks.row(3).array() - blocks.row(1).array() * others.row(2).array()
+                              + blocks.row(0).array() * others.row(3).array() - others.row(1).array() * blocks.row(2).array()).transpose();
+  else if (rank == 3) {
+    dets = VectorXcd::Zero(n);
+    Matrix3cd temp;
+    for (int s = 0; s < n; s++) {
+      for (int p = 0; p < rank; p++) {
+        temp = Map<const Matrix3cd>(blocks.col(s).data());
+        temp.row(p) = Map<const Matrix3cd>(others.col(s).data()).row(p);
+        dets(s) += temp.determinant();
+      }
+    }
+  }
+  else if (rank == 4) {
+    dets = VectorXcd::Zero(n);
+    Matrix4cd temp;
+    for (int s = 0; s < n; s++) {
+      for (int p = 0; p < rank; p++) {
+        temp = Map<const Matrix4cd>(blocks.col(s).data());
+        temp.row(p) = Map<const Matrix4cd>(others.col(s).data()).row(p);
+        dets(s) += temp.determinant();
+      }
+    }
+  }
+  else {
+    dets = VectorXcd::Zero(n);
+    MatrixXcd temp(rank, rank);
+    for (int s = 0; s < n; s++) {
+      for (int p = 0; p < rank; p++) {
+        temp = Map<const MatrixXcd>(blocks.col(s).data(), rank, rank);
+        temp.row(p) = Map<const MatrixXcd>(others.col(s).data(), rank, rank).row(p);
+        dets(s) += lu.compute(temp).determinant();
+      }
+    }
+  }
+};
+
+
+// two body term of the cholesky loop, sum over row pairs p < q and column pairs t < u of the signed
+// complementary minors of the blocks times the 2 x 2 minors of others
+static void pairMinors(int rank, const MatrixXcd& blocks, const MatrixXcd& others, PartialPivLU<MatrixXcd>& lu, VectorXcd& twoEne)
+{
+  int n = blocks.cols();
+  if (rank == 1) twoEne = VectorXcd::Zero(n);
+  else if (rank == 2) twoEne = 2. * (others.row(0).array() * others.row(3).array() - others.row(1).array() * others.row(2).array()).transpose();
+  else {
+    twoEne = VectorXcd::Zero(n);
+    std::vector<int> diff0(rank - 2), diff1(rank - 2);
+    MatrixXcd minorMat(rank - 2, rank - 2);
+    for (int p = 0; p < rank; p++) {
+      for (int q = p + 1; q < rank; q++) {
+        double parity_pq = ((p + q + 1)%2 == 0) ? 1. : -1.;
+        for (int mu = 0, k = 0; mu < rank; mu++) if (mu != p && mu != q) diff0[k++] = mu;
+        for (int t = 0; t < rank; t++) {
+          for (int u = t + 1; u < rank; u++) {
+            double parity_tu = ((t + u + 1)%2 == 0) ? 1. : -1.;
+            for (int nu = 0, k = 0; nu < rank; nu++) if (nu != t && nu != u) diff1[k++] = nu;
+            for (int s = 0; s < n; s++) {
+              Map<const MatrixXcd> block(blocks.col(s).data(), rank, rank), other(others.col(s).data(), rank, rank);
+              complex<double> blockBlockDet;
+              if (rank == 3) blockBlockDet = block(diff0[0], diff1[0]);
+              else if (rank == 4) blockBlockDet = block(diff0[0], diff1[0]) * block(diff0[1], diff1[1]) - block(diff0[0], diff1[1]) * block(diff0[1], diff1[0]);
+              else {
+                for (int mup = 0; mup < rank - 2; mup++) 
+                  for (int nup = 0; nup < rank - 2; nup++) 
+                    minorMat(mup, nup) = block(diff0[mup], diff1[nup]);
+                blockBlockDet = lu.compute(minorMat).determinant();
+              }
+              twoEne(s) += 2. * parity_pq * parity_tu * blockBlockDet * (other(p, t) * other(q, u) - other(q, t) * other(p, u));
+            }
+          }
+        }
+      }
+    }
+  }
+};
+
+
 std::array<std::complex<double>, 2> Multislater::hamAndOverlap(std::array<Eigen::MatrixXcd, 2>& psi, Hamiltonian& ham)
 {
   int norbs = ham.norbs;
@@ -566,7 +571,7 @@ std::array<std::complex<double>, 2> Multislater::hamAndOverlap(std::array<Eigen:
   int nbeta = ham.nbeta;
   int nchol = ham.ncholEne;
   std::array<int, 2> nelec{nalpha, nbeta};
-  size_t ndets = ciCoeffs.size();
+  size_t ndets = ci.ndets;
   
 
   matPair phi0T;
@@ -592,7 +597,7 @@ std::array<std::complex<double>, 2> Multislater::hamAndOverlap(std::array<Eigen:
   complex<double> overlap0 = (phi0T[0] * psi[0]).determinant() * (phi0T[1] * psi[1]).determinant();
  
   // ref contribution
-  overlap += ciCoeffs[0];
+  overlap += ci.coeffs[0];
   std::array<complex<double>, 2> hG;
   matPair roth1;
   if (ham.intType == "r") {
@@ -611,49 +616,41 @@ std::array<std::complex<double>, 2> Multislater::hamAndOverlap(std::array<Eigen:
     roth1[0] = (greeno[0] * ham.h1u[0]) * greenp[0];
     roth1[1] = (greeno[1] * ham.h1u[1]) * greenp[1];
   }
-  ene += ciCoeffs[0] * (hG[0] + hG[1]);
+  ene += ci.coeffs[0] * (hG[0] + hG[1]);
   
-  // G^{p}_{t} blocks
-  vector<matPair> gBlocks;
-  vector<std::array<complex<double>, 2>> gBlockDets;
-  matPair empty;
-  gBlocks.push_back(empty);
-  std::array<complex<double>, 2> identity{1., 1.};
-  gBlockDets.push_back(identity);
+  // string determinants and one body terms, per rank bucket and scattered to string order
+  // rank 0 strings have unit determinants
+  std::array<std::vector<MatrixXcd>, 2> gBlocks;
+  std::array<std::vector<VectorXcd>, 2> gBlockDets;
+  std::array<VectorXcd, 2> dets, oneEneS, twoEneS;
+  MatrixXcd others;
+  VectorXcd bucketOne, bucketTwo;
+  PartialPivLU<MatrixXcd> lu;
+  for (int sz = 0; sz < 2; sz++) {
+    int nstrings = ciStrings[sz].size();
+    dets[sz] = VectorXcd::Ones(nstrings);
+    oneEneS[sz] = VectorXcd::Constant(nstrings, hG[sz]);
+    gBlocks[sz].resize(stringBuckets[sz].size());
+    gBlockDets[sz].resize(stringBuckets[sz].size());
+    for (int k = 0; k < stringBuckets[sz].size(); k++) {
+      StringBucket& bucket = stringBuckets[sz][k];
+      int rank = k + 1;
+      gatherBlocks(greeno[sz], bucket, 0, gBlocks[sz][k]);
+      gatherBlocks(roth1[sz], bucket, 0, others);
+      blockDets(rank, gBlocks[sz][k], lu, gBlockDets[sz][k]);
+      rowReplacedDets(rank, gBlocks[sz][k], others, lu, bucketOne);
+      for (int j = 0; j < bucket.strings.size(); j++) {
+        dets[sz](bucket.strings[j]) = gBlockDets[sz][k](j);
+        oneEneS[sz](bucket.strings[j]) = hG[sz] * gBlockDets[sz][k](j) - bucketOne(j);
+      }
+    }
+  }
   
   // iterate over excitations
   for (int i = 1; i < ndets; i++) {
-    matPair blocks;
-    std::array<complex<double>, 2> oneEne, dets;
-    for (int sz = 0; sz < 2; sz++) {
-      int rank = ciExcitations[sz][i][0].size();
-      if (rank == 0) {
-        dets[sz] = 1.;
-        oneEne[sz] = hG[sz];
-      }
-      else {
-        blocks[sz] = MatrixXcd::Zero(rank, rank);
-        for (int p = 0; p < rank; p++) 
-          for (int t = 0; t < rank; t++) 
-            blocks[sz](p, t) = greeno[sz](ciExcitations[sz][i][0](p), ciExcitations[sz][i][1](t));
-        
-        dets[sz] = blocks[sz].determinant();
-        oneEne[sz] = hG[sz] * dets[sz];
-
-        MatrixXcd temp;
-        for (int p = 0; p < rank; p++) {
-          temp = blocks[sz];
-          for (int t = 0; t < rank; t++)
-            temp(p, t) = roth1[sz](ciExcitations[sz][i][0](p), ciExcitations[sz][i][1](t));
-          oneEne[sz] -= temp.determinant();
-        }
-      }
-    }
-
-    overlap += ciCoeffs[i] * ciParity[i] * dets[0] * dets[1];
-    ene += ciCoeffs[i] * ciParity[i] * (oneEne[0] * dets[1] + dets[0] * oneEne[1]);
-    gBlocks.push_back(blocks);
-    gBlockDets.push_back(dets);
+    int a = ciStringIndex[0][i], b = ciStringIndex[1][i];
+    overlap += ci.coeffs[i] * ci.parity[i] * dets[0](a) * dets[1](b);
+    ene += ci.coeffs[i] * ci.parity[i] * (oneEneS[0](a) * dets[1](b) + dets[0](a) * oneEneS[1](b));
   }
   
   // 2e intermediates
@@ -667,270 +664,64 @@ std::array<std::complex<double>, 2> Multislater::hamAndOverlap(std::array<Eigen:
   l2G2Tot[1] = complex<double>(0., 0.);
   
   // iterate over cholesky
-  //for (int n = 0; n < chol.size(); n++) {
-  for (int n = 0; n < nchol; n++) {
+  MatrixXd cholBuffer;
+  for (int m = 0; m < nchol; m++) {
+    int n = ham.cholEneIndex(m);
     std::array<complex<double>, 2> lG, l2G2;
     matPair exc;
     for (int sz = 0; sz < 2; sz++) {
-      if (ham.intType == "r") {
-        exc[sz].noalias() = ham.chol[n](refDet[sz], Eigen::placeholders::all) * theta[sz];
-        lG[sz] = exc[sz].trace();
-        l2G2[sz] = lG[sz] * lG[sz] - exc[sz].cwiseProduct(exc[sz].transpose()).sum();
-        l2G2Tot[sz] += l2G2[sz];
-        int2[sz].noalias() = (greeno[sz] * ham.chol[n].block(0, 0, norbs, nact + ncore)) * greenp[sz].block(0, ncore, nact + ncore, nact);
-        int1[sz].noalias() += lG[sz] * int2[sz];
-        int1[sz].noalias() -= (greeno[sz] * ham.chol[n](Eigen::placeholders::all, refDet[sz])) * int2[sz];
-      }
-      else if (ham.intType == "u") {
-        exc[sz].noalias() = ham.cholu[n][sz](refDet[sz], Eigen::placeholders::all) * theta[sz];
-        lG[sz] = exc[sz].trace();
-        l2G2[sz] = lG[sz] * lG[sz] - exc[sz].cwiseProduct(exc[sz].transpose()).sum();
-        l2G2Tot[sz] += l2G2[sz];
-        int2[sz].noalias() = (greeno[sz] * ham.cholu[n][sz].block(0, 0, norbs, nact + ncore)) * greenp[sz].block(0, ncore, nact + ncore, nact);
-        int1[sz].noalias() += lG[sz] * int2[sz];
-        int1[sz].noalias() -= (greeno[sz] * ham.cholu[n][sz](Eigen::placeholders::all, refDet[sz])) * int2[sz];
+      Eigen::Map<const MatrixXd> cholN = ham.choleskyMatrix(n, cholBuffer, sz);
+      exc[sz].noalias() = cholN(refDet[sz], Eigen::placeholders::all) * theta[sz];
+      lG[sz] = exc[sz].trace();
+      l2G2[sz] = lG[sz] * lG[sz] - exc[sz].cwiseProduct(exc[sz].transpose()).sum();
+      l2G2Tot[sz] += l2G2[sz];
+      int2[sz].noalias() = (greeno[sz] * cholN.block(0, 0, norbs, nact + ncore)) * greenp[sz].block(0, ncore, nact + ncore, nact);
+      int1[sz].noalias() += lG[sz] * int2[sz];
+      int1[sz].noalias() -= (greeno[sz] * cholN(Eigen::placeholders::all, refDet[sz])) * int2[sz];
+    
+      // string one and two body terms
+      oneEneS[sz].setConstant(lG[sz]);
+      twoEneS[sz].setZero(ciStrings[sz].size());
+      for (int k = 0; k < stringBuckets[sz].size(); k++) {
+        StringBucket& bucket = stringBuckets[sz][k];
+        int rank = k + 1;
+        gatherBlocks(int2[sz], bucket, ncore, others);
+        rowReplacedDets(rank, gBlocks[sz][k], others, lu, bucketOne);
+        pairMinors(rank, gBlocks[sz][k], others, lu, bucketTwo);
+        for (int j = 0; j < bucket.strings.size(); j++) {
+          oneEneS[sz](bucket.strings[j]) = lG[sz] * gBlockDets[sz][k](j) - bucketOne(j);
+          twoEneS[sz](bucket.strings[j]) = bucketTwo(j);
+        }
       }
     }
 
     // ref contribution
-    ene += ciCoeffs[0] * (l2G2[0] + l2G2[1] + 2. * lG[0] * lG[1]) / 2.;
+    ene += ci.coeffs[0] * (l2G2[0] + l2G2[1] + 2. * lG[0] * lG[1]) / 2.;
     
     // iterate over excitations
     for (int i = 1; i < ndets; i++) {
-      std::array<complex<double>, 2> oneEne, twoEne;
-      for (int sz = 0; sz < 2; sz++) {
-        int rank = ciExcitations[sz][i][0].size();
-        if (rank == 0) {
-          oneEne[sz] = lG[sz];
-        }
-        else if (rank == 1) {
-          oneEne[sz] = lG[sz] * gBlockDets[i][sz] - int2[sz](ciExcitations[sz][i][0](0), ciExcitations[sz][i][1](0) - ncore);
-        }
-        else if (rank == 2) {
-          oneEne[sz] = lG[sz] * gBlockDets[i][sz] 
-                     - int2[sz](ciExcitations[sz][i][0](0), ciExcitations[sz][i][1](0) - ncore) * gBlocks[i][sz](1, 1)
-                     + int2[sz](ciExcitations[sz][i][0](0), ciExcitations[sz][i][1](1) - ncore) * gBlocks[i][sz](1, 0)
-                     + int2[sz](ciExcitations[sz][i][0](1), ciExcitations[sz][i][1](0) - ncore) * gBlocks[i][sz](0, 1)
-                     - int2[sz](ciExcitations[sz][i][0](1), ciExcitations[sz][i][1](1) - ncore) * gBlocks[i][sz](0, 0);
-
-          twoEne[sz] = 2. * (  int2[sz](ciExcitations[sz][i][0](0), ciExcitations[sz][i][1](0) - ncore)    
-                             * int2[sz](ciExcitations[sz][i][0](1), ciExcitations[sz][i][1](1) - ncore) 
-                             - int2[sz](ciExcitations[sz][i][0](1), ciExcitations[sz][i][1](0) - ncore) 
-                             * int2[sz](ciExcitations[sz][i][0](0), ciExcitations[sz][i][1](1) - ncore)  );
-        }
-        else if (rank == 3) {
-          // oneEne
-          {
-            oneEne[sz] = lG[sz] * gBlockDets[i][sz];
-
-            Matrix3cd temp;
-            for (int p = 0; p < rank; p++) {
-              temp = gBlocks[i][sz];
-              for (int t = 0; t < rank; t++)
-                temp(p, t) = int2[sz](ciExcitations[sz][i][0](p), ciExcitations[sz][i][1](t) - ncore);
-              oneEne[sz] -= temp.determinant();
-            }
-          }
-          
-          // twoEne
-          {
-            twoEne[sz] = complex<double>(0., 0.);
-            // term 3
-            for (int p = 0; p < rank; p++) {
-              for (int q = p + 1; q < rank; q++) {
-                double parity_pq = ((p + q + 1)%2 == 0) ? 1. : -1.;
-                for (int t = 0; t < rank; t++) {
-                  for (int u = t + 1; u < rank; u++) {
-                    double parity_tu = ((t + u + 1)%2 == 0) ? 1. : -1.;
-                    complex<double> blockBlockDet = gBlocks[i][sz](3 - p - q, 3 - t - u);
-                    twoEne[sz] += 2. * parity_pq * parity_tu * blockBlockDet * (  int2[sz](ciExcitations[sz][i][0](p), ciExcitations[sz][i][1](t) - ncore) 
-                                                                                * int2[sz](ciExcitations[sz][i][0](q), ciExcitations[sz][i][1](u) - ncore) 
-                                                                                - int2[sz](ciExcitations[sz][i][0](q), ciExcitations[sz][i][1](t) - ncore) 
-                                                                                * int2[sz](ciExcitations[sz][i][0](p), ciExcitations[sz][i][1](u) - ncore)  );
-                  }
-                }
-              }
-            }
-          }
-        }
-        else if (rank == 4) {
-          // oneEne
-          {
-            oneEne[sz] = lG[sz] * gBlockDets[i][sz];
-
-            Matrix4cd temp;
-            for (int p = 0; p < rank; p++) {
-              temp = gBlocks[i][sz];
-              for (int t = 0; t < rank; t++)
-                temp(p, t) = int2[sz](ciExcitations[sz][i][0](p), ciExcitations[sz][i][1](t) - ncore);
-              oneEne[sz] -= temp.determinant();
-            }
-          }
-          
-          // twoEne
-          {
-            twoEne[sz] = complex<double>(0., 0.);
-            // term 3
-            for (int p = 0; p < rank; p++) {
-              for (int q = p + 1; q < rank; q++) {
-                double parity_pq = ((p + q + 1)%2 == 0) ? 1. : -1.;
-                int pp, qp;
-                if (p == 0) {
-                  pp = 3 - q + q/3; qp = 6 - q - pp;
-                }
-                else {
-                  pp = 0; qp = 6 - p - q;
-                }
-                for (int t = 0; t < rank; t++) {
-                  for (int u = t + 1; u < rank; u++) {
-                    double parity_tu = ((t + u + 1)%2 == 0) ? 1. : -1.;
-                    int tp, up;
-                    if (t == 0) {
-                      tp = 3 - u + u/3; up = 6 - u - tp;
-                    }
-                    else {
-                      tp = 0; up = 6 - t - u;
-                    }
-                    
-                    complex<double> blockBlockDet = gBlocks[i][sz](pp, tp) * gBlocks[i][sz](qp, up) - gBlocks[i][sz](pp, up) * gBlocks[i][sz](qp, tp);
-
-                    twoEne[sz] += 2. * parity_pq * parity_tu * blockBlockDet * (  int2[sz](ciExcitations[sz][i][0](p), ciExcitations[sz][i][1](t) - ncore) 
-                                                                                * int2[sz](ciExcitations[sz][i][0](q), ciExcitations[sz][i][1](u) - ncore) 
-                                                                                - int2[sz](ciExcitations[sz][i][0](q), ciExcitations[sz][i][1](t) - ncore) 
-                                                                                * int2[sz](ciExcitations[sz][i][0](p), ciExcitations[sz][i][1](u) - ncore)  );
-                  }
-                }
-              }
-            }
-          }
-        } 
-        else {
-          // oneEne
-          {
-            oneEne[sz] = lG[sz] * gBlockDets[i][sz];
-
-            MatrixXcd temp;
-            for (int p = 0; p < rank; p++) {
-              temp = gBlocks[i][sz];
-              for (int t = 0; t < rank; t++)
-                temp(p, t) = int2[sz](ciExcitations[sz][i][0](p), ciExcitations[sz][i][1](t) - ncore);
-              oneEne[sz] -= temp.determinant();
-            }
-          }
-          
-          // twoEne
-          {
-            twoEne[sz] = complex<double>(0., 0.);
-            // term 3
-            vector<int> range(rank);
-            for (int p = 0; p < rank; p++) range[p] = p;
-            for (int p = 0; p < rank; p++) {
-              for (int q = p + 1; q < rank; q++) {
-                double parity_pq = ((p + q + 1)%2 == 0) ? 1. : -1.;
-                vector<int> pq = {p, q};
-                vector<int> diff0;
-                std::set_difference(range.begin(), range.end(), pq.begin(), pq.end(), std::inserter(diff0, diff0.begin()));
-                for (int t = 0; t < rank; t++) {
-                  for (int u = t + 1; u < rank; u++) {
-                    double parity_tu = ((t + u + 1)%2 == 0) ? 1. : -1.;
-                    vector<int> tu = {t, u};
-                    vector<int> diff1;
-                    std::set_difference(range.begin(), range.end(), tu.begin(), tu.end(), std::inserter(diff1, diff1.begin()));
-                    
-                    MatrixXcd blockBlock = MatrixXcd::Zero(rank - 2, rank - 2);
-                    for (int mup = 0; mup < rank - 2; mup++) 
-                      for (int nup = 0; nup < rank - 2; nup++) 
-                        blockBlock(mup, nup) = gBlocks[i][sz](diff0[mup], diff1[nup]);
-                    complex<double> blockBlockDet = blockBlock.determinant();
-
-                    twoEne[sz] += 2. * parity_pq * parity_tu * blockBlockDet * (  int2[sz](ciExcitations[sz][i][0](p), ciExcitations[sz][i][1](t) - ncore) 
-                                                                                * int2[sz](ciExcitations[sz][i][0](q), ciExcitations[sz][i][1](u) - ncore) 
-                                                                                - int2[sz](ciExcitations[sz][i][0](q), ciExcitations[sz][i][1](t) - ncore) 
-                                                                                * int2[sz](ciExcitations[sz][i][0](p), ciExcitations[sz][i][1](u) - ncore)  );
-                  }
-                }
-              }
-            }
-          }
-        } 
-      } // sz
-
-      ene += ciParity[i] * ciCoeffs[i] * (twoEne[0] * gBlockDets[i][1] + 2. * oneEne[0] * oneEne[1] + gBlockDets[i][0] * twoEne[1]) / 2.;
-    
-    } // dets
+      int a = ciStringIndex[0][i], b = ciStringIndex[1][i];
+      ene += ci.parity[i] * ci.coeffs[i] * (twoEneS[0](a) * dets[1](b) + 2. * oneEneS[0](a) * oneEneS[1](b) + dets[0](a) * twoEneS[1](b)) / 2.;
+    }
   } // chol
+  
+  // string two body terms from the accumulated intermediates
+  for (int sz = 0; sz < 2; sz++) {
+    twoEneS[sz].setConstant(ciStrings[sz].size(), l2G2Tot[sz]);
+    for (int k = 0; k < stringBuckets[sz].size(); k++) {
+      StringBucket& bucket = stringBuckets[sz][k];
+      gatherBlocks(int1[sz], bucket, ncore, others);
+      rowReplacedDets(k + 1, gBlocks[sz][k], others, lu, bucketOne);
+      for (int j = 0; j < bucket.strings.size(); j++) 
+        twoEneS[sz](bucket.strings[j]) = l2G2Tot[sz] * gBlockDets[sz][k](j) - 2. * bucketOne(j);
+    }
+  }
     
   // iterate over excitations
   for (int i = 1; i < ndets; i++) {
-    std::array<complex<double>, 2> oneEne, twoEne;
-    for (int sz = 0; sz < 2; sz++) {
-      int rank = ciExcitations[sz][i][0].size();
-      if (rank == 0) {
-        twoEne[sz] = l2G2Tot[sz];
-      }
-      else if (rank == 1) {
-        twoEne[sz] = l2G2Tot[sz] * gBlockDets[i][sz] - 2. * int1[sz](ciExcitations[sz][i][0](0), ciExcitations[sz][i][1](0) - ncore);
-      }
-      else if (rank == 2) {
-        twoEne[sz] = l2G2Tot[sz] * gBlockDets[i][sz]
-                   + 2. * (- int1[sz](ciExcitations[sz][i][0](0), ciExcitations[sz][i][1](0) - ncore) * gBlocks[i][sz](1, 1)
-                           + int1[sz](ciExcitations[sz][i][0](0), ciExcitations[sz][i][1](1) - ncore) * gBlocks[i][sz](1, 0)
-                           + int1[sz](ciExcitations[sz][i][0](1), ciExcitations[sz][i][1](0) - ncore) * gBlocks[i][sz](0, 1)
-                           - int1[sz](ciExcitations[sz][i][0](1), ciExcitations[sz][i][1](1) - ncore) * gBlocks[i][sz](0, 0)  );
-      }
-      else if (rank == 3) {
-        // twoEne
-        {
-          // term 1
-          twoEne[sz] = l2G2Tot[sz] * gBlockDets[i][sz];
-
-          //term 2
-          Matrix3cd temp;
-          for (int p = 0; p < rank; p++) {
-            temp = gBlocks[i][sz];
-            for (int t = 0; t < rank; t++)
-              temp(p, t) = int1[sz](ciExcitations[sz][i][0](p), ciExcitations[sz][i][1](t) - ncore);
-            twoEne[sz] -= 2. * temp.determinant();
-          }
-        }
-      } 
-      else if (rank == 4) {
-        // twoEne
-        {
-          // term 1
-          twoEne[sz] = l2G2Tot[sz] * gBlockDets[i][sz];
-
-          //term 2
-          Matrix4cd temp;
-          for (int p = 0; p < rank; p++) {
-            temp = gBlocks[i][sz];
-            for (int t = 0; t < rank; t++)
-              temp(p, t) = int1[sz](ciExcitations[sz][i][0](p), ciExcitations[sz][i][1](t) - ncore);
-            twoEne[sz] -= 2. * temp.determinant();
-          }
-        }
-      } 
-      else {
-        // twoEne
-        {
-          // term 1
-          twoEne[sz] = l2G2Tot[sz] * gBlockDets[i][sz];
-
-          //term 2
-          MatrixXcd temp;
-          for (int p = 0; p < rank; p++) {
-            temp = gBlocks[i][sz];
-            for (int t = 0; t < rank; t++)
-              temp(p, t) = int1[sz](ciExcitations[sz][i][0](p), ciExcitations[sz][i][1](t) - ncore);
-            twoEne[sz] -= 2. * temp.determinant();
-          }
-        }
-      } 
-    } // sz
-
-    ene += ciParity[i] * ciCoeffs[i] * (twoEne[0] * gBlockDets[i][1] + gBlockDets[i][0] * twoEne[1]) / 2.;
-  
-  } // dets
+    int a = ciStringIndex[0][i], b = ciStringIndex[1][i];
+    ene += ci.parity[i] * ci.coeffs[i] * (twoEneS[0](a) * dets[1](b) + dets[0](a) * twoEneS[1](b)) / 2.;
+  }
 
   overlap *= overlap0;
   ene *= overlap0;
@@ -950,7 +741,7 @@ std::array<std::complex<double>, 2> Multislater::hamAndOverlap(Eigen::MatrixXcd&
   int nbeta = ham.nbeta;
   int nchol = ham.ncholEne;
   std::array<int, 2> nelec{nalpha, nbeta};
-  size_t ndets = ciCoeffs.size();
+  size_t ndets = ci.ndets;
 
   MatrixXcd phi0T;
   phi0T = MatrixXcd::Zero(nalpha, norbs);
@@ -969,10 +760,10 @@ std::array<std::complex<double>, 2> Multislater::hamAndOverlap(Eigen::MatrixXcd&
   complex<double> overlap0 = (phi0T * psi).determinant() * (phi0T * psi).determinant();
  
   // ref contribution
-  overlap += ciCoeffs[0];
+  overlap += ci.coeffs[0];
   complex<double> hG;
   hG = greeno.cwiseProduct(ham.h1(refDet[0], Eigen::placeholders::all)).sum();
-  ene += 2. * ciCoeffs[0] * hG;
+  ene += 2. * ci.coeffs[0] * hG;
   
   // 1e intermediate
   MatrixXcd roth1;
@@ -991,7 +782,7 @@ std::array<std::complex<double>, 2> Multislater::hamAndOverlap(Eigen::MatrixXcd&
     matPair blocks;
     std::array<complex<double>, 2> oneEne, dets;
     for (int sz = 0; sz < 2; sz++) {
-      int rank = ciExcitations[sz][i][0].size();
+      int rank = ci.holes(sz, i).size();
       if (rank == 0) {
         dets[sz] = 1.;
         oneEne[sz] = hG;
@@ -1000,7 +791,7 @@ std::array<std::complex<double>, 2> Multislater::hamAndOverlap(Eigen::MatrixXcd&
         blocks[sz] = MatrixXcd::Zero(rank, rank);
         for (int p = 0; p < rank; p++) 
           for (int t = 0; t < rank; t++) 
-            blocks[sz](p, t) = greeno(ciExcitations[sz][i][0](p), ciExcitations[sz][i][1](t));
+            blocks[sz](p, t) = greeno(ci.holes(sz, i)(p), ci.particles(sz, i)(t));
         
         dets[sz] = blocks[sz].determinant();
         oneEne[sz] = hG * dets[sz];
@@ -1009,14 +800,14 @@ std::array<std::complex<double>, 2> Multislater::hamAndOverlap(Eigen::MatrixXcd&
         for (int p = 0; p < rank; p++) {
           temp = blocks[sz];
           for (int t = 0; t < rank; t++)
-            temp(p, t) = roth1(ciExcitations[sz][i][0](p), ciExcitations[sz][i][1](t));
+            temp(p, t) = roth1(ci.holes(sz, i)(p), ci.particles(sz, i)(t));
           oneEne[sz] -= temp.determinant();
         }
       }
     }
 
-    overlap += ciCoeffs[i] * ciParity[i] * dets[0] * dets[1];
-    ene += ciCoeffs[i] * ciParity[i] * (oneEne[0] * dets[1] + dets[0] * oneEne[1]);
+    overlap += ci.coeffs[i] * ci.parity[i] * dets[0] * dets[1];
+    ene += ci.coeffs[i] * ci.parity[i] * (oneEne[0] * dets[1] + dets[0] * oneEne[1]);
     gBlocks.push_back(blocks);
     gBlockDets.push_back(dets);
   }
@@ -1027,7 +818,10 @@ std::array<std::complex<double>, 2> Multislater::hamAndOverlap(Eigen::MatrixXcd&
   int2 = 0. * greeno.block(0, 0, nelec[0], nact);
   complex<double> l2G2Tot(0., 0.);
   
-  for (int n = 0; n < nchol; n++) {
+  MatrixXd cholBuffer;
+  for (int m = 0; m < nchol; m++) {
+    int n = ham.cholEneIndex(m);
+    Eigen::Map<const MatrixXd> cholN = ham.choleskyMatrix(n, cholBuffer);
     complex<double> lG, l2G2;
     MatrixXcd exc;
     //exc.noalias() = ham.chol[n].block(0, 0, nelec[0], norbs) * theta;
@@ -1038,39 +832,39 @@ std::array<std::complex<double>, 2> Multislater::hamAndOverlap(Eigen::MatrixXcd&
     //int1.noalias() += lG * int2;
     //int1.noalias() -= (greeno * ham.chol[n].block(0, 0, norbs, nelec[0])) * int2;
         
-    exc.noalias() = ham.chol[n](refDet[0], Eigen::placeholders::all) * theta;
+    exc.noalias() = cholN(refDet[0], Eigen::placeholders::all) * theta;
     lG = exc.trace();
     l2G2 = lG * lG - exc.cwiseProduct(exc.transpose()).sum();
     l2G2Tot += l2G2;
-    int2.noalias() = (greeno * ham.chol[n].block(0, 0, norbs, nact + ncore)) * greenp.block(0, ncore, nact + ncore, nact);
+    int2.noalias() = (greeno * cholN.block(0, 0, norbs, nact + ncore)) * greenp.block(0, ncore, nact + ncore, nact);
     int1.noalias() += lG * int2;
-    int1.noalias() -= (greeno * ham.chol[n](Eigen::placeholders::all, refDet[0])) * int2;
+    int1.noalias() -= (greeno * cholN(Eigen::placeholders::all, refDet[0])) * int2;
 
     // ref contribution
-    ene += ciCoeffs[0] * (l2G2 + lG * lG);
+    ene += ci.coeffs[0] * (l2G2 + lG * lG);
     
     // iterate over excitations
     for (int i = 1; i < ndets; i++) {
       std::array<complex<double>, 2> oneEne, twoEne;
       for (int sz = 0; sz < 2; sz++) {
-        int rank = ciExcitations[sz][i][0].size();
+        int rank = ci.holes(sz, i).size();
         if (rank == 0) {
           oneEne[sz] = lG;
         }
         if (rank == 1) {
-          oneEne[sz] = lG * gBlockDets[i][sz] - int2(ciExcitations[sz][i][0](0), ciExcitations[sz][i][1](0) - ncore);
+          oneEne[sz] = lG * gBlockDets[i][sz] - int2(ci.holes(sz, i)(0), ci.particles(sz, i)(0) - ncore);
         }
         else if (rank == 2) {
           oneEne[sz] = lG * gBlockDets[i][sz] 
-                     - int2(ciExcitations[sz][i][0](0), ciExcitations[sz][i][1](0) - ncore) * gBlocks[i][sz](1, 1)
-                     + int2(ciExcitations[sz][i][0](0), ciExcitations[sz][i][1](1) - ncore) * gBlocks[i][sz](1, 0)
-                     + int2(ciExcitations[sz][i][0](1), ciExcitations[sz][i][1](0) - ncore) * gBlocks[i][sz](0, 1)
-                     - int2(ciExcitations[sz][i][0](1), ciExcitations[sz][i][1](1) - ncore) * gBlocks[i][sz](0, 0);
-
-          twoEne[sz] = 2. * (  int2(ciExcitations[sz][i][0](0), ciExcitations[sz][i][1](0) - ncore)    
-                             * int2(ciExcitations[sz][i][0](1), ciExcitations[sz][i][1](1) - ncore) 
-                             - int2(ciExcitations[sz][i][0](1), ciExcitations[sz][i][1](0) - ncore) 
-                             * int2(ciExcitations[sz][i][0](0), ciExcitations[sz][i][1](1) - ncore)  );
+                     - int2(ci.holes(sz, i)(0), ci.particles(sz, i)(0) - ncore) * gBlocks[i][sz](1, 1)
+                     + int2(ci.holes(sz, i)(0), ci.particles(sz, i)(1) - ncore) * gBlocks[i][sz](1, 0)
+                     + int2(ci.holes(sz, i)(1), ci.particles(sz, i)(0) - ncore) * gBlocks[i][sz](0, 1)
+                     - int2(ci.holes(sz, i)(1), ci.particles(sz, i)(1) - ncore) * gBlocks[i][sz](0, 0);
+
+          twoEne[sz] = 2. * (  int2(ci.holes(sz, i)(0), ci.particles(sz, i)(0) - ncore)    
+                             * int2(ci.holes(sz, i)(1), ci.particles(sz, i)(1) - ncore) 
+                             - int2(ci.holes(sz, i)(1), ci.particles(sz, i)(0) - ncore) 
+                             * int2(ci.holes(sz, i)(0), ci.particles(sz, i)(1) - ncore)  );
         }
         else if (rank == 3) {
           // oneEne
@@ -1081,7 +875,7 @@ std::array<std::complex<double>, 2> Multislater::hamAndOverlap(Eigen::MatrixXcd&
             for (int p = 0; p < rank; p++) {
               temp = gBlocks[i][sz];
               for (int t = 0; t < rank; t++)
-                temp(p, t) = int2(ciExcitations[sz][i][0](p), ciExcitations[sz][i][1](t) - ncore);
+                temp(p, t) = int2(ci.holes(sz, i)(p), ci.particles(sz, i)(t) - ncore);
               oneEne[sz] -= temp.determinant();
             }
           }
@@ -1097,10 +891,10 @@ std::array<std::complex<double>, 2> Multislater::hamAndOverlap(Eigen::MatrixXcd&
                   for (int u = t + 1; u < rank; u++) {
                     double parity_tu = ((t + u + 1)%2 == 0) ? 1. : -1.;
                     complex<double> blockBlockDet = gBlocks[i][sz](3 - p - q, 3 - t - u);
-                    twoEne[sz] += 2. * parity_pq * parity_tu * blockBlockDet * (  int2(ciExcitations[sz][i][0](p), ciExcitations[sz][i][1](t) - ncore) 
-                                                                                * int2(ciExcitations[sz][i][0](q), ciExcitations[sz][i][1](u) - ncore) 
-                                                                                - int2(ciExcitations[sz][i][0](q), ciExcitations[sz][i][1](t) - ncore) 
-                                                                                * int2(ciExcitations[sz][i][0](p), ciExcitations[sz][i][1](u) - ncore)  );
+                    twoEne[sz] += 2. * parity_pq * parity_tu * blockBlockDet * (  int2(ci.holes(sz, i)(p), ci.particles(sz, i)(t) - ncore) 
+                                                                                * int2(ci.holes(sz, i)(q), ci.particles(sz, i)(u) - ncore) 
+                                                                                - int2(ci.holes(sz, i)(q), ci.particles(sz, i)(t) - ncore) 
+                                                                                * int2(ci.holes(sz, i)(p), ci.particles(sz, i)(u) - ncore)  );
                   }
                 }
               }
@@ -1116,7 +910,7 @@ std::array<std::complex<double>, 2> Multislater::hamAndOverlap(Eigen::MatrixXcd&
             for (int p = 0; p < rank; p++) {
               temp = gBlocks[i][sz];
               for (int t = 0; t < rank; t++)
-                temp(p, t) = int2(ciExcitations[sz][i][0](p), ciExcitations[sz][i][1](t) - ncore);
+                temp(p, t) = int2(ci.holes(sz, i)(p), ci.particles(sz, i)(t) - ncore);
               oneEne[sz] -= temp.determinant();
             }
           }
@@ -1148,10 +942,10 @@ std::array<std::complex<double>, 2> Multislater::hamAndOverlap(Eigen::MatrixXcd&
                     
                     complex<double> blockBlockDet = gBlocks[i][sz](pp, tp) * gBlocks[i][sz](qp, up) - gBlocks[i][sz](pp, up) * gBlocks[i][sz](qp, tp);
 
-                    twoEne[sz] += 2. * parity_pq * parity_tu * blockBlockDet * (  int2(ciExcitations[sz][i][0](p), ciExcitations[sz][i][1](t) - ncore) 
-                                                                                * int2(ciExcitations[sz][i][0](q), ciExcitations[sz][i][1](u) - ncore) 
-                                                                                - int2(ciExcitations[sz][i][0](q), ciExcitations[sz][i][1](t) - ncore) 
-                                                                                * int2(ciExcitations[sz][i][0](p), ciExcitations[sz][i][1](u) - ncore)  );
+                    twoEne[sz] += 2. * parity_pq * parity_tu * blockBlockDet * (  int2(ci.holes(sz, i)(p), ci.particles(sz, i)(t) - ncore) 
+                                                                                * int2(ci.holes(sz, i)(q), ci.particles(sz, i)(u) - ncore) 
+                                                                                - int2(ci.holes(sz, i)(q), ci.particles(sz, i)(t) - ncore) 
+                                                                                * int2(ci.holes(sz, i)(p), ci.particles(sz, i)(u) - ncore)  );
                   }
                 }
               }
@@ -1167,7 +961,7 @@ std::array<std::complex<double>, 2> Multislater::hamAndOverlap(Eigen::MatrixXcd&
             for (int p = 0; p < rank; p++) {
               temp = gBlocks[i][sz];
               for (int t = 0; t < rank; t++)
-                temp(p, t) = int2(ciExcitations[sz][i][0](p), ciExcitations[sz][i][1](t) - ncore);
+                temp(p, t) = int2(ci.holes(sz, i)(p), ci.particles(sz, i)(t) - ncore);
               oneEne[sz] -= temp.determinant();
             }
           }
@@ -1197,10 +991,10 @@ std::array<std::complex<double>, 2> Multislater::hamAndOverlap(Eigen::MatrixXcd&
                         blockBlock(mup, nup) = gBlocks[i][sz](diff0[mup], diff1[nup]);
                     complex<double> blockBlockDet = blockBlock.determinant();
 
-                    twoEne[sz] += 2. * parity_pq * parity_tu * blockBlockDet * (  int2(ciExcitations[sz][i][0](p), ciExcitations[sz][i][1](t) - ncore) 
-                                                                                * int2(ciExcitations[sz][i][0](q), ciExcitations[sz][i][1](u) - ncore) 
-                                                                                - int2(ciExcitations[sz][i][0](q), ciExcitations[sz][i][1](t) - ncore) 
-                                                                                * int2(ciExcitations[sz][i][0](p), ciExcitations[sz][i][1](u) - ncore)  );
+                    twoEne[sz] += 2. * parity_pq * parity_tu * blockBlockDet * (  int2(ci.holes(sz, i)(p), ci.particles(sz, i)(t) - ncore) 
+                                                                                * int2(ci.holes(sz, i)(q), ci.particles(sz, i)(u) - ncore) 
+                                                                                - int2(ci.holes(sz, i)(q), ci.particles(sz, i)(t) - ncore) 
+                                                                                * int2(ci.holes(sz, i)(p), ci.particles(sz, i)(u) - ncore)  );
                   }
                 }
               }
@@ -1209,7 +1003,7 @@ std::array<std::complex<double>, 2> Multislater::hamAndOverlap(Eigen::MatrixXcd&
         } 
       } // sz
 
-      ene += ciParity[i] * ciCoeffs[i] * (twoEne[0] * gBlockDets[i][1] + 2. * oneEne[0] * oneEne[1] + gBlockDets[i][0] * twoEne[1]) / 2.;
+      ene += ci.parity[i] * ci.coeffs[i] * (twoEne[0] * gBlockDets[i][1] + 2. * oneEne[0] * oneEne[1] + gBlockDets[i][0] * twoEne[1]) / 2.;
     
     } // dets
   } // chol
@@ -1218,19 +1012,19 @@ std::array<std::complex<double>, 2> Multislater::hamAndOverlap(Eigen::MatrixXcd&
   for (int i = 1; i < ndets; i++) {
     std::array<complex<double>, 2> oneEne, twoEne;
     for (int sz = 0; sz < 2; sz++) {
-      int rank = ciExcitations[sz][i][0].size();
+      int rank = ci.holes(sz, i).size();
       if (rank == 0) {
         twoEne[sz] = l2G2Tot;
       }
       else if (rank == 1) {
-        twoEne[sz] = l2G2Tot * gBlockDets[i][sz] - 2. * int1(ciExcitations[sz][i][0](0), ciExcitations[sz][i][1](0) - ncore);
+        twoEne[sz] = l2G2Tot * gBlockDets[i][sz] - 2. * int1(ci.holes(sz, i)(0), ci.particles(sz, i)(0) - ncore);
       }
       else if (rank == 2) {
         twoEne[sz] = l2G2Tot * gBlockDets[i][sz]
-                   + 2. * (- int1(ciExcitations[sz][i][0](0), ciExcitations[sz][i][1](0) - ncore) * gBlocks[i][sz](1, 1)
-                           + int1(ciExcitations[sz][i][0](0), ciExcitations[sz][i][1](1) - ncore) * gBlocks[i][sz](1, 0)
-                           + int1(ciExcitations[sz][i][0](1), ciExcitations[sz][i][1](0) - ncore) * gBlocks[i][sz](0, 1)
-                           - int1(ciExcitations[sz][i][0](1), ciExcitations[sz][i][1](1) - ncore) * gBlocks[i][sz](0, 0)  );
+                   + 2. * (- int1(ci.holes(sz, i)(0), ci.particles(sz, i)(0) - ncore) * gBlocks[i][sz](1, 1)
+                           + int1(ci.holes(sz, i)(0), ci.particles(sz, i)(1) - ncore) * gBlocks[i][sz](1, 0)
+                           + int1(ci.holes(sz, i)(1), ci.particles(sz, i)(0) - ncore) * gBlocks[i][sz](0, 1)
+                           - int1(ci.holes(sz, i)(1), ci.particles(sz, i)(1) - ncore) * gBlocks[i][sz](0, 0)  );
       }
       else if (rank == 3) {
         // twoEne
@@ -1243,7 +1037,7 @@ std::array<std::complex<double>, 2> Multislater::hamAndOverlap(Eigen::MatrixXcd&
           for (int p = 0; p < rank; p++) {
             temp = gBlocks[i][sz];
             for (int t = 0; t < rank; t++)
-              temp(p, t) = int1(ciExcitations[sz][i][0](p), ciExcitations[sz][i][1](t) - ncore);
+              temp(p, t) = int1(ci.holes(sz, i)(p), ci.particles(sz, i)(t) - ncore);
             twoEne[sz] -= 2. * temp.determinant();
           }
         }
@@ -1259,7 +1053,7 @@ std::array<std::complex<double>, 2> Multislater::hamAndOverlap(Eigen::MatrixXcd&
           for (int p = 0; p < rank; p++) {
             temp = gBlocks[i][sz];
             for (int t = 0; t < rank; t++)
-              temp(p, t) = int1(ciExcitations[sz][i][0](p), ciExcitations[sz][i][1](t) - ncore);
+              temp(p, t) = int1(ci.holes(sz, i)(p), ci.particles(sz, i)(t) - ncore);
             twoEne[sz] -= 2. * temp.determinant();
           }
         }
@@ -1275,14 +1069,14 @@ std::array<std::complex<double>, 2> Multislater::hamAndOverlap(Eigen::MatrixXcd&
           for (int p = 0; p < rank; p++) {
             temp = gBlocks[i][sz];
             for (int t = 0; t < rank; t++)
-              temp(p, t) = int1(ciExcitations[sz][i][0](p), ciExcitations[sz][i][1](t) - ncore);
+              temp(p, t) = int1(ci.holes(sz, i)(p), ci.particles(sz, i)(t) - ncore);
             twoEne[sz] -= 2. * temp.determinant();
           }
         }
       } 
     } // sz
 
-    ene += ciParity[i] * ciCoeffs[i] * (twoEne[0] * gBlockDets[i][1] + gBlockDets[i][0] * twoEne[1]) / 2.;
+    ene += ci.parity[i] * ci.coeffs[i] * (twoEne[0] * gBlockDets[i][1] + gBlockDets[i][0] * twoEne[1]) / 2.;
   
   } // dets
 
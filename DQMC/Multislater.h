@@ -4,15 +4,26 @@
 #include <random>
 #include "Hamiltonian.h"
 #include "Wavefunction.h"
+#include "CIExpansion.h"
 
 // multislater wave function
 class Multislater : public Wavefunction {
   public:
     //std::array<std::vector<int>, 2> refDet; 
     std::array<Eigen::VectorXi, 2> refDet; 
-    std::array<std::vector<std::array<Eigen::VectorXi, 2>>, 2> ciExcitations;
-    std::vector<double> ciParity; 
-    std::vector<double> ciCoeffs;
+    CIExpansion ci;
+    // string factorization of the expansion: unique alpha and beta excitations (strings) and, for each
+    // determinant, the indices of its two strings, i.e. the nonzeros of the sparse nstringsA x nstringsB
+    // coefficient matrix, determinants and cofactors are evaluated once per string
+    std::array<std::vector<std::array<Eigen::VectorXi, 2>>, 2> ciStrings;
+    std::array<std::vector<int>, 2> ciStringIndex;
+    // strings of each rank > 0 in structure of arrays layout for the energy kernels, stringBuckets[sz][rank - 1]
+    // holds the string indices and the excitation rows and columns (rank x nstrings)
+    struct StringBucket {
+      std::vector<int> strings;
+      Eigen::MatrixXi rows, cols;
+    };
+    std::array<std::vector<StringBucket>, 2> stringBuckets;
     int nact, ncore;
     bool rightQ;
     std::vector<double> cumulativeCoeffs;
@@ -20,6 +31,9 @@ class Multislater : public Wavefunction {
     std::uniform_real_distribution<double> uniform;
 
     Multislater(Hamiltonian& ham, std::string fname, int pnact, int pncore, bool prightQ = false);
+    void stringDets(std::array<Eigen::MatrixXcd, 2>& greeno, std::array<std::vector<std::complex<double>>, 2>& dets);
+    void stringCofactors(std::array<Eigen::MatrixXcd, 2>& greeno, std::array<std::vector<std::complex<double>>, 2>& dets, std::array<std::vector<Eigen::MatrixXcd>, 2>& cofactors);
+    std::complex<double> multiGreen(std::array<Eigen::MatrixXcd, 2>& psi, std::array<Eigen::MatrixXcd, 2>& greenMulti);
     virtual void getSample(std::array<Eigen::MatrixXcd, 2>& sampleDet);
     virtual std::complex<double> overlap(std::array<Eigen::MatrixXcd, 2>& psi);
     virtual std::complex<double> overlap(Eigen::MatrixXcd& psi);
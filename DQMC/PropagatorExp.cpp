@@ -0,0 +1,86 @@
+#include <iostream>
+#include <cmath>
+#include <cstdlib>
+#include "PropagatorExp.h"
+
+using namespace std;
+using namespace Eigen;
+
+// constructor
+PropagatorExp::PropagatorExp(std::string pmethod, int porder, double ptol, int pmaxOrder, double ptheta)
+{
+  if (pmethod == "taylor") method = taylor;
+  else if (pmethod == "adaptive") method = adaptive;
+  else if (pmethod == "scaled") method = scaled;
+  else {
+    cout << "Propagator exponential method " << pmethod << " not supported, use taylor, adaptive or scaled\n";
+    exit(0);
+  }
+  order = porder;
+  tol = ptol;
+  maxOrder = pmaxOrder;
+  theta = ptheta;
+};
+
+
+template<typename MatrixType> int PropagatorExp::applyMethod(const MatrixType& prop, Eigen::Ref<MatrixType> det, int defaultOrder) const
+{
+  if (method == taylor) return applyTaylor<MatrixType>(prop, det, order > 0 ? order : defaultOrder);
+
+  // the 1-norm bounds the growth of the series terms, |prop^k det| <= |prop|_1^k |det|
+  double norm = prop.cwiseAbs().colwise().sum().maxCoeff();
+  if (method == adaptive) return applyAdaptive<MatrixType>(prop, det, norm);
+
+  int nsteps = max(1, int(ceil(norm / theta)));
+  if (nsteps == 1) return applyAdaptive<MatrixType>(prop, det, norm);
+  MatrixType propScaled = prop / typename MatrixType::RealScalar(nsteps);
+  int nterms = 0;
+  for (int n = 0; n < nsteps; n++) nterms += applyAdaptive<MatrixType>(propScaled, det, norm / nsteps);
+  return nterms;
+};
+
+
+template<typename MatrixType> int PropagatorExp::applyTaylor(const MatrixType& prop, Eigen::Ref<MatrixType> det, int norder) const
+{
+  typedef typename MatrixType::RealScalar RealScalar;
+  MatrixType temp = det;
+  for (int i = 1; i <= norder; i++) {
+    temp = prop * temp / RealScalar(i);
+    det += temp;
+  }
+  return norder;
+};
+
+
+// the series is truncated once the last term and the bound on the next one, |term| |prop|_1 / (i + 1),
+// are both below tol * |det|, the running term norm costs a small fraction of the gemm
+template<typename MatrixType> int PropagatorExp::applyAdaptive(const MatrixType& prop, Eigen::Ref<MatrixType> det, double propNorm) const
+{
+  typedef typename MatrixType::RealScalar RealScalar;
+  double detNorm = det.norm();
+  MatrixType temp = det;
+  int i = 1;
+  for (; i < maxOrder; i++) {
+    temp = prop * temp / RealScalar(i);
+    det += temp;
+    double termNorm = temp.norm();
+    if (termNorm <= tol * detNorm && termNorm * propNorm / (i + 1) <= tol * detNorm) break;
+  }
+  if (i == maxOrder) {
+    temp = prop * temp / RealScalar(i);
+    det += temp;
+  }
+  return i;
+};
+
+
+int PropagatorExp::apply(const MatrixXcd& prop, Eigen::Ref<MatrixXcd> det, int defaultOrder) const
+{
+  return applyMethod<MatrixXcd>(prop, det, defaultOrder);
+};
+
+
+int PropagatorExp::apply(const MatrixXcf& prop, Eigen::Ref<MatrixXcf> det, int defaultOrder) const
+{
+  return applyMethod<MatrixXcf>(prop, det, defaultOrder);
+};
@@ -0,0 +1,34 @@
+#ifndef PropagatorExp_HEADER_H
+#define PropagatorExp_HEADER_H
+#include <string>
+#include <Eigen/Dense>
+
+// application of the two body propagator exponential to a walker, det <- exp(prop) * det
+// each term of the series costs a norbs x norbs times norbs x nelec gemm
+//   taylor:   fixed order taylor series
+//   adaptive: taylor series truncated once the terms fall below tol relative to det
+//   scaled:   prop is split into s = ceil(|prop|_1 / theta) steps of prop / s, each applied
+//             with the adaptive series (exp(prop) = exp(prop / s)^s, no matrix squaring needed
+//             since only the action on det is required)
+class PropagatorExp {
+  public:
+    enum Method { taylor, adaptive, scaled };
+    Method method;
+    int order;       // order of the fixed taylor series, <= 0 uses the caller's default
+    int maxOrder;    // cap on the number of terms in the adaptive series
+    double tol;
+    double theta;    // largest norm of prop / s in the scaled method
+
+    PropagatorExp(std::string pmethod = "taylor", int porder = -1, double ptol = 1.e-10, int pmaxOrder = 30, double ptheta = 1.);
+
+    // returns the number of terms (gemms) used, MatrixXcf for single precision propagation
+    int apply(const Eigen::MatrixXcd& prop, Eigen::Ref<Eigen::MatrixXcd> det, int defaultOrder = 5) const;
+    int apply(const Eigen::MatrixXcf& prop, Eigen::Ref<Eigen::MatrixXcf> det, int defaultOrder = 5) const;
+
+  private:
+    template<typename MatrixType> int applyMethod(const MatrixType& prop, Eigen::Ref<MatrixType> det, int defaultOrder) const;
+    template<typename MatrixType> int applyTaylor(const MatrixType& prop, Eigen::Ref<MatrixType> det, int norder) const;
+    template<typename MatrixType> int applyAdaptive(const MatrixType& prop, Eigen::Ref<MatrixType> det, double propNorm) const;
+};
+
+#endif
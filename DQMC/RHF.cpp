@@ -13,7 +13,10 @@ RHF::RHF(Hamiltonian& ham, bool pleftQ, std::string fname)
   det = hf.block(0, 0, ham.norbs, ham.nalpha);
   detT = det.adjoint();
   leftQ = pleftQ;
-  if (leftQ) ham.rotateCholesky(detT, rotChol, rotCholMat, true);
+  if (leftQ) {
+    if (ham.thcQ) thcRotOrbs = ham.thcOrbs * det;
+    else ham.rotateCholesky(detT, rotChol, rotCholMat, true);
+  }
 };
 
 
@@ -42,6 +45,14 @@ std::complex<double> RHF::overlap(Eigen::MatrixXcd& psi)
 void RHF::forceBias(std::array<Eigen::MatrixXcd, 2>& psi, Hamiltonian& ham, Eigen::VectorXcd& fb)
 {
   assert(ham.intType == "r"); 
+  if (ham.thcQ) {
+    std::vector<MatrixXcd> theta = { psi[0] * (detT * psi[0]).inverse(), psi[1] * (detT * psi[1]).inverse() };
+    std::vector<MatrixXcd*> thetaPtr = { &theta[0], &theta[1] };
+    MatrixXcd coulomb;
+    ham.thcCoulombExchange(thcRotOrbs, thetaPtr, coulomb);
+    fb = coulomb.col(0) + coulomb.col(1);
+    return;
+  }
   matPair thetaT;
   thetaT[0] = (psi[0] * (detT * psi[0]).inverse()).transpose();
   thetaT[1] = (psi[1] * (detT * psi[1]).inverse()).transpose();
@@ -54,6 +65,14 @@ void RHF::forceBias(std::array<Eigen::MatrixXcd, 2>& psi, Hamiltonian& ham, Eige
 void RHF::forceBias(Eigen::MatrixXcd& psi, Hamiltonian& ham, Eigen::VectorXcd& fb)
 {
   assert(ham.intType == "r"); 
+  if (ham.thcQ) {
+    MatrixXcd theta = psi * (detT * psi).inverse();
+    std::vector<MatrixXcd*> thetaPtr(1, &theta);
+    MatrixXcd coulomb;
+    ham.thcCoulombExchange(thcRotOrbs, thetaPtr, coulomb);
+    fb = 2. * coulomb.col(0);
+    return;
+  }
   MatrixXcd thetaT;
   thetaT = (psi * (detT * psi).inverse()).transpose();
   Eigen::Map<VectorXcd> thetaTFlat(thetaT.data(), thetaT.rows() * thetaT.cols());
@@ -61,6 +80,101 @@ void RHF::forceBias(Eigen::MatrixXcd& psi, Hamiltonian& ham, Eigen::VectorXcd& f
 };
 
 
+// splits a batch of walker determinant pairs by spin
+static void splitSpins(std::vector<std::array<Eigen::MatrixXcd, 2>*>& psi, std::array<std::vector<Eigen::MatrixXcd*>, 2>& psiSz)
+{
+  for (int w = 0; w < psi.size(); w++) {
+    psiSz[0].push_back(&(*psi[w])[0]);
+    psiSz[1].push_back(&(*psi[w])[1]);
+  }
+};
+
+
+void RHF::overlapBatch(std::vector<std::array<Eigen::MatrixXcd, 2>*>& psi, Eigen::VectorXcd& overlaps)
+{
+  std::array<std::vector<Eigen::MatrixXcd*>, 2> psiSz;
+  splitSpins(psi, psiSz);
+  MatrixXcd overlapMatUp = overlapMatBatch(detT, psiSz[0]);
+  MatrixXcd overlapMatDn = overlapMatBatch(detT, psiSz[1]);
+  int nalpha = psiSz[0][0]->cols(), nbeta = psiSz[1][0]->cols();
+  overlaps.resize(psi.size());
+  for (int w = 0; w < psi.size(); w++) 
+    overlaps(w) = overlapMatUp.middleCols(w * nalpha, nalpha).determinant() * overlapMatDn.middleCols(w * nbeta, nbeta).determinant();
+};
+
+
+void RHF::overlapBatch(std::vector<Eigen::MatrixXcd*>& psi, Eigen::VectorXcd& overlaps)
+{
+  MatrixXcd overlapMat = overlapMatBatch(detT, psi);
+  int nocc = psi[0]->cols();
+  overlaps.resize(psi.size());
+  for (int w = 0; w < psi.size(); w++) {
+    overlaps(w) = overlapMat.middleCols(w * nocc, nocc).determinant();
+    overlaps(w) *= overlaps(w);
+  }
+};
+
+
+// theta matrices of all walkers are flattened into the columns of a (rotSize x nwalk) matrix
+// so that the contraction with the rotated cholesky vectors is a single gemm
+void RHF::forceBiasBatch(std::vector<std::array<Eigen::MatrixXcd, 2>*>& psi, Hamiltonian& ham, Eigen::MatrixXcd& fb)
+{
+  assert(ham.intType == "r"); 
+  std::array<std::vector<Eigen::MatrixXcd*>, 2> psiSz;
+  splitSpins(psi, psiSz);
+  MatrixXcd overlapMatUp = overlapMatBatch(detT, psiSz[0]);
+  MatrixXcd overlapMatDn = overlapMatBatch(detT, psiSz[1]);
+  int norbs = ham.norbs, nalpha = psiSz[0][0]->cols(), nbeta = psiSz[1][0]->cols();
+  if (ham.thcQ) {
+    int nwalk = psi.size();
+    std::vector<MatrixXcd> theta(2 * nwalk);
+    std::vector<MatrixXcd*> thetaPtr(2 * nwalk);
+    for (int w = 0; w < nwalk; w++) {
+      theta[w] = *psiSz[0][w] * overlapMatUp.middleCols(w * nalpha, nalpha).inverse();
+      theta[nwalk + w] = *psiSz[1][w] * overlapMatDn.middleCols(w * nbeta, nbeta).inverse();
+      thetaPtr[w] = &theta[w]; thetaPtr[nwalk + w] = &theta[nwalk + w];
+    }
+    MatrixXcd coulomb;
+    ham.thcCoulombExchange(thcRotOrbs, thetaPtr, coulomb);
+    fb = (coulomb.leftCols(nwalk) + coulomb.rightCols(nwalk)).transpose();
+    return;
+  }
+  MatrixXcd thetaTFlat(nalpha * norbs, psi.size());
+  for (int w = 0; w < psi.size(); w++) {
+    MatrixXcd thetaTSA = (*psiSz[0][w] * overlapMatUp.middleCols(w * nalpha, nalpha).inverse()).transpose();
+    thetaTSA += (*psiSz[1][w] * overlapMatDn.middleCols(w * nbeta, nbeta).inverse()).transpose();
+    thetaTFlat.col(w) = Eigen::Map<VectorXcd>(thetaTSA.data(), thetaTSA.rows() * thetaTSA.cols());
+  }
+  fb.noalias() = thetaTFlat.transpose() * rotCholMat[0];
+};
+
+
+void RHF::forceBiasBatch(std::vector<Eigen::MatrixXcd*>& psi, Hamiltonian& ham, Eigen::MatrixXcd& fb)
+{
+  assert(ham.intType == "r"); 
+  MatrixXcd overlapMat = overlapMatBatch(detT, psi);
+  int norbs = ham.norbs, nocc = psi[0]->cols();
+  if (ham.thcQ) {
+    std::vector<MatrixXcd> theta(psi.size());
+    std::vector<MatrixXcd*> thetaPtr(psi.size());
+    for (int w = 0; w < psi.size(); w++) {
+      theta[w] = *psi[w] * overlapMat.middleCols(w * nocc, nocc).inverse();
+      thetaPtr[w] = &theta[w];
+    }
+    MatrixXcd coulomb;
+    ham.thcCoulombExchange(thcRotOrbs, thetaPtr, coulomb);
+    fb = 2. * coulomb.transpose();
+    return;
+  }
+  MatrixXcd thetaTFlat(nocc * norbs, psi.size());
+  for (int w = 0; w < psi.size(); w++) {
+    MatrixXcd thetaT = (*psi[w] * overlapMat.middleCols(w * nocc, nocc).inverse()).transpose();
+    thetaTFlat.col(w) = Eigen::Map<VectorXcd>(thetaT.data(), thetaT.rows() * thetaT.cols());
+  }
+  fb.noalias() = 2. * thetaTFlat.transpose() * rotCholMat[0];
+};
+
+
 void RHF::oneRDM(std::array<Eigen::MatrixXcd, 2>& psi, Eigen::MatrixXcd& rdmSample) 
 {
   rdmSample = (psi[0] * (detT * psi[0]).inverse() * detT).transpose() + (psi[1] * (detT * psi[1]).inverse() * detT).transpose();
@@ -69,63 +183,90 @@ void RHF::oneRDM(std::array<Eigen::MatrixXcd, 2>& psi, Eigen::MatrixXcd& rdmSamp
 
 std::array<std::complex<double>, 2> RHF::hamAndOverlap(std::array<Eigen::MatrixXcd, 2>& psi, Hamiltonian& ham) 
 { 
+  std::vector<std::array<Eigen::MatrixXcd, 2>*> psiBatch(1, &psi);
+  std::vector<std::array<complex<double>, 2>> hamOverlaps;
+  hamAndOverlapBatch(psiBatch, ham, hamOverlaps);
+  return hamOverlaps[0];
+};
+
+
+std::array<std::complex<double>, 2> RHF::hamAndOverlap(Eigen::MatrixXcd& psi, Hamiltonian& ham) 
+{ 
+  std::vector<Eigen::MatrixXcd*> psiBatch(1, &psi);
+  std::vector<std::array<complex<double>, 2>> hamOverlaps;
+  hamAndOverlapBatch(psiBatch, ham, hamOverlaps);
+  return hamOverlaps[0];
+};
+
+
+// coulomb part is a single gemm for all walkers and spins, exchange is blocked over cholesky vectors
+void RHF::hamAndOverlapBatch(std::vector<std::array<Eigen::MatrixXcd, 2>*>& psi, Hamiltonian& ham, std::vector<std::array<std::complex<double>, 2>>& hamOverlaps)
+{
   assert(ham.intType == "r"); 
-  complex<double> overlap = (detT * psi[0]).determinant() * (detT * psi[1]).determinant();
-  complex<double> ene = ham.ecore;
+  int nwalk = psi.size();
+  std::array<std::vector<Eigen::MatrixXcd*>, 2> psiSz;
+  splitSpins(psi, psiSz);
   
-  // calculate theta and green
-  matPair theta, green;
-  theta[0] = psi[0] * (detT * psi[0]).inverse();
-  theta[1] = psi[1] * (detT * psi[1]).inverse();
-  green[0] = theta[0] * detT;
-  green[1] = theta[1] * detT;
-
-  // one body part
-  ene += green[0].cwiseProduct(ham.h1).sum() + green[1].cwiseProduct(ham.h1).sum();
+  // calculate theta
+  std::array<std::vector<MatrixXcd>, 2> theta;
+  VectorXcd overlaps = VectorXcd::Ones(nwalk);
+  thetaBatch(detT, psiSz[0], theta[0], overlaps);
+  thetaBatch(detT, psiSz[1], theta[1], overlaps);
+  std::vector<MatrixXcd*> thetaPtr;
+  for (int sz = 0; sz < 2; sz++)
+    for (int w = 0; w < nwalk; w++) thetaPtr.push_back(&theta[sz][w]);
 
   // two body part
-  MatrixXcd fup = MatrixXcd::Zero(rotChol[0].rows(), rotChol[0].rows());
-  MatrixXcd fdn = MatrixXcd::Zero(rotChol[0].rows(), rotChol[0].rows());
-  for (int i = 0; i < ham.ncholEne; i++) {
-    fup.noalias() = rotChol[i] * theta[0];
-    fdn.noalias() = rotChol[i] * theta[1];
-    complex<double> cup = fup.trace();
-    complex<double> cdn = fdn.trace();
-    ene += (cup * cup + cdn * cdn + 2. * cup * cdn - fup.cwiseProduct(fup.transpose()).sum() - fdn.cwiseProduct(fdn.transpose()).sum()) / 2.;
+  MatrixXcd coulomb;
+  VectorXcd exchange;
+  if (ham.thcQ) ham.thcCoulombExchange(thcRotOrbs, thetaPtr, coulomb, &exchange);
+  else {
+    ham.rotatedCoulomb(rotCholMat[0], thetaPtr, coulomb);
+    ham.rotatedExchange(rotChol, thetaPtr, exchange);
   }
 
-  std::array<complex<double>, 2> hamOverlap;
-  hamOverlap[0] = ene * overlap;
-  hamOverlap[1] = overlap;
-  return hamOverlap;
+  hamOverlaps.resize(nwalk);
+  for (int w = 0; w < nwalk; w++) {
+    complex<double> ene = ham.ecore;
+    // one body part
+    ene += (theta[0][w] * detT).cwiseProduct(ham.h1).sum() + (theta[1][w] * detT).cwiseProduct(ham.h1).sum();
+    VectorXcd c = coulomb.col(w) + coulomb.col(nwalk + w);
+    ene += (c.cwiseProduct(c).sum() - exchange(w) - exchange(nwalk + w)) / 2.;
+    hamOverlaps[w][0] = ene * overlaps(w);
+    hamOverlaps[w][1] = overlaps(w);
+  }
 };
 
 
-std::array<std::complex<double>, 2> RHF::hamAndOverlap(Eigen::MatrixXcd& psi, Hamiltonian& ham) 
-{ 
+void RHF::hamAndOverlapBatch(std::vector<Eigen::MatrixXcd*>& psi, Hamiltonian& ham, std::vector<std::array<std::complex<double>, 2>>& hamOverlaps)
+{
   assert(ham.intType == "r"); 
-  complex<double> overlap = (detT * psi).determinant();
-  overlap *= overlap;
-  complex<double> ene = ham.ecore;
-  
-  // calculate theta and green
-  MatrixXcd theta, green;
-  theta = psi * (detT * psi).inverse();
-  green = theta * detT;
+  int nwalk = psi.size();
 
-  // one body part
-  ene += 2. * green.cwiseProduct(ham.h1).sum();
+  // calculate theta
+  std::vector<MatrixXcd> theta;
+  VectorXcd overlaps = VectorXcd::Ones(nwalk);
+  thetaBatch(detT, psi, theta, overlaps);
+  std::vector<MatrixXcd*> thetaPtr;
+  for (int w = 0; w < nwalk; w++) thetaPtr.push_back(&theta[w]);
 
   // two body part
-  MatrixXcd f = MatrixXcd::Zero(rotChol[0].rows(), rotChol[0].rows());
-  for (int i = 0; i < ham.ncholEne; i++) {
-    f.noalias() = rotChol[i] * theta;
-    complex<double> c = f.trace();
-    ene += (2. * c * c - f.cwiseProduct(f.transpose()).sum());
+  MatrixXcd coulomb;
+  VectorXcd exchange;
+  if (ham.thcQ) ham.thcCoulombExchange(thcRotOrbs, thetaPtr, coulomb, &exchange);
+  else {
+    ham.rotatedCoulomb(rotCholMat[0], thetaPtr, coulomb);
+    ham.rotatedExchange(rotChol, thetaPtr, exchange);
   }
 
-  std::array<complex<double>, 2> hamOverlap;
-  hamOverlap[0] = ene * overlap;
-  hamOverlap[1] = overlap;
-  return hamOverlap;
+  hamOverlaps.resize(nwalk);
+  for (int w = 0; w < nwalk; w++) {
+    complex<double> overlap = overlaps(w) * overlaps(w);
+    complex<double> ene = ham.ecore;
+    // one body part
+    ene += 2. * (theta[w] * detT).cwiseProduct(ham.h1).sum();
+    ene += 2. * coulomb.col(w).cwiseProduct(coulomb.col(w)).sum() - exchange(w);
+    hamOverlaps[w][0] = ene * overlap;
+    hamOverlaps[w][1] = overlap;
+  }
 };
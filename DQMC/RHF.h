@@ -10,6 +10,7 @@ class RHF : public Wavefunction {
     Eigen::MatrixXd det, detT;
     std::vector<Eigen::Map<Eigen::MatrixXd>> rotChol;
     std::vector<Eigen::Map<Eigen::MatrixXd>> rotCholMat;
+    Eigen::MatrixXd thcRotOrbs;   // thcOrbs * det, used instead of rotated cholesky with thc integrals
     bool leftQ;
 
     RHF(Hamiltonian& ham, bool pleftQ, std::string fname = "rhf.txt");
@@ -18,8 +19,14 @@ class RHF : public Wavefunction {
     virtual std::complex<double> overlap(Eigen::MatrixXcd& psi);
     virtual void forceBias(std::array<Eigen::MatrixXcd, 2>& psi, Hamiltonian& ham, Eigen::VectorXcd& fb);
     virtual void forceBias(Eigen::MatrixXcd& psi, Hamiltonian& ham, Eigen::VectorXcd& fb);
+    virtual void overlapBatch(std::vector<std::array<Eigen::MatrixXcd, 2>*>& psi, Eigen::VectorXcd& overlaps);
+    virtual void overlapBatch(std::vector<Eigen::MatrixXcd*>& psi, Eigen::VectorXcd& overlaps);
+    virtual void forceBiasBatch(std::vector<std::array<Eigen::MatrixXcd, 2>*>& psi, Hamiltonian& ham, Eigen::MatrixXcd& fb);
+    virtual void forceBiasBatch(std::vector<Eigen::MatrixXcd*>& psi, Hamiltonian& ham, Eigen::MatrixXcd& fb);
     virtual void oneRDM(std::array<Eigen::MatrixXcd, 2>& psi, Eigen::MatrixXcd& rdmSample);
     virtual std::array<std::complex<double>, 2> hamAndOverlap(std::array<Eigen::MatrixXcd, 2>& psi, Hamiltonian& ham);
     virtual std::array<std::complex<double>, 2> hamAndOverlap(Eigen::MatrixXcd& psi, Hamiltonian& ham);
+    virtual void hamAndOverlapBatch(std::vector<std::array<Eigen::MatrixXcd, 2>*>& psi, Hamiltonian& ham, std::vector<std::array<std::complex<double>, 2>>& hamOverlaps);
+    virtual void hamAndOverlapBatch(std::vector<Eigen::MatrixXcd*>& psi, Hamiltonian& ham, std::vector<std::array<std::complex<double>, 2>>& hamOverlaps);
 };
 #endif
@@ -65,6 +65,78 @@ void UHF::forceBias(Eigen::MatrixXcd& psi, Hamiltonian& ham, Eigen::VectorXcd& f
 };
 
 
+// splits a batch of walker determinant pairs by spin
+static void splitSpins(std::vector<std::array<Eigen::MatrixXcd, 2>*>& psi, std::array<std::vector<Eigen::MatrixXcd*>, 2>& psiSz)
+{
+  for (int w = 0; w < psi.size(); w++) {
+    psiSz[0].push_back(&(*psi[w])[0]);
+    psiSz[1].push_back(&(*psi[w])[1]);
+  }
+};
+
+
+void UHF::overlapBatch(std::vector<std::array<Eigen::MatrixXcd, 2>*>& psi, Eigen::VectorXcd& overlaps)
+{
+  std::array<std::vector<Eigen::MatrixXcd*>, 2> psiSz;
+  splitSpins(psi, psiSz);
+  MatrixXcd overlapMatUp = overlapMatBatch(detT[0], psiSz[0]);
+  MatrixXcd overlapMatDn = overlapMatBatch(detT[1], psiSz[1]);
+  int nalpha = psiSz[0][0]->cols(), nbeta = psiSz[1][0]->cols();
+  overlaps.resize(psi.size());
+  for (int w = 0; w < psi.size(); w++) 
+    overlaps(w) = overlapMatUp.middleCols(w * nalpha, nalpha).determinant() * overlapMatDn.middleCols(w * nbeta, nbeta).determinant();
+};
+
+
+void UHF::overlapBatch(std::vector<Eigen::MatrixXcd*>& psi, Eigen::VectorXcd& overlaps)
+{
+  MatrixXcd overlapMatUp = overlapMatBatch(detT[0], psi);
+  MatrixXcd overlapMatDn = overlapMatBatch(detT[1], psi);
+  int nocc = psi[0]->cols();
+  overlaps.resize(psi.size());
+  for (int w = 0; w < psi.size(); w++) 
+    overlaps(w) = overlapMatUp.middleCols(w * nocc, nocc).determinant() * overlapMatDn.middleCols(w * nocc, nocc).determinant();
+};
+
+
+// theta matrices of all walkers are flattened into the columns of a (rotSize x nwalk) matrix per spin
+// so that the contraction with the rotated cholesky vectors is one gemm per spin
+void UHF::forceBiasBatch(std::vector<std::array<Eigen::MatrixXcd, 2>*>& psi, Hamiltonian& ham, Eigen::MatrixXcd& fb)
+{
+  std::array<std::vector<Eigen::MatrixXcd*>, 2> psiSz;
+  splitSpins(psi, psiSz);
+  int norbs = ham.norbs;
+  fb = MatrixXcd::Zero(psi.size(), rotCholMat[0][0].cols());
+  for (int sz = 0; sz < 2; sz++) {
+    MatrixXcd overlapMat = overlapMatBatch(detT[sz], psiSz[sz]);
+    int nocc = psiSz[sz][0]->cols();
+    MatrixXcd thetaTFlat(nocc * norbs, psi.size());
+    for (int w = 0; w < psi.size(); w++) {
+      MatrixXcd thetaT = (*psiSz[sz][w] * overlapMat.middleCols(w * nocc, nocc).inverse()).transpose();
+      thetaTFlat.col(w) = Eigen::Map<VectorXcd>(thetaT.data(), thetaT.rows() * thetaT.cols());
+    }
+    fb.noalias() += thetaTFlat.transpose() * rotCholMat[sz][0];
+  }
+};
+
+
+void UHF::forceBiasBatch(std::vector<Eigen::MatrixXcd*>& psi, Hamiltonian& ham, Eigen::MatrixXcd& fb)
+{
+  assert(ham.intType == "r");
+  int norbs = ham.norbs, nocc = psi[0]->cols();
+  fb = MatrixXcd::Zero(psi.size(), rotCholMat[0][0].cols());
+  for (int sz = 0; sz < 2; sz++) {
+    MatrixXcd overlapMat = overlapMatBatch(detT[sz], psi);
+    MatrixXcd thetaTFlat(nocc * norbs, psi.size());
+    for (int w = 0; w < psi.size(); w++) {
+      MatrixXcd thetaT = (*psi[w] * overlapMat.middleCols(w * nocc, nocc).inverse()).transpose();
+      thetaTFlat.col(w) = Eigen::Map<VectorXcd>(thetaT.data(), thetaT.rows() * thetaT.cols());
+    }
+    fb.noalias() += thetaTFlat.transpose() * rotCholMat[sz][0];
+  }
+};
+
+
 void UHF::oneRDM(std::array<Eigen::MatrixXcd, 2>& det, std::array<Eigen::MatrixXcd, 2>& rdmSample) 
 {
   rdmSample[0] = (det[0] * (detT[0] * det[0]).inverse() * detT[0]).transpose();
@@ -74,67 +146,69 @@ void UHF::oneRDM(std::array<Eigen::MatrixXcd, 2>& det, std::array<Eigen::MatrixX
 
 std::array<std::complex<double>, 2> UHF::hamAndOverlap(std::array<Eigen::MatrixXcd, 2>& psi, Hamiltonian& ham) 
 { 
-  complex<double> overlap = (detT[0] * psi[0]).determinant() * (detT[1] * psi[1]).determinant();
-  complex<double> ene = ham.ecore;
-  
-  // calculate theta and green
-  matPair theta, green;
-  theta[0] = psi[0] * (detT[0] * psi[0]).inverse();
-  theta[1] = psi[1] * (detT[1] * psi[1]).inverse();
-  green[0] = theta[0] * detT[0];
-  green[1] = theta[1] * detT[1];
-
-  // one body part
-  if (ham.intType == "r") ene += green[0].cwiseProduct(ham.h1).sum() + green[1].cwiseProduct(ham.h1).sum();
-  else if (ham.intType == "u") ene += green[0].cwiseProduct(ham.h1u[0]).sum() + green[1].cwiseProduct(ham.h1u[1]).sum();
-
-  // two body part
-  MatrixXcd fup = MatrixXcd::Zero(rotChol[0][0].rows(), rotChol[0][0].rows());
-  MatrixXcd fdn = MatrixXcd::Zero(rotChol[1][0].rows(), rotChol[1][0].rows());
-  for (int i = 0; i < ham.ncholEne; i++) {
-    fup.noalias() = rotChol[0][i] * theta[0];
-    fdn.noalias() = rotChol[1][i] * theta[1];
-    complex<double> cup = fup.trace();
-    complex<double> cdn = fdn.trace();
-    ene += (cup * cup + cdn * cdn + 2. * cup * cdn - fup.cwiseProduct(fup.transpose()).sum() - fdn.cwiseProduct(fdn.transpose()).sum()) / 2.;
-  }
-
-  std::array<complex<double>, 2> hamOverlap;
-  hamOverlap[0] = ene * overlap;
-  hamOverlap[1] = overlap;
-  return hamOverlap;
+  std::vector<std::array<Eigen::MatrixXcd, 2>*> psiBatch(1, &psi);
+  std::vector<std::array<complex<double>, 2>> hamOverlaps;
+  hamAndOverlapBatch(psiBatch, ham, hamOverlaps);
+  return hamOverlaps[0];
 };
 
 
 std::array<std::complex<double>, 2> UHF::hamAndOverlap(Eigen::MatrixXcd& psi, Hamiltonian& ham) 
 { 
-  assert(ham.intType == "r");
-  complex<double> overlap = (detT[0] * psi).determinant() * (detT[1] * psi).determinant();
-  complex<double> ene = ham.ecore;
-  
-  // calculate theta and green
-  matPair theta, green;
-  theta[0] = psi * (detT[0] * psi).inverse();
-  theta[1] = psi * (detT[1] * psi).inverse();
-  green[0] = theta[0] * detT[0];
-  green[1] = theta[1] * detT[1];
+  std::vector<Eigen::MatrixXcd*> psiBatch(1, &psi);
+  std::vector<std::array<complex<double>, 2>> hamOverlaps;
+  hamAndOverlapBatch(psiBatch, ham, hamOverlaps);
+  return hamOverlaps[0];
+};
+
 
-  // one body part
-  ene += green[0].cwiseProduct(ham.h1).sum() + green[1].cwiseProduct(ham.h1).sum();
+// coulomb part is a single gemm per spin for all walkers, exchange is blocked over cholesky vectors
+void UHF::hamAndOverlapBatch(std::vector<std::array<Eigen::MatrixXcd, 2>*>& psi, Hamiltonian& ham, std::vector<std::array<std::complex<double>, 2>>& hamOverlaps)
+{
+  int nwalk = psi.size();
+  std::array<std::vector<Eigen::MatrixXcd*>, 2> psiSz;
+  splitSpins(psi, psiSz);
+  
+  // calculate theta
+  std::array<std::vector<MatrixXcd>, 2> theta;
+  VectorXcd overlaps = VectorXcd::Ones(nwalk);
+  thetaBatch(detT[0], psiSz[0], theta[0], overlaps);
+  thetaBatch(detT[1], psiSz[1], theta[1], overlaps);
 
   // two body part
-  MatrixXcd fup = MatrixXcd::Zero(rotChol[0][0].rows(), rotChol[0][0].rows());
-  MatrixXcd fdn = MatrixXcd::Zero(rotChol[1][0].rows(), rotChol[1][0].rows());
-  for (int i = 0; i < ham.ncholEne; i++) {
-    fup.noalias() = rotChol[0][i] * theta[0];
-    fdn.noalias() = rotChol[1][i] * theta[1];
-    complex<double> cup = fup.trace();
-    complex<double> cdn = fdn.trace();
-    ene += (cup * cup + cdn * cdn + 2. * cup * cdn - fup.cwiseProduct(fup.transpose()).sum() - fdn.cwiseProduct(fdn.transpose()).sum()) / 2.;
+  std::array<MatrixXcd, 2> coulomb;
+  std::array<VectorXcd, 2> exchange;
+  for (int sz = 0; sz < 2; sz++) {
+    std::vector<MatrixXcd*> thetaPtr;
+    for (int w = 0; w < nwalk; w++) thetaPtr.push_back(&theta[sz][w]);
+    ham.rotatedCoulomb(rotCholMat[sz][0], thetaPtr, coulomb[sz]);
+    ham.rotatedExchange(rotChol[sz], thetaPtr, exchange[sz]);
   }
 
-  std::array<complex<double>, 2> hamOverlap;
-  hamOverlap[0] = ene * overlap;
-  hamOverlap[1] = overlap;
-  return hamOverlap;
+  hamOverlaps.resize(nwalk);
+  for (int w = 0; w < nwalk; w++) {
+    complex<double> ene = ham.ecore;
+    // one body part
+    MatrixXcd greenUp = theta[0][w] * detT[0], greenDn = theta[1][w] * detT[1];
+    if (ham.intType == "r") ene += greenUp.cwiseProduct(ham.h1).sum() + greenDn.cwiseProduct(ham.h1).sum();
+    else if (ham.intType == "u") ene += greenUp.cwiseProduct(ham.h1u[0]).sum() + greenDn.cwiseProduct(ham.h1u[1]).sum();
+    VectorXcd c = coulomb[0].col(w) + coulomb[1].col(w);
+    ene += (c.cwiseProduct(c).sum() - exchange[0](w) - exchange[1](w)) / 2.;
+    hamOverlaps[w][0] = ene * overlaps(w);
+    hamOverlaps[w][1] = overlaps(w);
+  }
+};
+
+
+void UHF::hamAndOverlapBatch(std::vector<Eigen::MatrixXcd*>& psi, Hamiltonian& ham, std::vector<std::array<std::complex<double>, 2>>& hamOverlaps)
+{
+  assert(ham.intType == "r");
+  std::vector<std::array<Eigen::MatrixXcd, 2>> psiPairs(psi.size());
+  std::vector<std::array<Eigen::MatrixXcd, 2>*> psiPairPtr;
+  for (int w = 0; w < psi.size(); w++) {
+    psiPairs[w][0] = *psi[w];
+    psiPairs[w][1] = *psi[w];
+    psiPairPtr.push_back(&psiPairs[w]);
+  }
+  hamAndOverlapBatch(psiPairPtr, ham, hamOverlaps);
 };
@@ -1,6 +1,7 @@
 #ifndef Wavefunction_HEADER_H
 #define Wavefunction_HEADER_H
 #include <utility>
+#include <vector>
 #include "Hamiltonian.h"
 
 // wave function interface
@@ -17,5 +18,69 @@ class Wavefunction {
     virtual void oneRDM(Eigen::MatrixXcd& det, Eigen::MatrixXcd& rdmSample) { };
     virtual std::array<std::complex<double>, 2> hamAndOverlap(std::array<Eigen::MatrixXcd, 2>& det, Hamiltonian& ham) = 0;
     virtual std::array<std::complex<double>, 2> hamAndOverlap(Eigen::MatrixXcd& det, Hamiltonian& ham) = 0;
+
+    // batched versions over the walkers of a process
+    // fb is nwalk x nfields, the default implementations loop over walkers
+    virtual void overlapBatch(std::vector<std::array<Eigen::MatrixXcd, 2>*>& dets, Eigen::VectorXcd& overlaps) 
+    {
+      overlaps.resize(dets.size());
+      for (int w = 0; w < dets.size(); w++) overlaps(w) = overlap(*dets[w]);
+    };
+    virtual void overlapBatch(std::vector<Eigen::MatrixXcd*>& dets, Eigen::VectorXcd& overlaps) 
+    {
+      overlaps.resize(dets.size());
+      for (int w = 0; w < dets.size(); w++) overlaps(w) = overlap(*dets[w]);
+    };
+    virtual void hamAndOverlapBatch(std::vector<std::array<Eigen::MatrixXcd, 2>*>& dets, Hamiltonian& ham, std::vector<std::array<std::complex<double>, 2>>& hamOverlaps) 
+    {
+      hamOverlaps.resize(dets.size());
+      for (int w = 0; w < dets.size(); w++) hamOverlaps[w] = hamAndOverlap(*dets[w], ham);
+    };
+    virtual void hamAndOverlapBatch(std::vector<Eigen::MatrixXcd*>& dets, Hamiltonian& ham, std::vector<std::array<std::complex<double>, 2>>& hamOverlaps) 
+    {
+      hamOverlaps.resize(dets.size());
+      for (int w = 0; w < dets.size(); w++) hamOverlaps[w] = hamAndOverlap(*dets[w], ham);
+    };
+    virtual void forceBiasBatch(std::vector<std::array<Eigen::MatrixXcd, 2>*>& dets, Hamiltonian& ham, Eigen::MatrixXcd& fb) 
+    {
+      fb.resize(dets.size(), ham.nchol);
+      Eigen::VectorXcd fbw;
+      for (int w = 0; w < dets.size(); w++) {
+        forceBias(*dets[w], ham, fbw);
+        fb.row(w) = fbw.transpose();
+      }
+    };
+    virtual void forceBiasBatch(std::vector<Eigen::MatrixXcd*>& dets, Hamiltonian& ham, Eigen::MatrixXcd& fb) 
+    {
+      fb.resize(dets.size(), ham.nchol);
+      Eigen::VectorXcd fbw;
+      for (int w = 0; w < dets.size(); w++) {
+        forceBias(*dets[w], ham, fbw);
+        fb.row(w) = fbw.transpose();
+      }
+    };
+};
+
+// overlap matrices detT * psi of a batch of walkers with a single gemm
+// returns the nocc x (nwalk * nocc) matrix of stacked overlap matrices
+template <typename T> Eigen::MatrixXcd overlapMatBatch(const T& detT, std::vector<Eigen::MatrixXcd*>& psi)
+{
+  int ncols = 0;
+  for (int w = 0; w < psi.size(); w++) ncols += psi[w]->cols();
+  Eigen::MatrixXcd psiStacked(psi[0]->rows(), ncols);
+  for (int w = 0, col = 0; w < psi.size(); col += psi[w]->cols(), w++) psiStacked.middleCols(col, psi[w]->cols()) = *psi[w];
+  return detT * psiStacked;
+};
+
+// theta = psi (detT psi)^-1 for a batch of walkers, overlaps are multiplied by det(detT psi)
+template <typename T> void thetaBatch(const T& detT, std::vector<Eigen::MatrixXcd*>& psi, std::vector<Eigen::MatrixXcd>& theta, Eigen::VectorXcd& overlaps)
+{
+  Eigen::MatrixXcd overlapMat = overlapMatBatch(detT, psi);
+  theta.resize(psi.size());
+  for (int w = 0, col = 0; w < psi.size(); col += psi[w]->cols(), w++) {
+    Eigen::MatrixXcd overlapMatW = overlapMat.middleCols(col, psi[w]->cols());
+    overlaps(w) *= overlapMatW.determinant();
+    theta[w] = *psi[w] * overlapMatW.inverse();
+  }
 };
 #endif
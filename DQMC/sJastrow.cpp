@@ -133,9 +133,11 @@ complex<double> calcHamiltonianElement(matPair& phi1T, matPair& phi2, Hamiltonia
   MatrixXcd fdn = MatrixXcd::Zero(phi1T[1].rows(), phi1T[1].rows());
   MatrixXcd rotCholUp = MatrixXcd::Zero(phi1T[0].rows(), ham.h1.rows());
   MatrixXcd rotCholDn = MatrixXcd::Zero(phi1T[1].rows(), ham.h1.rows());
+  MatrixXd cholBuffer;
   for (int i = 0; i < ham.nchol; i++) {
-    rotCholUp.noalias() = phi1T[0] * ham.chol[i].block(0, 0, numActOrbs, ham.h1.rows());
-    rotCholDn.noalias() = phi1T[1] * ham.chol[i].block(0, 0, numActOrbs, ham.h1.rows());
+    Eigen::Map<const MatrixXd> cholN = ham.choleskyMatrix(i, cholBuffer);
+    rotCholUp.noalias() = phi1T[0] * cholN.block(0, 0, numActOrbs, ham.h1.rows());
+    rotCholDn.noalias() = phi1T[1] * cholN.block(0, 0, numActOrbs, ham.h1.rows());
     fup.noalias() = rotCholUp * theta[0];
     fdn.noalias() = rotCholDn * theta[1];
     complex<double> cup = fup.trace();
@@ -102,7 +102,7 @@ template<typename Wfn, typename Walker>
   vector<double> cumHijElements;
 
   while (t > 0) {
-    double Ewalk = walk.d.Energy(I1, I2, coreE);
+    double Ewalk = walk.energy();
 
     w.HamAndOvlp(walk, ovlp, ham, work);
 
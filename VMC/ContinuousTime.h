@@ -8,6 +8,7 @@
 #include "sr.h"
 #include "global.h"
 #include "evaluateE.h"
+#include "MarkovChains.h"
 #include <iostream>
 #include <fstream>
 #include <boost/serialization/serialization.hpp>
@@ -27,76 +28,115 @@ template<typename Wfn, typename Walker>
 class ContinuousTime
 {
   public:
+  // state of one markov chain, chain 0 moves the caller's walker and draws from the global generator
+  struct Chain
+  {
+    Walker *walk;
+    std::mt19937 *rng;
+    workingArray work;
+    double T, Eloc, ovlp, locNorm;
+    double cumT;  // time accumulated by all chains up to and including the last sample of this chain
+    VectorXd grad_ratio;
+  };
+
   Wfn *w;
   Walker *walk;
   long numVars;
   int norbs, nalpha, nbeta;
-  workingArray work;
-  double T, Eloc, ovlp, locNorm;
+  // the chains are advanced in lockstep, their samples are fed one after the other into the same averages
+  std::vector<Chain> chains;
+  std::vector<Walker> chainWalkers;
+  std::vector<std::mt19937> chainRngs;
+  bool threaded;
   double S1, S2, oldEnergy, avgNorm;  // need to keep track of avgNorm here because getGradient doesn't know about it
   double cumT, cumT2;
-  VectorXd grad_ratio;
   int nsample;
   Statistics Stats, Stats2, multiEloc; //this is only used to calculate autocorrelation length
   Determinant bestDet;
   double bestOvlp;
   bool multiSlater;
   
-  double random()
+  double random(std::mt19937 &rng)
   {
     uniform_real_distribution<double> dist(0,1);
-    return dist(generator);
+    return dist(rng);
   }
     
   ContinuousTime(Wfn &_w, Walker &_walk, int niter) : w(&_w), walk(&_walk)
   {
-    nsample = min(niter, 200000);
+    int nchains = max(schd.nchains, 1);
+    nsample = min(niter * nchains, 200000);
     numVars = w->getNumVariables();
     norbs = Determinant::norbs;
     nalpha = Determinant::nalpha;
     nbeta = Determinant::nbeta;
     bestDet = walk->getDet();
     cumT = 0.0, cumT2 = 0.0, S1 = 0.0, S2 = 0.0, avgNorm = 0.0, oldEnergy = 0.0, bestOvlp = 0.0; 
+
+    // the other chains start from copies of the initialized walker, reserved so the pointers stay valid
+    chainWalkers.reserve(nchains - 1);
+    chainRngs.reserve(nchains - 1);
+    chains.resize(nchains);
+    chains[0].walk = walk;
+    chains[0].rng = &generator;
+    for (int i = 1; i < nchains; i++) {
+      chainWalkers.push_back(*walk);
+      chainRngs.push_back(chainGenerator(i));
+      chains[i].walk = &chainWalkers.back();
+      chains[i].rng = &chainRngs.back();
+    }
+    threaded = schd.walkerThreads && nchains > 1 && constLocalEnergy<Wfn, Walker>::value;
   }
 
-  void LocalEnergy()
+  void LocalEnergy(Chain &c)
   {
-    Eloc = 0.0, ovlp = 0.0, locNorm = 0.0;
+    c.Eloc = 0.0, c.ovlp = 0.0, c.locNorm = 0.0;
     if (schd.debug) {
-      cout << *walk << endl;
+      cout << *c.walk << endl;
     }
-    w->HamAndOvlp(*walk, ovlp, Eloc, work);
-    locNorm= work.locNorm * work.locNorm;
+    w->HamAndOvlp(*c.walk, c.ovlp, c.Eloc, c.work);
+    c.locNorm = c.work.locNorm * c.work.locNorm;
     if (schd.debug) {
       //cout << *walk << endl;
-      cout << "ham  " << Eloc << "  locNorm  " << locNorm << "  ovlp  " << ovlp << endl << endl;
+      cout << "ham  " << c.Eloc << "  locNorm  " << c.locNorm << "  ovlp  " << c.ovlp << endl << endl;
     }
   }
 
+  void LocalEnergy()
+  {
+#pragma omp parallel for schedule(dynamic) if (threaded)
+    for (int i = 0; i < chains.size(); i++) LocalEnergy(chains[i]);
+  }
+
   void MakeMove()
   {
-    double cumOvlp = 0.0;
-    for (int i = 0; i < work.nExcitations; i++)
-    {
-      cumOvlp += abs(work.ovlpRatio[i]);
-      work.ovlpRatio[i] = cumOvlp;
+    for (Chain &c : chains) {
+      double cumOvlp = 0.0;
+      for (int i = 0; i < c.work.nExcitations; i++)
+      {
+        cumOvlp += abs(c.work.ovlpRatio[i]);
+        c.work.ovlpRatio[i] = cumOvlp;
+      }
+      if (c.locNorm < schd.normSampleThreshold) c.T = 1.0 / cumOvlp;
+      else c.T = 0.;
+      double nextDetRand = random(*c.rng) * cumOvlp;
+      int nextDet = lower_bound(c.work.ovlpRatio.begin(), c.work.ovlpRatio.begin() + c.work.nExcitations, nextDetRand) - c.work.ovlpRatio.begin();
+      cumT += c.T;
+      cumT2 += c.T * c.T;
+      c.cumT = cumT;
+      multiEloc.push_back(c.Eloc, c.locNorm, c.ovlp, c.walk->getDet(), c.T);
+      c.walk->updateWalker(w->getRef(), w->getCorr(), c.work.excitation1[nextDet], c.work.excitation2[nextDet]);
     }
-    if (locNorm < schd.normSampleThreshold) T = 1.0 / cumOvlp;
-    else T = 0.;
-    double nextDetRand = random() * cumOvlp;
-    int nextDet = lower_bound(work.ovlpRatio.begin(), work.ovlpRatio.begin() + work.nExcitations, nextDetRand) - work.ovlpRatio.begin();
-    cumT += T;
-    cumT2 += T * T;
-    multiEloc.push_back(Eloc, locNorm, ovlp, walk->getDet(), T);
-    walk->updateWalker(w->getRef(), w->getCorr(), work.excitation1[nextDet], work.excitation2[nextDet]);
   }
 
   void UpdateBestDet()
   {
-    if (abs(ovlp) > bestOvlp)
-    {
-      bestOvlp = abs(ovlp);
-      bestDet = walk->getDet();
+    for (Chain &c : chains) {
+      if (abs(c.ovlp) > bestOvlp)
+      {
+        bestOvlp = abs(c.ovlp);
+        bestDet = c.walk->getDet();
+      }
     }
   }
   
@@ -115,16 +155,18 @@ class ContinuousTime
 
   void UpdateEnergy(double &Energy)
   {
-    oldEnergy = Energy;
-    double oldNorm = avgNorm;
-    Energy += T * (Eloc - Energy) / cumT;
-    avgNorm += T * (locNorm - oldNorm) / cumT;
-    S1 += T * (Eloc - oldEnergy) * (Eloc - Energy);
-    S2 += T * (locNorm - oldNorm) * (locNorm - avgNorm);
-    if (Stats.X.size() < nsample)
-    {
-      Stats.push_back(Eloc, T);
-      Stats2.push_back(locNorm, T);
+    for (Chain &c : chains) {
+      oldEnergy = Energy;
+      double oldNorm = avgNorm;
+      Energy += c.T * (c.Eloc - Energy) / c.cumT;
+      avgNorm += c.T * (c.locNorm - oldNorm) / c.cumT;
+      S1 += c.T * (c.Eloc - oldEnergy) * (c.Eloc - Energy);
+      S2 += c.T * (c.locNorm - oldNorm) * (c.locNorm - avgNorm);
+      if (Stats.X.size() < nsample)
+      {
+        Stats.push_back(c.Eloc, c.T);
+        Stats2.push_back(c.locNorm, c.T);
+      }
     }
   }
  
@@ -185,14 +227,19 @@ class ContinuousTime
 
   void LocalGradient()
   {
-    grad_ratio.setZero(numVars);
-    w->OverlapWithGradient(*walk, ovlp, grad_ratio);
+#pragma omp parallel for schedule(dynamic) if (threaded)
+    for (int i = 0; i < chains.size(); i++) {
+      chains[i].grad_ratio.setZero(numVars);
+      w->OverlapWithGradient(*chains[i].walk, chains[i].ovlp, chains[i].grad_ratio);
+    }
   }
   
   void UpdateGradient(VectorXd &grad, VectorXd &grad_ratio_bar)
   {
-    grad_ratio_bar += T * (grad_ratio * work.locNorm - grad_ratio_bar) / cumT;
-    grad += T * (grad_ratio * Eloc / work.locNorm - grad) / cumT;
+    for (Chain &c : chains) {
+      grad_ratio_bar += c.T * (c.grad_ratio * c.work.locNorm - grad_ratio_bar) / c.cumT;
+      grad += c.T * (c.grad_ratio * c.Eloc / c.work.locNorm - grad) / c.cumT;
+    }
   }
 
   // this function is tangled with the finisgenergy function, need to be called in sequence, should be combined 
@@ -220,10 +267,7 @@ class ContinuousTime
 
   void UpdateSR(DirectMetric &S)
   {
-    VectorXd appended(numVars + 1);
-    appended << 1.0, grad_ratio;
-    S.Vectors.push_back(appended);
-    S.T.push_back(T);
+    for (Chain &c : chains) S.appendSample(c.grad_ratio, c.T);
   }
   
   void FinishSR(const VectorXd &grad, const VectorXd &grad_ratio_bar, VectorXd &H)
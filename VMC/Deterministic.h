@@ -104,10 +104,7 @@ class Deterministic
   
   void UpdateSR(DirectMetric &S)
   {
-    VectorXd appended(numVars+1);
-    appended << 1.0, grad_ratio;
-    S.Vectors.push_back(appended);
-    S.T.push_back(ovlp * ovlp);
+    S.appendSample(grad_ratio, ovlp * ovlp);
   }
   
   void FinishSR(const VectorXd &grad, const VectorXd &grad_ratio_bar, VectorXd &H)
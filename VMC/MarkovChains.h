@@ -0,0 +1,32 @@
+#ifndef MARKOVCHAINS_HEADER_H
+#define MARKOVCHAINS_HEADER_H
+#include <Eigen/Dense>
+#include <random>
+#include <type_traits>
+#include <utility>
+#include "global.h"
+#include "input.h"
+#include "workingArray.h"
+
+// helpers for the samplers that advance several markov chains per rank in lockstep (sampling.nchains)
+
+// generator of chain i > 0, seeded from the seed, rank and chain index so that the chains are independent
+// chain 0 keeps drawing from the global generator, so a single chain run is unchanged
+inline std::mt19937 chainGenerator(int i)
+{
+  std::seed_seq seq{size_t(schd.seed), size_t(commrank), size_t(i)};
+  return std::mt19937(seq);
+}
+
+// true if the local energy and the overlap gradient of Wfn are const, only then are the chains spread over
+// threads (sampling.walkerThreads), wavefunctions that cache intermediates in members are always run serially
+template<typename Wfn, typename Walker, typename = void>
+struct constLocalEnergy : std::false_type {};
+
+template<typename Wfn, typename Walker>
+struct constLocalEnergy<Wfn, Walker,
+  decltype(void(std::declval<const Wfn&>().HamAndOvlp(std::declval<const Walker&>(), std::declval<double&>(), std::declval<double&>(), std::declval<workingArray&>())),
+           void(std::declval<const Wfn&>().OverlapWithGradient(std::declval<const Walker&>(), std::declval<double&>(), std::declval<Eigen::VectorXd&>())))>
+  : std::true_type {};
+
+#endif
@@ -8,6 +8,7 @@
 #include "sr.h"
 #include "global.h"
 #include "evaluateE.h"
+#include "MarkovChains.h"
 #include <iostream>
 #include <fstream>
 #include <boost/serialization/serialization.hpp>
@@ -82,59 +83,99 @@ template<typename Wfn, typename Walker>
 class Metropolis
 {
   public:
+  // state of one markov chain, chain 0 moves the caller's walker and draws from the global generator
+  struct Chain
+  {
+    Walker *walk;
+    std::mt19937 *rng;
+    workingArray work;
+    double Eloc, ovlp;
+    double n;  // number of moves made by all chains up to and including the last move of this chain
+    bool calcEloc;
+    VectorXd grad_ratio;
+  };
+
   Wfn *w;
   Walker *walk;
   long numVars;
   int norbs, nalpha, nbeta;
-  workingArray work;
-  double Eloc, ovlp;
+  // the chains are advanced in lockstep, their samples are fed one after the other into the same averages
+  std::vector<Chain> chains;
+  std::vector<Walker> chainWalkers;
+  std::vector<std::mt19937> chainRngs;
+  bool threaded;
   double S1, oldEnergy;
-  VectorXd grad_ratio;
   int nsample;
   Statistics Stats; //this is only used to calculate autocorrelation length
   //auto random = bind(uniform_real_distribution<double>dist(0,1), ref(generator));
   Determinant bestDet;
   double bestOvlp;
-  bool calcEloc;
   double fracAmoves, n, nAMoves;
 
   // Data for Metropolis in FOIS calculations (SCCI and SCPT)
-  workingArray morework, morework_new;
   int nFOISExcit;
   std::vector<int> validInds;
   
-  double random()
+  double random(std::mt19937 &rng)
   {
     uniform_real_distribution<double> dist(0,1);
-    return dist(generator);
+    return dist(rng);
   }
   
   Metropolis(Wfn &_w, Walker &_walk, int niter) : w(&_w), walk(&_walk)
   {
-    nsample = min(niter, 200000);
+    int nchains = max(schd.nchains, 1);
+    nsample = min(niter * nchains, 200000);
     numVars = w->getNumVariables();
     norbs = Determinant::norbs;
     nalpha = Determinant::nalpha;
     nbeta = Determinant::nbeta;
     bestDet = walk->getDet();
     S1 = 0.0, oldEnergy = 0.0, bestOvlp = 0.0, nAMoves = 0.0, n = 0.0;
-    calcEloc = true;
+
+    // the other chains start from copies of the initialized walker, reserved so the pointers stay valid
+    chainWalkers.reserve(nchains - 1);
+    chainRngs.reserve(nchains - 1);
+    chains.resize(nchains);
+    chains[0].walk = walk;
+    chains[0].rng = &generator;
+    for (int i = 1; i < nchains; i++) {
+      chainWalkers.push_back(*walk);
+      chainRngs.push_back(chainGenerator(i));
+      chains[i].walk = &chainWalkers.back();
+      chains[i].rng = &chainRngs.back();
+    }
+    for (Chain &c : chains) c.calcEloc = true;
+    threaded = schd.walkerThreads && nchains > 1 && constLocalEnergy<Wfn, Walker>::value;
   }
   
   void LocalEnergy()
   {
-    if (calcEloc)
-    {
-      Eloc = 0.0, ovlp = 0.0;
-      w->HamAndOvlp(*walk, ovlp, Eloc, work);
+#pragma omp parallel for schedule(dynamic) if (threaded)
+    for (int i = 0; i < chains.size(); i++) {
+      Chain &c = chains[i];
+      if (c.calcEloc)
+      {
+        c.Eloc = 0.0, c.ovlp = 0.0;
+        w->HamAndOvlp(*c.walk, c.ovlp, c.Eloc, c.work);
+      }
     }
   }
 
   void MakeMove()
   {
-    if (abs(ovlp) > bestOvlp)
+    for (Chain &c : chains) {
+      MakeMove(c);
+      c.n = n;
+    }
+  }
+
+  void MakeMove(Chain &c)
+  {
+    Walker *walk = c.walk;
+    if (abs(c.ovlp) > bestOvlp)
     {
-      bestOvlp = abs(ovlp);
+      bestOvlp = abs(c.ovlp);
       bestDet = walk->getDet();
     }
     Determinant cdet = walk->getDet();  
@@ -144,14 +185,14 @@ class Metropolis
     double P_a = C.AlphaMoves() / C.TotalMoves();
     double P_b = C.BetaMoves() / C.TotalMoves();
     double P_d = C.DoubleMoves() / C.TotalMoves();
-    double rand = random();
+    double rand = random(*c.rng);
     int orb1, orb2;
     double pdetOvercdet;
     if (rand < P_a) 
     {
       move = Amove;
-      orb1 = C.a[(int) (random() * C.a.size())];
-      orb2 = C.ua[(int) (random() * C.ua.size())];
+      orb1 = C.a[(int) (random(*c.rng) * C.a.size())];
+      orb2 = C.ua[(int) (random(*c.rng) * C.ua.size())];
       pdet.setoccA(orb1, false);
       pdet.setoccA(orb2, true);
       pdetOvercdet = w->getOverlapFactor(2*orb1, 0, 2*orb2, 0, *walk, false);
@@ -159,8 +200,8 @@ class Metropolis
     else if (rand < (P_b + P_a)) 
     {
       move = Bmove;
-      orb1 = C.b[(int) (random() * C.b.size())];
-      orb2 = C.ub[(int) (random() * C.ub.size())];
+      orb1 = C.b[(int) (random(*c.rng) * C.b.size())];
+      orb2 = C.ub[(int) (random(*c.rng) * C.ub.size())];
       pdet.setoccB(orb1, false);
       pdet.setoccB(orb2, true);
       pdetOvercdet = w->getOverlapFactor(2*orb1+1, 0, 2*orb2+1, 0, *walk, false);
@@ -168,8 +209,8 @@ class Metropolis
     else if (rand < (P_d + P_a + P_b))
     {
       move = Dmove;
-      orb1 = C.sa[(int) (random() * C.sa.size())];
-      orb2 = C.sb[(int) (random() * C.sb.size())];
+      orb1 = C.sa[(int) (random(*c.rng) * C.sa.size())];
+      orb2 = C.sb[(int) (random(*c.rng) * C.sb.size())];
       pdet.setoccA(orb1, false);
       pdet.setoccB(orb2, false);
       pdet.setoccB(orb1, true);
@@ -181,7 +222,7 @@ class Metropolis
     double T_P = 1.0 / P.TotalMoves();
     double P_pdetOvercdet = pdetOvercdet * pdetOvercdet;
     double accept = min(1.0, (T_P * P_pdetOvercdet) / T_C);
-    if (random() < accept)
+    if (random(*c.rng) < accept)
     {
       /*
       e.push_back(Eloc);
@@ -189,7 +230,7 @@ class Metropolis
       weight = 1.0;
       */
       nAMoves += 1.0;
-      calcEloc = true;
+      c.calcEloc = true;
       if (move == Amove)
       {
         walk->update(orb1, orb2, 0, w->getRef(), w->getCorr());
@@ -206,7 +247,7 @@ class Metropolis
     }
     else
     {
-      calcEloc = false;
+      c.calcEloc = false;
       //weight += 1.0;
     }
     n += 1.0;
@@ -314,12 +355,14 @@ class Metropolis
 
   void UpdateEnergy(double &Energy)
   {
-    oldEnergy = Energy;
-    Energy += (Eloc - Energy) / n;
-    S1 += (Eloc - oldEnergy) * (Eloc - Energy);
-    if (Stats.X.size() < nsample)
-    {
-      Stats.push_back(Eloc);
+    for (Chain &c : chains) {
+      oldEnergy = Energy;
+      Energy += (c.Eloc - Energy) / c.n;
+      S1 += (c.Eloc - oldEnergy) * (c.Eloc - Energy);
+      if (Stats.X.size() < nsample)
+      {
+        Stats.push_back(c.Eloc);
+      }
     }
   }
   
@@ -357,17 +400,23 @@ class Metropolis
 
   void LocalGradient()
   {
-    if (calcEloc)
-    {
-      grad_ratio.setZero(numVars);
-      w->OverlapWithGradient(*walk, ovlp, grad_ratio);
+#pragma omp parallel for schedule(dynamic) if (threaded)
+    for (int i = 0; i < chains.size(); i++) {
+      Chain &c = chains[i];
+      if (c.calcEloc)
+      {
+        c.grad_ratio.setZero(numVars);
+        w->OverlapWithGradient(*c.walk, c.ovlp, c.grad_ratio);
+      }
     }
   }
 
   void UpdateGradient(VectorXd &grad, VectorXd &grad_ratio_bar)
   {
-    grad_ratio_bar += grad_ratio;
-    grad += grad_ratio * Eloc;
+    for (Chain &c : chains) {
+      grad_ratio_bar += c.grad_ratio;
+      grad += c.grad_ratio * c.Eloc;
+    }
   }
   
   void FinishGradient(VectorXd &grad, VectorXd &grad_ratio_bar, const double &Energy)
@@ -34,6 +34,7 @@ void ConjGrad(DirectMetric &A, VectorXd &b, int n, VectorXd &x)
     r = r - alpha * Ap;
     
     double rsnew = r.adjoint() * r;
+    if (rsnew < tol) break;
     double beta = rsnew / rsold;
 
     rsold = rsnew;
@@ -41,6 +42,87 @@ void ConjGrad(DirectMetric &A, VectorXd &b, int n, VectorXd &x)
   }
 }
 
+bool DirectMetric::useSampleSpace(int dim)
+{
+  int N = nsamples;
+#ifndef SERIAL
+  MPI_Allreduce(MPI_IN_PLACE, &N, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+#endif
+  return diagshift > 0. && N <= schd.minSRSamples && 4 * N <= dim;
+}
+
+void DirectMetric::solveSampleSpace(VectorXd &grad, double tau, VectorXd &x)
+{
+  reduceWeights();
+  int dim = grad.rows() + 1;
+  VectorXd b = VectorXd::Zero(dim);
+  b.tail(grad.rows()) = grad;
+
+  //samples of all ranks, in rank order
+  vector<int> counts(commsize, nsamples), displs(commsize, 0);
+#ifndef SERIAL
+  MPI_Allgather(&nsamples, 1, MPI_INT, &counts[0], 1, MPI_INT, MPI_COMM_WORLD);
+#endif
+  for (int r = 1; r < commsize; r++) displs[r] = displs[r-1] + counts[r-1];
+  int N = displs[commsize-1] + counts[commsize-1];
+  VectorXd Tall(N);
+#ifndef SERIAL
+  MPI_Allgatherv(T.data(), nsamples, MPI_DOUBLE, Tall.data(), &counts[0], &displs[0], MPI_DOUBLE, MPI_COMM_WORLD);
+#else
+  Tall = T.head(nsamples);
+#endif
+
+  //rank r gets the rows rowStart[r] ... rowStart[r+1]-1 of all the samples
+  vector<int> rowStart(commsize + 1);
+  for (int r = 0; r <= commsize; r++) rowStart[r] = (long)dim * r / commsize;
+  int nrows = rowStart[commrank+1] - rowStart[commrank];
+  MatrixXd B(nrows, N);
+#ifndef SERIAL
+  vector<int> sendCounts(commsize), sendDispls(commsize), recvCounts(commsize), recvDispls(commsize);
+  VectorXd sendBuf(dim * nsamples);
+  for (int r = 0; r < commsize; r++) {
+    sendCounts[r] = (rowStart[r+1] - rowStart[r]) * nsamples;
+    sendDispls[r] = rowStart[r] * nsamples;
+    if (nsamples > 0)
+      Map<MatrixXd>(sendBuf.data() + sendDispls[r], rowStart[r+1] - rowStart[r], nsamples)
+        = G.block(rowStart[r], 0, rowStart[r+1] - rowStart[r], nsamples);
+    recvCounts[r] = nrows * counts[r];
+    recvDispls[r] = nrows * displs[r];
+  }
+  MPI_Alltoallv(sendBuf.data(), &sendCounts[0], &sendDispls[0], MPI_DOUBLE,
+                B.data(), &recvCounts[0], &recvDispls[0], MPI_DOUBLE, MPI_COMM_WORLD);
+#else
+  B = G.leftCols(nsamples);
+#endif
+  //centered gradients, the constant row becomes zero
+  VectorXd mean = B * Tall / Tau;
+  B.colwise() -= mean;
+  B = B * (Tall / Tau).cwiseSqrt().asDiagonal();
+
+  //A^T A and A^T b in one reduction
+  MatrixXd K = MatrixXd::Zero(N, N + 1);
+  K.leftCols(N).selfadjointView<Lower>().rankUpdate(B.transpose());
+  K.col(N).noalias() = B.transpose() * b.segment(rowStart[commrank], nrows);
+#ifndef SERIAL
+  MPI_Allreduce(MPI_IN_PLACE, K.data(), K.size(), MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+#endif
+  K.leftCols(N).diagonal().array() += diagshift;
+  VectorXd y = K.leftCols(N).selfadjointView<Lower>().llt().solve(K.col(N));
+
+  VectorXd xslice = -tau * (b.segment(rowStart[commrank], nrows) - B * y) / diagshift;
+  x.resize(dim);
+#ifndef SERIAL
+  for (int r = 0; r < commsize; r++) {
+    recvCounts[r] = rowStart[r+1] - rowStart[r];
+    recvDispls[r] = rowStart[r];
+  }
+  MPI_Allgatherv(xslice.data(), nrows, MPI_DOUBLE, x.data(), &recvCounts[0], &recvDispls[0], MPI_DOUBLE, MPI_COMM_WORLD);
+#else
+  x = xslice;
+#endif
+  x(0) = 1.;
+}
+
 void PInv(MatrixXd &A, MatrixXd &Ainv)
 {
     SelfAdjointEigenSolver<MatrixXd> es;
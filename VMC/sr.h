@@ -38,28 +38,65 @@ using namespace Eigen;
 using namespace boost;
 using namespace std;
 
+//the sr metric S = sum_i T_i g_i g_i^T / sum_i T_i, with g_i = (1, grad_ratio_i) of the samples on this rank
+//the g_i are the columns of one buffer G, reserved for stochasticIter samples per chain, so the products with S
+//are two gemv's and a single allreduce. when there are many more variables than samples the sr equations
+//are solved in the space of the samples instead (solveSampleSpace)
 class DirectMetric
 {
     public:
-    vector<double> T;
-    vector<VectorXd> Vectors;
+    MatrixXd G;
+    VectorXd T;
+    int nsamples;
+    double Tau;     //sum of T over all ranks
+    bool reduced;   //Tau is up to date
     double diagshift;
     MatrixXd S;
-    DirectMetric(double _diagshift) : diagshift(_diagshift) {}
+    DirectMetric(double _diagshift) : diagshift(_diagshift), nsamples(0), Tau(0.), reduced(false) {}
 
-    void BuildMetric()
+    void clear()
+    {
+      nsamples = 0;
+      reduced = false;
+    }
+
+    //room for ncols samples, so that appendSample does not have to grow G
+    void reserve(int dim, int ncols)
+    {
+      if (G.rows() == dim && G.cols() >= ncols) return;
+      G.resize(dim, ncols);
+      T.resize(ncols);
+      nsamples = 0;
+    }
+
+    void appendSample(const VectorXd &grad_ratio, double t)
     {
-      double Tau = 0.0;
-      int dim = Vectors[0].rows();
-      S = MatrixXd::Zero(dim, dim);
-      for (int i = 0; i < Vectors.size(); i++)
-      {
-        S += T[i] * Vectors[i] * Vectors[i].adjoint();
-        Tau += T[i];
+      if (nsamples == G.cols()) {
+        G.conservativeResize(grad_ratio.rows() + 1, G.cols() + 1024);
+        T.conservativeResize(G.cols());
       }
+      G(0, nsamples) = 1.0;
+      G.col(nsamples).tail(grad_ratio.rows()) = grad_ratio;
+      T(nsamples) = t;
+      nsamples++;
+      reduced = false;
+    }
 
+    void reduceWeights()
+    {
+      if (reduced) return;
+      Tau = T.head(nsamples).sum();
 #ifndef SERIAL
       MPI_Allreduce(MPI_IN_PLACE, &(Tau), 1, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+#endif
+      reduced = true;
+    }
+
+    void BuildMetric()
+    {
+      reduceWeights();
+      S = G.leftCols(nsamples) * T.head(nsamples).asDiagonal() * G.leftCols(nsamples).transpose();
+#ifndef SERIAL
       MPI_Allreduce(MPI_IN_PLACE, &(S(0,0)), S.rows() * S.cols(), MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
 #endif
       S /= Tau; 
@@ -68,25 +105,31 @@ class DirectMetric
     
   void multiply(VectorXd &x, VectorXd& Ax)
   {
-    double Tau = 0.0;
-    int dim = x.rows();
-    if (Ax.rows() != x.rows())
-      Ax = VectorXd::Zero(dim);
-    else
-      Ax.setZero();
-    for (int i = 0; i < Vectors.size(); i++)
-    {
-      double factor = Vectors[i].adjoint() * x;
-      Ax += T[i] * Vectors[i] * factor;
-      Tau += T[i];
+    reduceWeights();
+    if (nsamples == 0)
+      Ax = VectorXd::Zero(x.rows());
+    else {
+      VectorXd factor = T.head(nsamples).cwiseProduct(G.leftCols(nsamples).transpose() * x);
+      Ax.noalias() = G.leftCols(nsamples) * factor;
     }
 #ifndef SERIAL
       MPI_Allreduce(MPI_IN_PLACE, &(Ax(0)), Ax.rows(), MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
-      MPI_Allreduce(MPI_IN_PLACE, &(Tau), 1, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
 #endif
       Ax /= Tau;
       Ax += diagshift * x;
     } 
+
+  //true if the sr equations are to be solved in the space of the samples: turned on by a positive
+  //optimizer.minSRSamples, the total number of samples over all ranks it may not exceed, and used only
+  //with a positive diagshift and at least four variables per sample
+  bool useSampleSpace(int dim);
+
+  //the sr step with centered gradients, x = (1, -tau (S_c + diagshift)^-1 grad), through
+  //(S_c + diagshift)^-1 grad = (grad - A (A^T A + diagshift)^-1 A^T grad) / diagshift, where
+  //A = [(g_i - <g>) sqrt(T_i / Tau)] is nvars x nsamples. the step stays in the span of the samples.
+  //the rows of A are redistributed over the ranks so that the nsamples x nsamples A^T A is summed
+  //in one allreduce
+  void solveSampleSpace(VectorXd &grad, double tau, VectorXd &x);
 };
 
 void ConjGrad(DirectMetric &A, VectorXd &b, int n, VectorXd &x);
@@ -158,6 +201,7 @@ class SR
      int numVars = vars.rows();
      VectorXd grad, x, H;
      DirectMetric S(schd.sDiagShift);
+     if (!schd.deterministic) S.reserve(numVars + 1, schd.stochasticIter * max(schd.nchains, 1));
      double E0, stddev, rt;
      while (iter < maxIter)
      {
@@ -167,8 +211,7 @@ class SR
        grad.setZero(numVars);
        x.setZero(numVars + 1);
        H.setZero(numVars + 1);
-       S.Vectors.clear();
-       S.T.clear();
+       S.clear();
 
        getMetric(vars, grad, H, S, E0, stddev, rt);
        write(vars);
@@ -191,7 +234,10 @@ class SR
        //xguess << 1.0, vars;
 
        x[0] = 1.0;
-       ConjGrad(S, H, schd.cgIter, x);
+       if (S.useSampleSpace(numVars + 1))
+         S.solveSampleSpace(grad, schd.stepsize, x);
+       else
+         ConjGrad(S, H, schd.cgIter, x);
        
        for (int i = 0; i < vars.rows(); i++)
        {
@@ -79,7 +79,7 @@ double CPS::OverlapRatio (const Determinant &d1, const Determinant &d2) const {
 double CPS::OverlapRatio(int i, int a, const Determinant &dcopy, const Determinant &d) const
 {
   //boost::container::static_vector<int, 100> commonCorrelators;
-  vector<int>& common = const_cast<vector<int>&>(commonCorrelators);
+  static thread_local vector<int> common; //per thread, these are called from the threaded local energies
   common.resize(0);
   
   merge(mapFromOrbitalToCorrelator[i].begin(),
@@ -105,7 +105,7 @@ double CPS::OverlapRatio(int i, int a, const Determinant &dcopy, const Determina
 double CPS::OverlapRatio(int i, int j, int a, int b, const Determinant &dcopy, const Determinant &d) const
 {
   //boost::container::static_vector<int, 100> common;
-  vector<int>& common = const_cast<vector<int>&>(commonCorrelators);
+  static thread_local vector<int> common;
   common.resize(0);
   
   merge(mapFromOrbitalToCorrelator[i].begin(),
@@ -156,7 +156,7 @@ double CPS::OverlapRatio(int i, int j, int a, int b, const Determinant &dcopy, c
 double CPS::OverlapRatio(int i, int a, const BigDeterminant &dcopy, const BigDeterminant &d) const
 {
   //boost::container::static_vector<int, 100> commonCorrelators;
-  vector<int>& common = const_cast<vector<int>&>(commonCorrelators);
+  static thread_local vector<int> common;
   common.resize(0);
   
   merge(mapFromOrbitalToCorrelator[i].begin(),
@@ -183,7 +183,7 @@ double CPS::OverlapRatio(int i, int a, const BigDeterminant &dcopy, const BigDet
 double CPS::OverlapRatio(int i, int j, int a, int b, const BigDeterminant &dcopy, const BigDeterminant &d) const
 {
   //boost::container::static_vector<int, 100> common;
-  vector<int>& common = const_cast<vector<int>&>(commonCorrelators);
+  static thread_local vector<int> common;
   common.resize(0);
   
   merge(mapFromOrbitalToCorrelator[i].begin(),
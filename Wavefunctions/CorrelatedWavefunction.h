@@ -25,6 +25,7 @@
 #include <unordered_set>
 #include "input.h"
 #include "Walker.h"
+#include "excitationSum.h"
 
 class oneInt;
 class twoInt;
@@ -259,7 +260,7 @@ struct CorrelatedWavefunction {
     int norbs = Determinant::norbs;
 
     ovlp = Overlap(walk);
-    ham = walk.d.Energy(I1, I2, coreE); 
+    ham = walk.energy(); 
 
     work.setCounterToZero();
     generateAllScreenedSingleExcitation(walk.d, epsilon, schd.screen,
@@ -270,7 +271,7 @@ struct CorrelatedWavefunction {
 
     //loop over all the screened excitations
     if (schd.debug) cout << "eloc excitations\nphi0  d.energy " << ham << endl;
-    for (int i=0; i<work.nExcitations; i++) {
+    ham = sumOverExcitations(work, ham, [&](int i) {
       int ex1 = work.excitation1[i], ex2 = work.excitation2[i];
       double tia = work.HijElement[i];
     
@@ -280,11 +281,11 @@ struct CorrelatedWavefunction {
       double ovlpRatio = getOverlapFactor(I, J, A, B, walk, false);
       //double ovlpRatio = getOverlapFactor(I, J, A, B, walk, dbig, dbigcopy, false);
 
-      ham += tia * ovlpRatio;
       if (schd.debug) cout << I << "  " << A << "  " << J << "  " << B << "  tia  " << tia << "  ovlpRatio  " << ovlpRatio << endl;
 
       work.ovlpRatio[i] = ovlpRatio;
-    }
+      return tia * ovlpRatio;
+    });
     if (schd.debug) cout << endl;
   }
 
@@ -295,7 +296,7 @@ struct CorrelatedWavefunction {
     int norbs = Determinant::norbs;
 
     ovlp = Overlap(walk);
-    ham = walk.d.Energy(I1, I2, coreE);
+    ham = walk.energy();
     SVTotal = 0.0;
 
     work.setCounterToZero();
@@ -303,7 +304,7 @@ struct CorrelatedWavefunction {
     generateAllScreenedDoubleExcitation(walk.d, epsilon, schd.screen, work, false);
 
     // Loop over all the screened excitations
-    for (int i=0; i<work.nExcitations; i++) {
+    ham = sumOverExcitations(work, ham, [&](int i) {
       int ex1 = work.excitation1[i];
       int ex2 = work.excitation2[i];
       double tia = work.HijElement[i];
@@ -313,15 +314,16 @@ struct CorrelatedWavefunction {
 
       double ovlpRatio = getOverlapFactor(I, J, A, B, walk, false);
 
-      double contrib = tia * ovlpRatio;
-      ham += contrib;
+      work.ovlpRatio[i] = ovlpRatio;
+      return tia * ovlpRatio;
+    });
 
-      // Accumulate the sign violating terms for the appropriate Hamiltonian.
+    // Accumulate the sign violating terms for the appropriate Hamiltonian.
+    for (int i=0; i<work.nExcitations; i++) {
+      double contrib = work.HijElement[i] * work.ovlpRatio[i];
       if (contrib > 0.0) {
         SVTotal += contrib;
       }
-
-      work.ovlpRatio[i] = ovlpRatio;
     }
   }
 
@@ -343,23 +345,24 @@ struct CorrelatedWavefunction {
 
     lanczosCoeffsSample[0] = ovlp[0] * ovlp[0] * el0 / (ovlp[2] * ovlp[2]);
     lanczosCoeffsSample[1] = ovlp[0] * ovlp[1] * el0 / (ovlp[2] * ovlp[2]);
-    el1 = walk.d.Energy(I1, I2, coreE);
+    el1 = walk.energy();
 
     //if (schd.debug) cout << "phi1  d.energy  " << el1 << endl;
     //workingArray work1;
     //cout << "E0  " << el1 << endl;
     //loop over all the screened excitations
-    for (int i=0; i<work.nExcitations; i++) {
+    el1 = sumOverExcitations(work, el1, moreWork, [&](int i, workingArray& scratch) {
       double tia = work.HijElement[i];
+      double ovlp0 = 0., el0 = 0.;
       Walker<Corr, Reference> walkCopy = walk;
       walkCopy.updateWalker(ref, corr, work.excitation1[i], work.excitation2[i], false);
-      moreWork.setCounterToZero();
-      HamAndOvlp(walkCopy, ovlp0, el0, moreWork, true, schd.lanczosEpsilon);
-      ovlp1 = el0 * ovlp0;
-      el1 += tia * ovlp1 / ovlp[1];
+      scratch.setCounterToZero();
+      HamAndOvlp(walkCopy, ovlp0, el0, scratch, true, schd.lanczosEpsilon);
+      double ovlp1 = el0 * ovlp0;
       work.ovlpRatio[i] = (ovlp0 + alpha * ovlp1) / ovlp[2];
       //if (schd.debug) cout << work.excitation1[i] << "  " << work.excitation2[i] << "  tia  " << tia << "  ovlpRatio  " << ovlp1 / ovlp[1] << endl;
-    }
+      return tia * ovlp1 / ovlp[1];
+    });
 
     //if (schd.debug) cout << endl;
     lanczosCoeffsSample[2] = ovlp[1] * ovlp[1] * el1 / (ovlp[2] * ovlp[2]);
@@ -24,6 +24,7 @@
 #include "Determinants.h"
 #include "workingArray.h"
 #include "excitationOperators.h"
+#include "excitationSum.h"
 #include <boost/serialization/serialization.hpp>
 #include <boost/serialization/vector.hpp>
 #include <boost/serialization/array.hpp>
@@ -51,7 +52,6 @@ class Lanczos
  public:
   double alpha;
   Wfn wave;
-  workingArray morework;
   
   Lanczos()
   {
@@ -141,6 +141,7 @@ class Lanczos
     double ovlp = wave.Overlap(walk);
     double ham = walk.d.Energy(I1, I2, coreE); 
 
+    workingArray& morework = threadWorkingArray();
     morework.setCounterToZero();
     generateAllScreenedSingleExcitation(walk.d, schd.epsilon, schd.screen,
                                         morework, false);  
@@ -176,6 +177,7 @@ class Lanczos
     ham = walk.d.Energy(I1, I2, coreE); 
     //ovlp = Overlap(walk);
 
+    workingArray& morework = threadWorkingArray();
     morework.setCounterToZero();
     double ovlp0, ham0;
     wave.HamAndOvlp(walk, ovlp0, ham0, morework);
@@ -188,21 +190,22 @@ class Lanczos
                                         work, false);  
 
     //loop over all the screened excitations
-    for (int i=0; i<work.nExcitations; i++) {
+    ham = sumOverExcitations(work, ham, morework, [&](int i, workingArray& scratch) {
       double tia = work.HijElement[i];
+      double ovlp0 = 0., ham0 = 0.;
       auto walkCopy = walk;
       walkCopy.updateWalker(wave.getRef(), wave.getCorr(),
                             work.excitation1[i], work.excitation2[i], false);
 
       //double ovlp0 = Overlap(walkCopy);
 
-      morework.setCounterToZero();
-      wave.HamAndOvlp(walkCopy, ovlp0, ham0, morework);
+      scratch.setCounterToZero();
+      wave.HamAndOvlp(walkCopy, ovlp0, ham0, scratch);
       ovlp0 = ovlp0*(1 + alpha*ham0);
 
-      ham += tia * ovlp0/ovlp;
       work.ovlpRatio[i] = ovlp0/ovlp;
-    }
+      return tia * ovlp0/ovlp;
+    });
   }
 
   string getfileName() const {
@@ -19,6 +19,7 @@
 
 #include "SCPT.h"
 #include "SelectedCI.h"
+#include "excitationSum.h"
 
 class oneInt;
 class twoInt;
@@ -145,6 +146,7 @@ SCPT<Wfn>::SCPT()
 
 template<typename Wfn>
 void SCPT<Wfn>::createClassIndMap(int& numStates_1h2p, int& numStates_2h1p, int& numStates_2h2p) {
+  workingArray& morework = threadWorkingArray();
   // Loop over all combinations of vore and virtual pairs.
   // For each, see if the corresponding Hamiltonian element is non-zero.
   // If so, give it an index and put that index in a hash table for
@@ -454,6 +456,7 @@ template<typename Walker>
 void SCPT<Wfn>::HamAndOvlp(Walker &walk, double &ovlp, double &locEne, double &ham,
                            double &norm, int coeffsIndex, workingArray& work, bool fillExcitations)
 {
+  workingArray& morework = threadWorkingArray();
   int norbs = Determinant::norbs;
 
   double ciCoeff = coeffs(coeffsIndex);
@@ -563,8 +566,8 @@ template<typename Wfn>
 template<typename Walker>
 void SCPT<Wfn>::FastHamAndOvlp(Walker &walk, double &ovlp, double &ham, workingArray& work, bool fillExcitations)
 {
-  double ovlp0, ham0;
-  double tiaD, parity;
+  workingArray& morework = threadWorkingArray();
+  double ham0;
   int norbs = Determinant::norbs;
 
   work.setCounterToZero();
@@ -606,7 +609,7 @@ void SCPT<Wfn>::FastHamAndOvlp(Walker &walk, double &ovlp, double &ham, workingA
   generateAllScreenedDoubleExcitationsDyall(walk.d, schd.epsilon, schd.screen, work, false);
 
   // loop over all the screened excitations
-  for (int i=0; i<work.nExcitations; i++) {
+  ham = sumOverExcitations(work, ham, morework, [&](int i, workingArray& scratch) {
     double tiaD = work.HijElement[i];
 
     int ex1 = work.excitation1[i], ex2 = work.excitation2[i];
@@ -619,14 +622,14 @@ void SCPT<Wfn>::FastHamAndOvlp(Walker &walk, double &ovlp, double &ham, workingA
       if (ex2 == 0) tiaD = work.ovlpRatio[i];
       work.ovlpRatio[i] = 0.;
     } else {
-      continue;
+      return 0.;
     }
 
     auto walkCopy = walk;
     Determinant dcopy = walkCopy.d;
     walkCopy.updateWalker(wave.getRef(), wave.getCorr(), work.excitation1[i], work.excitation2[i], false);
 
-    parity = 1.;
+    double parity = 1.;
     parity *= dcopy.parity(A/2, I/2, I%2);
     if (ex2 != 0) {
       dcopy.setocc(I, false);
@@ -634,11 +637,12 @@ void SCPT<Wfn>::FastHamAndOvlp(Walker &walk, double &ovlp, double &ham, workingA
       parity *= dcopy.parity(B/2, J/2, J%2);
     }
 
-    morework.setCounterToZero();
-    wave.HamAndOvlp(walkCopy, ovlp0, ham0, morework, false);
-    ham += parity * tiaD * ham0 / ovlp;
+    double ovlp0, ham0;
+    scratch.setCounterToZero();
+    wave.HamAndOvlp(walkCopy, ovlp0, ham0, scratch, false);
     work.ovlpRatio[i] = ham0 / ovlp;
-  }
+    return parity * tiaD * ham0 / ovlp;
+  });
 }
 
 template<typename Wfn>
@@ -647,6 +651,7 @@ void SCPT<Wfn>::HamAndSCNorms(Walker &walk, double &ovlp, double &ham, Eigen::Ve
                    vector<Determinant>& initDets, vector<double>& largestCoeffs,
                    workingArray& work, bool calcExtraNorms)
 {
+  workingArray& morework = threadWorkingArray();
 
   // which excitation classes should we consider?
   bool useAAVV;
@@ -779,6 +784,7 @@ void SCPT<Wfn>::AddSCNormsContrib(Walker &walk, double &ovlp, double &ham, Eigen
                        workingArray& work, bool calcExtraNorms, int& ex1, int& ex2,
                        double& tia, size_t& nExcitationsCASCI)
 {
+  workingArray& morework = threadWorkingArray();
   // This is called for each excitations from a determinant in the CASCI
   // space (walk.d)
   // If the excitations is within the CASCI space, store the overlap factor
@@ -847,6 +853,7 @@ void SCPT<Wfn>::HamAndSCNormsCAAA_AAAV(Walker &walk, double &ovlp, double &ham,
                    vector<Determinant>& initDets, vector<double>& largestCoeffs,
                    workingArray& work, bool calcExtraNorms)
 {
+  workingArray& morework = threadWorkingArray();
   int norbs = Determinant::norbs;
   double ham0;
 
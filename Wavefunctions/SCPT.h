@@ -57,7 +57,7 @@ class SCPT
   Eigen::VectorXd coeffs;
   Eigen::VectorXd moEne;
   Wfn wave; // reference wavefunction
-  workingArray morework;
+  // the scratch arrays of the local energies are the per-thread threadWorkingArray()
 
   double ovlp_current;
   
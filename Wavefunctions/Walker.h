@@ -53,6 +53,7 @@ struct Walker<Corr, Slater> {
   WalkerHelper<Slater> refHelper;
   unordered_set<int> excitedHoles;    //spin orbital indices of excited electrons (in core orbitals) in d
   unordered_set<int> excitedOrbs;     //spin orbital indices of excited electrons (in virtual orbitals) in d
+  mutable DiagonalEnergy diagEnergy; //<d|H|d>, tracked over the moves of the walker
 
   Walker() {};
   
@@ -74,6 +75,7 @@ struct Walker<Corr, Slater> {
   Walker(Corr &corr, const Slater &ref, const Determinant &pd) : d(pd), refHelper(ref, pd), corrHelper(corr, pd) {}; 
 
   Determinant& getDet() {return d;}
+  double energy() const { return diagEnergy.get(d, I1, I2, coreE); }
   void readBestDeterminant(Determinant& d) const 
   {
     if (commrank == 0) {
@@ -282,6 +284,7 @@ struct Walker<Corr, Slater> {
   {
     double p = 1.0;
     if (doparity) p *= d.parity(a, i, sz);
+    diagEnergy.excite(d, i, a, sz, I2);
     d.setocc(i, sz, false);
     d.setocc(a, sz, true);
     if (refHelper.hftype == Generalized) {
@@ -303,9 +306,11 @@ struct Walker<Corr, Slater> {
     double p = 1.0;
     Determinant dcopy = d;
     if (doparity) p *= d.parity(a, i, sz);
+    diagEnergy.excite(d, i, a, sz, I2);
     d.setocc(i, sz, false);
     d.setocc(a, sz, true);
     if (doparity) p *= d.parity(b, j, sz);
+    diagEnergy.excite(d, j, b, sz, I2);
     d.setocc(j, sz, false);
     d.setocc(b, sz, true);
     if (refHelper.hftype == Generalized) {
@@ -506,6 +511,7 @@ struct Walker<Corr, MultiSlater> {
   WalkerHelper<Corr> corrHelper;
   WalkerHelper<MultiSlater> refHelper;
   unordered_set<int> excitedOrbs;        //spin orbital indices of excited electrons (in virtual orbitals) in d 
+  mutable DiagonalEnergy diagEnergy; //<d|H|d>, tracked over the moves of the walker
 
   Walker() {};
   
@@ -519,6 +525,7 @@ struct Walker<Corr, MultiSlater> {
   Walker(Corr &corr, const MultiSlater &ref, const Determinant &pd) : d(pd), refHelper(ref, pd), corrHelper(corr, pd) {}; 
 
   Determinant& getDet() {return d;}
+  double energy() const { return diagEnergy.get(d, I1, I2, coreE); }
 
   void readBestDeterminant(Determinant& d) const 
   {
@@ -764,6 +771,7 @@ struct Walker<Corr, MultiSlater> {
   {
     double p = 1.0;
     if (doparity) p *= d.parity(a, i, sz);
+    diagEnergy.excite(d, i, a, sz, I2);
     d.setocc(i, sz, false);
     d.setocc(a, sz, true);
     int norbs = Determinant::norbs;
@@ -777,9 +785,11 @@ struct Walker<Corr, MultiSlater> {
     double p = 1.0;
     Determinant dcopy = d;
     if (doparity) p *= d.parity(a, i, sz);
+    diagEnergy.excite(d, i, a, sz, I2);
     d.setocc(i, sz, false);
     d.setocc(a, sz, true);
     if (doparity) p *= d.parity(b, j, sz);
+    diagEnergy.excite(d, j, b, sz, I2);
     d.setocc(j, sz, false);
     d.setocc(b, sz, true);
     int norbs = Determinant::norbs;
@@ -1306,6 +1316,7 @@ struct Walker<Corr, AGP> {
   WalkerHelper<AGP> refHelper;
   unordered_set<int> excitedHoles;    //spin orbital indices of excited electrons (in core orbitals) in d
   unordered_set<int> excitedOrbs;     //spin orbital indices of excited electrons (in virtual orbitals) in d
+  mutable DiagonalEnergy diagEnergy; //<d|H|d>, tracked over the moves of the walker
 
   Walker() {};
   
@@ -1327,6 +1338,7 @@ struct Walker<Corr, AGP> {
   Walker(Corr &corr, const AGP &ref, const Determinant &pd) : d(pd), refHelper(ref, pd), corrHelper(corr, pd) {}; 
 
   Determinant& getDet() {return d;}
+  double energy() const { return diagEnergy.get(d, I1, I2, coreE); }
   void readBestDeterminant(Determinant& d) const 
   {
     if (commrank == 0) {
@@ -1433,6 +1445,7 @@ struct Walker<Corr, AGP> {
   {
     double p = 1.0;
     if (doparity) p *= d.parity(a, i, sz);
+    diagEnergy.excite(d, i, a, sz, I2);
     d.setocc(i, sz, false);
     d.setocc(a, sz, true);
     vector<int> cre{ a }, des{ i };
@@ -1445,9 +1458,11 @@ struct Walker<Corr, AGP> {
     double p = 1.0;
     Determinant dcopy = d;
     if (doparity) p *= d.parity(a, i, sz);
+    diagEnergy.excite(d, i, a, sz, I2);
     d.setocc(i, sz, false);
     d.setocc(a, sz, true);
     if (doparity) p *= d.parity(b, j, sz);
+    diagEnergy.excite(d, j, b, sz, I2);
     d.setocc(j, sz, false);
     d.setocc(b, sz, true);
     vector<int> cre{ a, b }, des{ i, j };
@@ -1548,6 +1563,7 @@ struct Walker<Corr, Pfaffian> {
   WalkerHelper<Pfaffian> refHelper;
   unordered_set<int> excitedHoles;    //spin orbital indices of excited electrons (in core orbitals) in d
   unordered_set<int> excitedOrbs;     //spin orbital indices of excited electrons (in virtual orbitals) in d
+  mutable DiagonalEnergy diagEnergy; //<d|H|d>, tracked over the moves of the walker
 
   Walker() {};
   
@@ -1561,6 +1577,7 @@ struct Walker<Corr, Pfaffian> {
   Walker(Corr &corr, const Pfaffian &ref, const Determinant &pd) : d(pd), refHelper(ref, pd), corrHelper(corr, pd) {}; 
   
   Determinant& getDet() {return d;}
+  double energy() const { return diagEnergy.get(d, I1, I2, coreE); }
   void readBestDeterminant(Determinant& d) const 
   {
     if (commrank == 0) {
@@ -1699,6 +1716,7 @@ struct Walker<Corr, Pfaffian> {
   {
     double p = 1.0;
     p *= d.parity(a, i, sz);
+    diagEnergy.excite(d, i, a, sz, I2);
     d.setocc(i, sz, false);
     d.setocc(a, sz, true);
     refHelper.excitationUpdate(ref, i, a, sz, p, d);
@@ -904,7 +904,7 @@ class WalkerHelper<CPS>
 
   double OverlapRatio(int i, int a, const CPS& cps, const Determinant &dcopy, const Determinant &d) const
   {
-    vector<int>& common = const_cast<vector<int>&>(commonCorrelators);
+    static thread_local vector<int> common; //per thread, these are called from the threaded local energies
     common.resize(0);
 
     if (cps.twoSiteOrSmaller) {
@@ -940,7 +940,7 @@ class WalkerHelper<CPS>
     if (!(cps.twoSiteOrSmaller && i/2!=j/2 && i/2!=a/2 && i/2!= b/2 && j/2 != a/2 && j/2 != b/2 && a/2!=b/2))
       return cps.OverlapRatio(i/2, j/2, a/2, b/2, dcopy, d);
 
-    vector<int>& common = const_cast<vector<int>&>(commonCorrelators);
+    static thread_local vector<int> common;
     common.resize(0);
   
 
@@ -0,0 +1,45 @@
+#ifndef excitationSum_HEADER_H
+#define excitationSum_HEADER_H
+#include <vector>
+#include <omp.h>
+#include "global.h"
+#include "input.h"
+#include "workingArray.h"
+
+//this is the loop over the screened excitations of a local energy
+//returns init + sum_i term(i, scratch) over the excitations in work, with sampling.excitationThreads
+//the terms are evaluated over openmp threads, each with its own scratch working array for terms that
+//generate excitations themselves (lanczos, scpt)
+//the terms are always added up in the order of the excitations, so the result does not depend on the
+//number of threads, nested calls (threaded chains, or the inner local energy of a lanczos term) run serially
+template<typename Term>
+double sumOverExcitations(workingArray& work, double init, workingArray& scratch, Term term)
+{
+  double sum = init;
+  if (!schd.excitationThreads || work.nExcitations < 2 || omp_in_parallel()) {
+    for (int i = 0; i < work.nExcitations; i++) sum += term(i, scratch);
+    return sum;
+  }
+
+  // the terms of the calling thread, shared with the team
+  static thread_local std::vector<double> threadTerms;
+  std::vector<double>& terms = threadTerms;
+  terms.resize(work.nExcitations);
+#pragma omp parallel
+  {
+    workingArray& threadScratch = threadWorkingArray();
+#pragma omp for schedule(dynamic, 16)
+    for (int i = 0; i < work.nExcitations; i++) terms[i] = term(i, threadScratch);
+  }
+  for (int i = 0; i < work.nExcitations; i++) sum += terms[i];
+  return sum;
+}
+
+//for terms that only need the excitation index
+template<typename Term>
+double sumOverExcitations(workingArray& work, double init, Term term)
+{
+  return sumOverExcitations(work, init, work, [&](int i, workingArray&) { return term(i); });
+}
+
+#endif
@@ -19,21 +19,32 @@
 #ifndef workingArray_HEADER_H
 #define workingArray_HEADER_H
 #include <vector>
+#include <algorithm>
+#include "Determinants.h"
 
+//the hij elements are stored in single precision when compiled with -DSingleHij (SINGLE_HIJ=yes),
+//this halves the footprint of the excitation loop at the cost of ~1e-7 relative error in the local energy
+#ifdef SingleHij
+typedef float HijType;
+#else
+typedef double HijType;
+#endif
 
 //this is a simple class that just stores the set of 
 //overlaps and hij matix elements whenever local energy is
 //calculated
+//the excitations I*2*norbs+A are kept as 32 bit words, and the arrays start at a bound on the number of
+//screened singles and doubles (capped) and double when full
 struct workingArray {
 
   std::vector<double> ovlpRatio;
-  std::vector<size_t> excitation1;
-  std::vector<size_t> excitation2;
-  std::vector<double> HijElement;
+  std::vector<unsigned int> excitation1;
+  std::vector<unsigned int> excitation2;
+  std::vector<HijType> HijElement;
   double locNorm;   // adding this for multiSlater sampling, this is bad jailbreaking, needs to be changed 
   int nExcitations;
 
-  workingArray(size_t initialSize = 1000000) {
+  workingArray(size_t initialSize = defaultSize()) {
     nExcitations = 0;
     locNorm = 1.0;
     ovlpRatio.resize(initialSize);
@@ -42,6 +53,13 @@ struct workingArray {
     HijElement.resize(initialSize);
   }
 
+  //bound on the screened singles and doubles, from the heat bath integrals above sampling.epsilon
+  static size_t defaultSize() {
+    size_t bound = screenedExcitationBound();
+    if (bound == 0) return 1024;
+    return std::max<size_t>(1024, std::min<size_t>(bound, 65536));
+  }
+
   void incrementSize(size_t size) {
     size_t newSize = ovlpRatio.size()+size;
     ovlpRatio.resize(newSize);
@@ -53,7 +71,7 @@ struct workingArray {
   void appendValue(double ovlp, size_t ex1, size_t ex2, double hij) {
     int ovlpsize = ovlpRatio.size();
     if (ovlpsize <= nExcitations) 
-      incrementSize(1000000);
+      incrementSize(std::max<size_t>(ovlpsize, 1024));
 
     ovlpRatio[nExcitations] = ovlp;
     excitation1[nExcitations] = ex1;
@@ -76,5 +94,13 @@ struct workingArray {
   }
 };
 
+//scratch working array of the calling thread, reused by every call on that thread instead of
+//allocating one per call (threaded excitation sums, chains)
+inline workingArray& threadWorkingArray()
+{
+  static thread_local workingArray work;
+  return work;
+}
+
 
 #endif
@@ -63,7 +63,15 @@ int main(int argc, char *argv[])
   //double ecore;
   //readIntegralsCholeskyAndInitializeDeterminantStaticVariables(schd.integralsFile, norbs, nalpha, nbeta, ecore, h1, h1Mod, chol);
  
-  Hamiltonian ham = Hamiltonian(schd.integralsFile, schd.soc, schd.intType);
+  if (schd.thc && (!schd.phaseless || schd.leftWave != "rhf")) {
+    if (commrank == 0) cout << "THC integrals are only supported in phaseless AFQMC with an rhf left state\n";
+    exit(0);
+  }
+  if (schd.cholStorage != "full" && schd.leftWave == "ksghf" && schd.optimizeOrbs) {
+    if (commrank == 0) cout << "Orbital optimization needs the full cholesky storage\n";
+    exit(0);
+  }
+  Hamiltonian ham = Hamiltonian(schd.integralsFile, schd.soc, schd.intType, schd.thc, schd.cholStorage);
   if (commrank == 0) {
     if (schd.soc || schd.intType == "g") afqmcFile << "# Number of orbitals:  " << ham.norbs << ", nelec:  " << ham.nelec << endl;
     else afqmcFile << "# Number of orbitals:  " << ham.norbs << ", nalpha:  " << ham.nalpha << ", nbeta:  " << ham.nbeta << endl;
@@ -182,7 +190,8 @@ int main(int argc, char *argv[])
   if (schd.phaseless) {
     Wavefunction *waveGuide;
     waveGuide = new RHF(ham, false); 
-    calcMixedEstimatorLongProp(*waveLeft, *waveRight, *waveGuide, walker, ham);
+    if (schd.dtSubsteps.size() > 1) calcMixedEstimatorLongPropDt(*waveLeft, *waveRight, walker, ham);
+    else calcMixedEstimatorLongProp(*waveLeft, *waveRight, *waveGuide, walker, ham);
   }
   else {
     if (schd.dt == 0.) calcMixedEstimatorNoProp(*waveLeft, *waveRight, walker, ham);
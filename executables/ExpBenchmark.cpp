@@ -0,0 +1,50 @@
+// microbenchmark of the propagator exponential methods in DQMC/PropagatorExp
+// usage: ExpBenchmark [norbs] [nelec] [norm] [repeats]
+// prop is a random anti-hermitian matrix (like sqrt(dt) * VHS) with 1-norm norm
+#include <iostream>
+#include <chrono>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <boost/format.hpp>
+#include <unsupported/Eigen/MatrixFunctions>
+#include "PropagatorExp.h"
+
+using namespace std;
+using namespace Eigen;
+
+int main(int argc, char *argv[])
+{
+  int norbs = argc > 1 ? atoi(argv[1]) : 100;
+  int nelec = argc > 2 ? atoi(argv[2]) : 20;
+  double norm = argc > 3 ? atof(argv[3]) : 0.5;
+  int repeats = argc > 4 ? atoi(argv[4]) : 100;
+
+  srand(1);
+  MatrixXcd herm = MatrixXcd::Random(norbs, norbs);
+  herm = (herm + herm.adjoint()).eval();
+  MatrixXcd prop = complex<double>(0., 1.) * herm;
+  prop *= norm / prop.cwiseAbs().colwise().sum().maxCoeff();
+  MatrixXcd det = MatrixXcd::Random(norbs, nelec);
+  MatrixXcd exact = prop.exp() * det;
+
+  vector<string> names = {"taylor 5", "taylor 9", "adaptive 1e-6", "adaptive 1e-10", "scaled 1e-10"};
+  vector<PropagatorExp> methods = {PropagatorExp("taylor", 5), PropagatorExp("taylor", 9), PropagatorExp("adaptive", -1, 1.e-6),
+                                   PropagatorExp("adaptive", -1, 1.e-10), PropagatorExp("scaled", -1, 1.e-10)};
+
+  cout << boost::format("norbs %d, nelec %d, |prop|_1 %.3e, %d repeats\n") % norbs % nelec % norm % repeats;
+  cout << boost::format("%-16s %12s %10s %14s\n") % "method" % "time (ms)" % "terms" % "rel. error";
+  for (int m = 0; m < methods.size(); m++) {
+    MatrixXcd result;
+    long nterms = 0;
+    auto init = chrono::steady_clock::now();
+    for (int n = 0; n < repeats; n++) {
+      result = det;
+      nterms += methods[m].apply(prop, result);
+    }
+    double time = chrono::duration<double, milli>(chrono::steady_clock::now() - init).count() / repeats;
+    double error = (result - exact).norm() / exact.norm();
+    cout << boost::format("%-16s %12.4f %10.2f %14.3e\n") % names[m] % time % (double(nterms) / repeats) % error;
+  }
+  return 0;
+}
@@ -1097,6 +1097,34 @@ def write_dqmc_uihf(hcore, hcore_mod, chol, nelec, nmo, enuc, ms=0,
         fh5['chol_dn'] = chol[1].flatten()
         fh5['energy_core'] = enuc
 
+# write thc integrals, (pq|rs) = sum_PQ orbs[P, p] orbs[P, q] V[P, Q] orbs[Q, r] orbs[Q, s]
+def write_dqmc_thc(hcore, orbs, V, nelec, nmo, enuc, ms=0,
+                        filename='FCIDUMP_thc'):
+    assert orbs.shape == (V.shape[0], nmo)
+    with h5py.File(filename, 'w') as fh5:
+        fh5['header'] = np.array([nelec, nmo, ms, V.shape[0]])
+        fh5['hcore'] = hcore.flatten()
+        fh5['thc_orbs'] = orbs.flatten()
+        fh5['thc_V'] = V.flatten()
+        fh5['energy_core'] = enuc
+
+# exact thc factors from cholesky vectors (nchol x nmo^2) by diagonalizing each vector
+# nthc = nchol * nmo, mainly useful for testing
+def thc_from_chol(chol, nmo, tol=1.e-12):
+    orbs, evals = [ ], [ ]
+    for L in chol:
+        e, v = np.linalg.eigh(L.reshape(nmo, nmo))
+        kept = np.abs(e) > tol
+        orbs.append(v[:, kept].T)
+        evals.append(e[kept])
+    orbs = np.vstack(orbs)
+    V = np.zeros((orbs.shape[0], orbs.shape[0]))
+    start = 0
+    for e in evals:
+        V[start:start+e.size, start:start+e.size] = np.outer(e, e)
+        start += e.size
+    return orbs, V
+
 # reads rdm files and calculates one-body observables and stochastic error
 def calculate_observables(observables, constants = None, prefix = './'):
   # nobs is the number of observables
@@ -1197,7 +1225,7 @@ def write_uccsd(singles, doubles, rotation=None, filename='uccsd.h5'):
     fh5['rotation'] = rotation.flatten()
 
 
-def write_afqmc_input(numAct = None, numCore = None, soc = None, intType = None, left = "rhf", right = "rhf", ndets = 100, detFile = 'dets.bin', excitationLevel = None, seed = None, dt = 0.005, nsteps = 50, nwalk = 50, stochasticIter = 500, orthoSteps = 20, burnIter = None, choleskyThreshold = 2.0e-3, weightCap = None, writeOneRDM = False, scratchDir = None, fname = 'afqmc.json'):
+def write_afqmc_input(numAct = None, numCore = None, soc = None, intType = None, thc = None, left = "rhf", right = "rhf", ndets = 100, detFile = 'dets.bin', excitationLevel = None, seed = None, dt = 0.005, nsteps = 50, nwalk = 50, stochasticIter = 500, orthoSteps = 20, burnIter = None, choleskyThreshold = 2.0e-3, weightCap = None, writeOneRDM = False, scratchDir = None, fname = 'afqmc.json'):
   system = { }
   system["integrals"] = "FCIDUMP_chol"
   if numAct is not None:
@@ -1208,6 +1236,9 @@ def write_afqmc_input(numAct = None, numCore = None, soc = None, intType = None,
     system["soc"] = soc
   if intType is not None:
     system["intType"] = intType
+  if thc:
+    system["integrals"] = "FCIDUMP_thc"
+    system["thc"] = True
 
   wavefunction = { }
   wavefunction["left"] = f"{left}"
@@ -6,6 +6,7 @@ find . -name BestDeterminant.txt|xargs rm >/dev/null 2>&1
 find . -name amsgrad.bkp |xargs rm >/dev/null 2>&1
 find . -name cpsslaterwave.bkp|xargs rm >/dev/null 2>&1
 find . -name vmc.out | xargs rm >/dev/null 2>&1
+find . -name vmc_cg.out | xargs rm >/dev/null 2>&1
 find . -name gfmc.out | xargs rm >/dev/null 2>&1
 find . -name ci.out | xargs rm >/dev/null 2>&1
 find . -name nevpt.out | xargs rm >/dev/null 2>&1
@@ -19,3 +20,7 @@ find . -name afqmc.out | xargs rm >/dev/null 2>&1
 find . -name afqmc.dat | xargs rm >/dev/null 2>&1
 find . -name blocking.tmp | xargs rm >/dev/null 2>&1
 find . -name blocking.out | xargs rm >/dev/null 2>&1
+find . -name "blocking_dt*.tmp" | xargs rm >/dev/null 2>&1
+find . -name dets.ci | xargs rm >/dev/null 2>&1
+find . -name "rdm_*.dat" | xargs rm >/dev/null 2>&1
+find . -name "afqmc_checkpoint*" | xargs rm >/dev/null 2>&1
@@ -69,6 +69,16 @@ then
     ../../clean.sh
 fi
 
+cd $here/DQMC/multislater_uhf_compact
+../../clean.sh
+printf "...running DQMC/multislater_uhf_compact\n"
+$MPICOMMAND $DQMCPATH > afqmc.out
+python2 ../../testEnergy.py 'afqmc' $tol
+if [ $clean == 1 ]
+then
+    ../../clean.sh
+fi
+
 cd $here/DQMC/ghf_ghf_soc
 ../../clean.sh
 printf "...running DQMC/ghf_ghf_soc\n"
@@ -119,4 +129,97 @@ then
     ../../clean.sh
 fi
 
+cd $here/DQMC/uhf_uhf_ui_batch
+../../clean.sh
+printf "...running DQMC/uhf_uhf_ui_batch\n"
+$MPICOMMAND $DQMCPATH > afqmc.out
+python2 ../../testEnergy.py 'afqmc' $tol
+if [ $clean == 1 ]
+then
+    ../../clean.sh
+fi
+
+cd $here/DQMC/rhf_rhf_threads
+../../clean.sh
+printf "...running DQMC/rhf_rhf_threads\n"
+$MPICOMMAND $DQMCPATH > afqmc.out
+python2 ../../testEnergy.py 'afqmc' $tol
+if [ $clean == 1 ]
+then
+    ../../clean.sh
+fi
+
+cd $here/DQMC/rhf_rhf_thc
+../../clean.sh
+printf "...running DQMC/rhf_rhf_thc\n"
+$MPICOMMAND $DQMCPATH > afqmc.out
+python2 ../../testEnergy.py 'afqmc' $tol
+if [ $clean == 1 ]
+then
+    ../../clean.sh
+fi
+
+cd $here/DQMC/multislater_rhf_packed
+../../clean.sh
+printf "...running DQMC/multislater_rhf_packed\n"
+$MPICOMMAND $DQMCPATH > afqmc.out
+python2 ../../testEnergy.py 'afqmc' $tol
+if [ $clean == 1 ]
+then
+    ../../clean.sh
+fi
+
+cd $here/DQMC/uhf_uhf_ortho
+../../clean.sh
+printf "...running DQMC/uhf_uhf_ortho\n"
+$MPICOMMAND $DQMCPATH > afqmc.out
+python2 ../../testEnergy.py 'afqmc' $tol
+if [ $clean == 1 ]
+then
+    ../../clean.sh
+fi
+
+cd $here/DQMC/uhf_uhf_mgs
+../../clean.sh
+printf "...running DQMC/uhf_uhf_mgs\n"
+$MPICOMMAND $DQMCPATH > afqmc.out
+python2 ../../testEnergy.py 'afqmc' $tol
+if [ $clean == 1 ]
+then
+    ../../clean.sh
+fi
+
+cd $here/DQMC/rhf_rhf_dt
+../../clean.sh
+printf "...running DQMC/rhf_rhf_dt\n"
+$MPICOMMAND $DQMCPATH > afqmc.out
+python2 ../../testEnergy.py 'afqmc' $tol
+python2 ../../testEnergy.py 'dt' $tol
+if [ $clean == 1 ]
+then
+    ../../clean.sh
+fi
+
+cd $here/DQMC/rhf_rhf_restart
+../../clean.sh
+printf "...running DQMC/rhf_rhf_restart\n"
+$MPICOMMAND ../../../bin/DQMC afqmc_part.json > afqmc.out
+$MPICOMMAND $DQMCPATH > afqmc.out
+python2 ../../testEnergy.py 'afqmc' $tol
+if [ $clean == 1 ]
+then
+    ../../clean.sh
+fi
+
+cd $here/DQMC/uhf_uhf_bp
+../../clean.sh
+printf "...running DQMC/uhf_uhf_bp\n"
+$MPICOMMAND $DQMCPATH > afqmc.out
+python2 ../../testEnergy.py 'afqmc' $tol
+python2 ../../testEnergy.py 'bp' $tol 9
+if [ $clean == 1 ]
+then
+    ../../clean.sh
+fi
+
 cd $here
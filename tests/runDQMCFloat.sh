@@ -0,0 +1,27 @@
+#!/bin/bash
+
+# compares single precision propagation (sampling.floatProp) against the
+# double precision references of the phaseless AFQMC tests
+
+printf "\n\nComparing single and double precision AFQMC propagation\n"
+printf "======================================================\n"
+
+MPICOMMAND="mpirun -np 4"
+DQMCPATH="../../../bin/DQMC afqmc_float.json"
+here=`pwd`
+
+printf "%-22s %18s %18s %12s\n" "test" "double" "single" "difference"
+for test in rhf_rhf rhf_uhf uhf_rhf uhf_uhf multislater_rhf multislater_uhf ghf_ghf_soc uhf_uhf_ui multislater_uhf_ui ghf_ghf_gi multislater_ghf_gi
+do
+    cd $here/DQMC/$test
+    ../../clean.sh
+    python -c "import json; d = json.load(open('afqmc.json')); d['sampling']['floatProp'] = True; json.dump(d, open('afqmc_float.json', 'w'), indent=2)"
+    $MPICOMMAND $DQMCPATH > afqmc.out
+    eRef=`tail -n 1 samples.ref | awk '{print $2}'`
+    eTest=`tail -n 1 samples.dat | awk '{print $2}'`
+    awk -v t=$test -v a=$eRef -v b=$eTest 'BEGIN { printf "%-22s %18s %18s %12.3e\n", t, a, b, b - a }'
+    rm -f afqmc_float.json
+    ../../clean.sh
+done
+
+cd $here
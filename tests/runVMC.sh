@@ -22,6 +22,16 @@ then
     ../clean.sh
 fi
 
+cd $here/hubbard_1x10_chains
+../clean.sh
+printf "...running hubbard_1x10 chains\n"
+OMP_NUM_THREADS=2 $MPICOMMAND $VMCPATH > vmc.out
+python2 ../testEnergy.py 'vmc' $tol
+if [ $clean == 1 ]
+then
+    ../clean.sh
+fi
+
 cd $here/hubbard_1x10ghf
 ../clean.sh
 printf "...running hubbard_1x10 ghf\n"
@@ -155,4 +165,28 @@ then
     ../clean.sh
 fi
 
+cd $here/c2_threads/
+../clean.sh
+printf "...running c2 threads\n"
+OMP_NUM_THREADS=2 mpirun -np 2 $VMCPATH > vmc.out
+python2 ../testEnergy.py 'vmc' $tol
+if [ $clean == 1 ]
+then
+    ../clean.sh
+fi
+
+cd $here/c2_minsr/
+../clean.sh
+printf "...running c2 minsr\n"
+$MPICOMMAND $VMCPATH > vmc.out
+python2 ../testEnergy.py 'vmc' $tol
+../clean.sh
+printf "...running c2 minsr, conjugate gradient on the same samples\n"
+$MPICOMMAND ../../bin/VMC vmc_cg.json > vmc_cg.out
+python2 ../testEnergy.py 'vmc' $tol vmc_cg
+if [ $clean == 1 ]
+then
+    ../clean.sh
+fi
+
 cd $here
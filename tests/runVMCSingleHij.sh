@@ -0,0 +1,25 @@
+#!/bin/bash
+
+# compares a VMC build with single precision hij elements (make SINGLE_HIJ=yes)
+# against the double precision references of the VMC tests, build first with
+#   make clean && make bin/VMC SINGLE_HIJ=yes
+
+printf "\n\nComparing single and double precision hij elements in VMC\n"
+printf "======================================================\n"
+
+MPICOMMAND="mpirun -np 4"
+VMCPATH="../../bin/VMC vmc.json"
+here=`pwd`
+tol=1.0e-5
+
+for test in hubbard_1x10 hubbard_1x14 hubbard_1x6 c2
+do
+    cd $here/$test
+    ../clean.sh
+    printf "...running $test\n"
+    $MPICOMMAND $VMCPATH > vmc.out
+    python2 ../testEnergy.py 'vmc' $tol
+    ../clean.sh
+done
+
+cd $here
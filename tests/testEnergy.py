@@ -65,12 +65,14 @@ if __name__ == '__main__':
     tol = float(sys.argv[2])
 
     if mc == 'vmc' or mc == 'gfmc' or mc == 'ci':
-        fh = open(mc+'.ref', 'r')
+        # optional name of the .ref/.out pair, defaults to mc
+        name = sys.argv[3] if len(sys.argv) > 3 else mc
+        fh = open(name+'.ref', 'r')
         for line in fh:
             pass
         eRef = float(line.split()[1])
 
-        fh = open(mc+'.out', 'r')
+        fh = open(name+'.out', 'r')
         for line in fh:
             pass
         eTest = float(line.split()[1])
@@ -92,6 +94,45 @@ if __name__ == '__main__':
 
         check_results_afqmc(eRef, eTest, wRef, wTest, tol)
 
+    elif mc == 'bp':
+        # back propagated spin summed rdm: elementwise against the reference, trace against nelec
+        nelec = float(sys.argv[3])
+        ref = [[float(x) for x in line.split()] for line in open('rdm_bp.ref', 'r')]
+        test = [[float(x) for x in line.split()] for line in open('rdm_bp_0.dat', 'r')]
+        maxDiff = 0.
+        trace = 0.
+        for i in range(1, len(ref)):
+            trace += test[i][i-1]
+            for j in range(len(ref[i])):
+                maxDiff = max(maxDiff, abs(ref[i][j] - test[i][j]))
+
+        # rdm files are written at default stream precision
+        if (maxDiff < tol and abs(trace - nelec) < 1.e-4):
+            print("bp test passed")
+        else:
+            print("bp test failed")
+            print("maxDiff = ", maxDiff)
+            print("trace = ", trace)
+            print("nelec = ", nelec)
+
+    elif mc == 'dt':
+        # dt -> 0 extrapolated energy and its blocking error, the error must have plateaued
+        def extrapolated(name):
+            for line in open(name, 'r'):
+                if line.split()[:2] == ['#', '0']:
+                    return float(line.split()[2]), float(line.split()[3])
+            return 0., -1.
+
+        eRef, errRef = extrapolated('afqmc.ref')
+        eTest, errTest = extrapolated('afqmc.dat')
+
+        if (abs(eRef - eTest) < tol and abs(errRef - errTest) < tol and errTest > 0.):
+            print("dt test passed")
+        else:
+            print("dt test failed")
+            print("eRef = ", eRef, " errRef = ", errRef)
+            print("eTest = ", eTest, " errTest = ", errTest)
+
     elif mc == 'nevpt' or mc == 'nevpt_print' or mc == 'nevpt_read':
         fh = open(mc+'.ref', 'r')
         for line in fh:
@@ -35,6 +35,53 @@ BigDeterminant::BigDeterminant(const Determinant& d) {
     if (d.getocc(i)) occupation[i] = 1;
 }
 
+double DiagonalEnergy::get(const Determinant& d, const oneInt& I1, const twoInt& I2, const double& coreE)
+{
+  if (schd.diagonalRebuild <= 0) return d.Energy(I1, I2, coreE);
+  if (nmoves < 0 || nmoves >= schd.diagonalRebuild || !(d == det)) rebuild(d, I1, I2);
+  return energy + coreE;
+}
+
+void DiagonalEnergy::excite(const Determinant& d, int i, int a, bool sz, const twoInt& I2)
+{
+  if (nmoves < 0) return;
+  if (!(d == det)) {
+    nmoves = -1;
+    return;
+  }
+  energy += fock[sz][a] - fock[sz][i] - I2.Direct(i, a) + I2.Exchange(i, a);
+  fock[0] += I2.Direct.col(a) - I2.Direct.col(i);
+  fock[1] += I2.Direct.col(a) - I2.Direct.col(i);
+  fock[sz] -= I2.Exchange.col(a) - I2.Exchange.col(i);
+  det.setocc(i, sz, false);
+  det.setocc(a, sz, true);
+  nmoves++;
+}
+
+void DiagonalEnergy::rebuild(const Determinant& d, const oneInt& I1, const twoInt& I2)
+{
+  int norbs = Determinant::norbs;
+  det = d;
+  energy = d.Energy(I1, I2, 0.0);
+  for (int sz = 0; sz < 2; sz++) {
+    fock[sz].resize(norbs);
+    for (int p = 0; p < norbs; p++)
+#ifdef Complex
+      fock[sz][p] = I1(2*p+sz, 2*p+sz).real();
+#else
+      fock[sz][p] = I1(2*p+sz, 2*p+sz);
+#endif
+  }
+  vector<int> closed;
+  d.getClosed(closed);
+  for (int j = 0; j < closed.size(); j++) {
+    fock[0] += I2.Direct.col(closed[j]/2);
+    fock[1] += I2.Direct.col(closed[j]/2);
+    fock[closed[j]%2] -= I2.Exchange.col(closed[j]/2);
+  }
+  nmoves = 0;
+}
+
 const char& BigDeterminant::operator[] (int j) const
 {
   return occupation[j];
@@ -1012,6 +1059,33 @@ void generateAllScreenedSingleExcitation(const Determinant& d,
 
 }
 
+//every occupied pair is counted with the largest number of doubles above the threshold of any
+//orbital pair, the occupations of the virtuals are ignored
+size_t screenedExcitationBound() {
+  if (I2hb.startingIndicesSameSpin == nullptr) return 0;
+  static size_t bound = [] {
+    size_t norbs = Determinant::norbs, nalpha = Determinant::nalpha, nbeta = Determinant::nbeta;
+    size_t maxSame = 0, maxOpposite = 0;
+    for (int X = 0; X < norbs; X++) {
+      for (int Y = 0; Y <= X; Y++) {
+        for (int sameSpin = 0; sameSpin < 2; sameSpin++) {
+          if (sameSpin && X == Y) continue;
+          const float *integrals; const short* orbIndices;
+          size_t numIntegrals;
+          I2hb.getIntegralArray(2 * X, 2 * Y + 1 - sameSpin, integrals, orbIndices, numIntegrals);
+          size_t numLargeIntegrals = std::lower_bound(integrals, integrals + numIntegrals, schd.epsilon, [](const float &x, float val){ return fabs(x) > val; }) - integrals;
+          if (sameSpin) maxSame = max(maxSame, numLargeIntegrals);
+          else maxOpposite = max(maxOpposite, numLargeIntegrals);
+        }
+      }
+    }
+    size_t singles = nalpha * (norbs - nalpha) + nbeta * (norbs - nbeta);
+    size_t samePairs = nalpha * (nalpha - 1) / 2 + nbeta * (nbeta - 1) / 2;
+    return singles + samePairs * maxSame + nalpha * nbeta * maxOpposite;
+  }();
+  return bound;
+}
+
 void generateAllScreenedDoubleExcitation(const Determinant& d,
                                          const double& THRESH,
                                          const double& TINY,
@@ -22,6 +22,7 @@
 #include "global.h"
 #include <iostream>
 #include <vector>
+#include <array>
 #include <boost/serialization/serialization.hpp>
 #include <boost/functional/hash.hpp>
 #include <Eigen/Dense>
@@ -206,6 +207,29 @@ class BigDeterminant {
   char& operator[] (int j) ;
 };
 
+//diagonal energy <d|H|d> of a walker, kept up to date over the moves of the walker instead of being
+//recomputed from scratch in O(nelec^2) for every local energy
+//fock[sz][p] = I1(p,p) + sum_{j occ} Direct(p,j) - sum_{j occ, spin sz} Exchange(p,j), so moving an electron
+//from i to a changes the energy by fock[sz][a] - fock[sz][i] - Direct(i,a) + Exchange(i,a), and the
+//intermediates by O(norbs). they are rebuilt every schd.diagonalRebuild moves to bound the roundoff drift
+class DiagonalEnergy {
+ public:
+  Determinant det;                    //the determinant the energy and intermediates belong to
+  double energy;                      //<det|H|det> without the core energy
+  std::array<Eigen::VectorXd, 2> fock;
+  int nmoves;                         //moves since the last rebuild, -1 if nothing is tracked
+
+  DiagonalEnergy() : nmoves(-1) {};
+
+  //energy of d, rebuilt if d is not the tracked determinant
+  double get(const Determinant& d, const oneInt& I1, const twoInt& I2, const double& coreE);
+
+  //d is about to move its electron i -> a with spin sz, d has to be the tracked determinant
+  void excite(const Determinant& d, int i, int a, bool sz, const twoInt& I2);
+
+  void rebuild(const Determinant& d, const oneInt& I1, const twoInt& I2);
+};
+
 
 //note some of i, j, k, l might be repeats
 //and some its possible that the determinant might get killed
@@ -241,6 +265,10 @@ void generateAllScreenedDoubleExcitation(const Determinant& det,
                                          workingArray& work,
                                          bool doparity = false);
 
+//upper bound on the number of excitations above the sampling.epsilon screening out of any determinant,
+//0 before the heat bath integrals are read
+size_t screenedExcitationBound();
+
 //---Generate all screened excitations in the FOIS---------------
 
 void generateAllScreenedDoubleExcitationsFOIS(const Determinant& det,
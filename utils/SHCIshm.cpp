@@ -1,6 +1,7 @@
 #include "SHCIshm.h"
 #include <boost/interprocess/managed_shared_memory.hpp>
 #include <vector>
+#include <fstream>
 #ifndef SERIAL
 #include <boost/mpi/environment.hpp>
 #include <boost/mpi/communicator.hpp>
@@ -94,63 +95,190 @@ void removeSHM(){
   boost::interprocess::shared_memory_object::remove(cholSHMNameDn.c_str());
   boost::interprocess::shared_memory_object::remove(floatCholSHMName.c_str());
   boost::interprocess::shared_memory_object::remove(rotCholSHMName.c_str());
+  for (int i = 0; i < ciSHMNames.size(); i++)
+    boost::interprocess::shared_memory_object::remove(ciSHMNames[i].c_str());
 }
 
 
+// node leader ingest: the blocks are split evenly between the node leaders, leader i owns [slabStart(i), slabStart(i + 1))
+static size_t slabStart(size_t nblocks, int nleaders, int leader)
+{
+  return (nblocks * leader) / nleaders;
+}
+
+
+// exchanges the slabs between node leaders, one nonblocking broadcast per slab all in flight at once
+// called by the node leaders only, blockType is a contiguous type of one block
+static void exchangeSlabs(char* data, size_t nblocks, size_t blockBytes, MPI_Datatype blockType)
+{
+  int nleaders, leader;
+  MPI_Comm_size(shmcomm, &nleaders);
+  MPI_Comm_rank(shmcomm, &leader);
+  std::vector<MPI_Request> requests(nleaders);
+  for (int i = 0; i < nleaders; i++) {
+    size_t start = slabStart(nblocks, nleaders, i);
+    int count = slabStart(nblocks, nleaders, i + 1) - start;
+    MPI_Ibcast(data + start * blockBytes, count, blockType, i, shmcomm, &requests[i]);
+  }
+  MPI_Waitall(nleaders, requests.data(), MPI_STATUSES_IGNORE);
+}
+
+
+// startup timing breakdown, maximum over the node leaders
+static void printIngestTimes(std::string name, double readTime, double commTime, size_t totalMemory)
+{
+  double times[2] = {readTime, commTime}, maxTimes[2] = {0., 0.};
+  MPI_Reduce(times, maxTimes, 2, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+  if (commrank == 0) {
+    std::ofstream afqmcFile("afqmc.dat", std::ios::app);
+    afqmcFile << "# " << name << " ingest (" << totalMemory / 1.e9 << " GB): read " << maxTimes[0] << " s, node exchange " << maxTimes[1] << " s\n";
+    afqmcFile.close();
+  }
+}
+
+
+// each node leader reads its own hyperslab of the dataset straight into the node's shared segment,
+// the slabs are then exchanged between node leaders
 void readHDF5ToSHM(hid_t file, std::string datasetName, size_t size, double* &SHMAddress, std::string SHMName, 
 		    boost::interprocess::shared_memory_object& SHMSegment,
-		    boost::interprocess::mapped_region& SHMRegion) 
+		    boost::interprocess::mapped_region& SHMRegion, size_t blockSize) 
 {
   boost::interprocess::shared_memory_object::remove(SHMName.c_str());
-  int comm_rank, comm_size;
-  MPI_Comm_rank(MPI_COMM_WORLD, &comm_rank);
-  MPI_Comm_size(MPI_COMM_WORLD, &comm_size);
- 
   size_t totalMemory = size * sizeof(double);
+  if (size % blockSize != 0) blockSize = 1;
+  size_t nblocks = size / blockSize;
+  double readTime = 0., commTime = 0.;
   
   MPI_Barrier(MPI_COMM_WORLD);
   
   SHMSegment.truncate(totalMemory);
   SHMRegion = boost::interprocess::mapped_region{SHMSegment, boost::interprocess::read_write};
-  if (comm_rank == 0) memset(SHMRegion.get_address(), 0., totalMemory);
   SHMAddress = (double*)(SHMRegion.get_address());
   
   MPI_Barrier(MPI_COMM_WORLD);
   
-  if (comm_rank == 0) { // read dataset into shared memory
-    double* data = new double[size];
-    for (size_t i = 0; i < size; i++) data[i] = 0.;
+  if (localrank == 0) { // read own slab into shared memory
+    double initTime = getTime();
+    int nleaders, leader;
+    MPI_Comm_size(shmcomm, &nleaders);
+    MPI_Comm_rank(shmcomm, &leader);
+    hsize_t offset[1] = {slabStart(nblocks, nleaders, leader) * blockSize};
+    hsize_t count[1] = {slabStart(nblocks, nleaders, leader + 1) * blockSize - offset[0]};
     
     hid_t dataset = (-1);
-    herr_t status;
     H5E_BEGIN_TRY {
       dataset = H5Dopen(file, datasetName.c_str(), H5P_DEFAULT);
-      status = H5Dread(dataset, H5T_NATIVE_DOUBLE, H5S_ALL, H5S_ALL, H5P_DEFAULT, data);
     } H5E_END_TRY
     if (dataset < 0) {
       if (commrank == 0) std::cout << datasetName << " dataset could not be read." << std::endl;
       exit(1);
     }
+    if (count[0] > 0) {
+      hid_t dataspace = H5Dget_space(dataset);
+      hid_t memspace = H5Screate_simple(1, count, NULL);
+      H5Sselect_hyperslab(dataspace, H5S_SELECT_SET, offset, NULL, count, NULL);
+      H5Dread(dataset, H5T_NATIVE_DOUBLE, memspace, dataspace, H5P_DEFAULT, SHMAddress + offset[0]);
+      H5Sclose(memspace);
+      H5Sclose(dataspace);
+    }
+    H5Dclose(dataset);
+    readTime = getTime() - initTime;
     
-    for (size_t i = 0; i < size; i++) SHMAddress[i] = data[i];
-    delete [] data;
+    initTime = getTime();
+    MPI_Datatype blockType;
+    MPI_Type_contiguous(blockSize, MPI_DOUBLE, &blockType);
+    MPI_Type_commit(&blockType);
+    exchangeSlabs(reinterpret_cast<char*>(SHMAddress), nblocks, blockSize * sizeof(double), blockType);
+    MPI_Type_free(&blockType);
+    commTime = getTime() - initTime;
   }
   
+  MPI_Barrier(MPI_COMM_WORLD);
+  printIngestTimes(datasetName, readTime, commTime, totalMemory);
+}
+
+
+// the matrices of all datasets are split between the node leaders, each reads and packs its own matrices
+template <typename T> static void readHDF5ToSHMPackedT(hid_t file, std::vector<std::string>& datasetNames, size_t nmat, size_t n, T* &SHMAddress, std::string SHMName, 
+		    boost::interprocess::shared_memory_object& SHMSegment,
+		    boost::interprocess::mapped_region& SHMRegion) 
+{
+  boost::interprocess::shared_memory_object::remove(SHMName.c_str());
+  size_t triSize = (n * (n + 1)) / 2;
+  size_t nblocks = datasetNames.size() * nmat;
+  size_t totalMemory = nblocks * triSize * sizeof(T);
+  double readTime = 0., commTime = 0.;
+  
   MPI_Barrier(MPI_COMM_WORLD);
   
-  if (localrank == 0) { // send to all nodes
-    long intdim = totalMemory;
-    long maxint = 26843540; // mpi cannot transfer more than these number of doubles; probably should not be hand-coded
-    long maxIter = intdim / maxint;
-    MPI_Barrier(shmcomm);
-    
-    char* shrdMem = static_cast<char*>(SHMRegion.get_address());
-    for (int i = 0; i < maxIter; i++) {
-      MPI_Bcast(shrdMem + i*maxint, maxint, MPI_CHAR, 0, shmcomm);
-      MPI_Barrier(shmcomm);
+  SHMSegment.truncate(totalMemory);
+  SHMRegion = boost::interprocess::mapped_region{SHMSegment, boost::interprocess::read_write};
+  SHMAddress = (T*)(SHMRegion.get_address());
+  
+  MPI_Barrier(MPI_COMM_WORLD);
+  
+  if (localrank == 0) { // read own matrices one at a time and pack into shared memory
+    double initTime = getTime();
+    int nleaders, leader;
+    MPI_Comm_size(shmcomm, &nleaders);
+    MPI_Comm_rank(shmcomm, &leader);
+    size_t start = slabStart(nblocks, nleaders, leader), end = slabStart(nblocks, nleaders, leader + 1);
+    std::vector<double> data(n * n, 0.);
+    hsize_t count[1] = {n * n};
+    hsize_t offset[1] = {0};
+    hid_t memspace = H5Screate_simple(1, count, NULL);
+    size_t counter = start * triSize;
+    for (int d = 0; d < datasetNames.size(); d++) {
+      if ((d + 1) * nmat <= start || d * nmat >= end) continue;
+      hid_t dataset = (-1);
+      H5E_BEGIN_TRY {
+        dataset = H5Dopen(file, datasetNames[d].c_str(), H5P_DEFAULT);
+      } H5E_END_TRY
+      if (dataset < 0) {
+        std::cout << datasetNames[d] << " dataset could not be read." << std::endl;
+        exit(1);
+      }
+      hid_t dataspace = H5Dget_space(dataset);
+      for (size_t m = max(start, d * nmat) - d * nmat; m < min(end, (d + 1) * nmat) - d * nmat; m++) {
+        offset[0] = m * n * n;
+        H5Sselect_hyperslab(dataspace, H5S_SELECT_SET, offset, NULL, count, NULL);
+        H5Dread(dataset, H5T_NATIVE_DOUBLE, memspace, dataspace, H5P_DEFAULT, data.data());
+        // (i, j) of the column major matrix, same order as Hamiltonian::floattenCholesky
+        for (size_t i = 0; i < n; i++)
+          for (size_t j = 0; j <= i; j++)
+            SHMAddress[counter++] = T(data[j * n + i]);
+      }
+      H5Sclose(dataspace);
+      H5Dclose(dataset);
     }
-    MPI_Bcast(shrdMem + maxIter * maxint, totalMemory - maxIter*maxint, MPI_CHAR, 0, shmcomm);
+    H5Sclose(memspace);
+    readTime = getTime() - initTime;
+    
+    initTime = getTime();
+    MPI_Datatype blockType;
+    MPI_Type_contiguous(triSize, sizeof(T) == sizeof(float) ? MPI_FLOAT : MPI_DOUBLE, &blockType);
+    MPI_Type_commit(&blockType);
+    exchangeSlabs(reinterpret_cast<char*>(SHMAddress), nblocks, triSize * sizeof(T), blockType);
+    MPI_Type_free(&blockType);
+    commTime = getTime() - initTime;
   }
   
   MPI_Barrier(MPI_COMM_WORLD);
+  printIngestTimes(datasetNames[0] + " packed", readTime, commTime, totalMemory);
+}
+
+
+void readHDF5ToSHMPacked(hid_t file, std::vector<std::string> datasetNames, size_t nmat, size_t n, double* &SHMAddress, std::string SHMName, 
+		    boost::interprocess::shared_memory_object& SHMSegment,
+		    boost::interprocess::mapped_region& SHMRegion) 
+{
+  readHDF5ToSHMPackedT(file, datasetNames, nmat, n, SHMAddress, SHMName, SHMSegment, SHMRegion);
+}
+
+
+void readHDF5ToSHMPacked(hid_t file, std::vector<std::string> datasetNames, size_t nmat, size_t n, float* &SHMAddress, std::string SHMName, 
+		    boost::interprocess::shared_memory_object& SHMSegment,
+		    boost::interprocess::mapped_region& SHMRegion) 
+{
+  readHDF5ToSHMPackedT(file, datasetNames, nmat, n, SHMAddress, SHMName, SHMSegment, SHMRegion);
 }
@@ -142,7 +142,18 @@ void SHMVecFromVecs(T *vec, int vecsize, T* &SHMvec, std::string& SHMname,
 }
 
 
+// each node leader reads its own slab (whole blocks of blockSize doubles) of the dataset into shared memory,
+// the slabs are exchanged between node leaders with nonblocking broadcasts
 void readHDF5ToSHM(hid_t file, std::string datasetName, size_t size, double* &SHMAddress, std::string SHMName, 
+		    boost::interprocess::shared_memory_object& SHMSegment,
+		    boost::interprocess::mapped_region& SHMRegion, size_t blockSize = 1); 
+
+// reads nmat square n x n matrices stored one after another in each of the datasets into shared memory,
+// keeping only the packed lower triangle of each in double or float, the full matrices are read one at a time
+void readHDF5ToSHMPacked(hid_t file, std::vector<std::string> datasetNames, size_t nmat, size_t n, double* &SHMAddress, std::string SHMName, 
+		    boost::interprocess::shared_memory_object& SHMSegment,
+		    boost::interprocess::mapped_region& SHMRegion); 
+void readHDF5ToSHMPacked(hid_t file, std::vector<std::string> datasetNames, size_t nmat, size_t n, float* &SHMAddress, std::string SHMName, 
 		    boost::interprocess::shared_memory_object& SHMSegment,
 		    boost::interprocess::mapped_region& SHMRegion); 
 
@@ -76,6 +76,9 @@ extern boost::interprocess::shared_memory_object rotCholSegment;
 extern boost::interprocess::mapped_region rotCholRegion;
 extern std::string rotCholSHMName;
 
+// node shared segments of multi determinant trials read from dice files (CIExpansion)
+extern std::vector<std::string> ciSHMNames;
+
 extern std::mt19937 generator;
 double getTime();
 void   license();
@@ -60,6 +60,8 @@ void readInput(string inputFile, schedule& schd, bool print) {
     // system options
     schd.integralsFile = input.get("system.integrals", "FCIDUMP");
     schd.intType = input.get("system.intType", "r");
+    schd.thc = input.get("system.thc", false);
+    schd.cholStorage = algorithm::to_lower_copy(input.get("system.cholStorage", "full"));
     schd.nciCore = input.get("system.numCore", 0);                  // TODO: rename these because active spaces are also used without ci
     schd.nciAct = input.get("system.numAct", -1);
     schd.soc = input.get("system.soc", false);
@@ -99,6 +101,7 @@ void readInput(string inputFile, schedule& schd, bool print) {
     if (schd.wavefunctionType == "sci") schd.ciCeption = true;
     else schd.ciCeption = false;
     schd.determinantFile = input.get("wavefunction.determinants", ""); //used for both sci and starting det
+    schd.compactDeterminantFile = input.get("wavefunction.compactDeterminants", "");
     schd.detsInCAS = input.get("wavefunction.detsInCAS", true);
     schd.alpha = input.get("wavefunction.alpha", 0.01); //lanczos
     schd.lanczosEpsilon = input.get("wavefunction.lanczosEpsilon", 1.e-8); //lanczos
@@ -122,6 +125,9 @@ void readInput(string inputFile, schedule& schd, bool print) {
     schd.deterministic = input.get("sampling.deterministic", false);
     schd.stochasticIter = input.get("sampling.stochasticIter", 1e4);
     schd.burnIter = input.get("sampling.burnIter", 0);
+    schd.nchains = input.get("sampling.nchains", 1); //stochasticIter steps are made by each chain, threaded with walkerThreads
+    schd.excitationThreads = input.get("sampling.excitationThreads", false);
+    schd.diagonalRebuild = input.get("sampling.diagonalRebuild", 100);
     schd.integralSampleSize = input.get("sampling.integralSampleSize", 10);
     schd.useLastDet = input.get("sampling.useLastDet", false);
     schd.useLogTime = input.get("sampling.useLogTime", false);
@@ -173,19 +179,39 @@ void readInput(string inputFile, schedule& schd, bool print) {
     }
     schd.printFrequency = input.get("sampling.printFreq", 100);
     schd.dt = input.get("sampling.dt", 0.1);
+    child = input.get_child_optional("sampling.dtSubsteps");
+    if (child) {
+      for (property_tree::iptree::value_type &dtSubsteps : input.get_child("sampling.dtSubsteps")) {
+        schd.dtSubsteps.push_back(stoi(dtSubsteps.second.data()));
+      }
+    }
+    schd.backPropSteps = input.get("sampling.backPropSteps", 0);
+    schd.backPropFreq = input.get("sampling.backPropFreq", 1);
     schd.fieldStepsize = input.get("sampling.stepsize", 0.1);
     schd.measureFreq = input.get("sampling.measureFreq", 10);
     schd.orthoSteps = input.get("sampling.orthoSteps", 50);
+    schd.orthoMethod = algorithm::to_lower_copy(input.get("sampling.orthoMethod", "householder"));
+    schd.orthoCond = input.get("sampling.orthoCond", 0.);
+    schd.orthoCheckSteps = input.get("sampling.orthoCheckSteps", 5);
     schd.ene0Guess = input.get("sampling.ene0Guess", 1e10); // assuming ground state energy will not be 1e10
     schd.numJastrowSamples = input.get("sampling.numJastrowSamples", 50);
     schd.ngrid = input.get("sampling.ngrid", 1);
     schd.sampleDeterminants = input.get("sampling.sampleDeterminants", -1);
     schd.choleskyThreshold = input.get("sampling.choleskyThreshold", 0.005);
+    schd.choleskyRanking = input.get("sampling.choleskyRanking", false);
     schd.leftWave = algorithm::to_lower_copy(input.get("wavefunction.left", "rhf"));
     schd.rightWave = algorithm::to_lower_copy(input.get("wavefunction.right", "rhf"));
     schd.ndets = input.get("wavefunction.ndets", 1e6);
     schd.phaseless = input.get("sampling.phaseless", false);
     schd.weightCap = input.get("sampling.weightCap", -1.);
+    schd.batchProp = input.get("sampling.batchProp", false);
+    schd.walkerThreads = input.get("sampling.walkerThreads", false);
+    schd.checkpointFreq = input.get("sampling.checkpointFreq", 0);
+    schd.restartAFQMC = input.get("sampling.restart", false);
+    schd.floatProp = input.get("sampling.floatProp", false);
+    schd.expMethod = algorithm::to_lower_copy(input.get("sampling.expMethod", "taylor"));
+    schd.expOrder = input.get("sampling.expOrder", -1);
+    schd.expTol = input.get("sampling.expTol", 1.e-10);
 
     // GFMC
     schd.maxIter = input.get("sampling.maxIter", 50); //note: parameter repeated in optimizer for vmc
@@ -253,6 +279,7 @@ void readInput(string inputFile, schedule& schd, bool print) {
     schd.optimizeRBM = input.get("optimizer.optimizeRBM", true);
     schd.cgIter = input.get("optimizer.cgIter", 15);
     schd.sDiagShift = input.get("optimizer.sDiagShift", 0.01);
+    schd.minSRSamples = input.get("optimizer.minSRSamples", 0);
     schd.doHessian = input.get("optimizer.doHessian", false);
     schd.diagMethod = input.get("optimizer.diagMethod", "power");
     schd.powerShift = input.get("optimizer.powerShift", 10);
@@ -63,6 +63,9 @@ private:
       & method
       & stochasticIter
       & burnIter
+      & nchains
+      & excitationThreads
+      & diagonalRebuild
       & _sgdIter
       & momentum
       & integralSampleSize
@@ -71,6 +74,7 @@ private:
       & epsilon
       & screen
       & determinantFile
+      & compactDeterminantFile
       & detsInCAS
       & doHessian
       & hf
@@ -98,6 +102,7 @@ private:
       & usingFOIS
       & sDiagShift
       & cgIter
+      & minSRSamples
       & stepsize
       & ifComplex
       & uagp
@@ -145,15 +150,22 @@ private:
 
       // dqmc
       & dt
+      & dtSubsteps
+      & backPropSteps
+      & backPropFreq
       & nsteps
       & eneSteps
       & errorTargets
       & fieldStepsize
       & measureFreq
       & orthoSteps
+      & orthoMethod
+      & orthoCond
+      & orthoCheckSteps
       & ene0Guess
       & numJastrowSamples
       & choleskyThreshold
+      & choleskyRanking
       & ciThreshold
       & leftWave
       & rightWave
@@ -162,8 +174,18 @@ private:
       & soc
       & writeOneRDM
       & intType
+      & thc
+      & cholStorage
       & scratchDir
       & weightCap
+      & batchProp
+      & walkerThreads
+      & checkpointFreq
+      & restartAFQMC
+      & floatProp
+      & expMethod
+      & expOrder
+      & expTol
       // Options related to SC-NEVPT(s):
       & numSCSamples
       & printSCNorms
@@ -218,6 +240,7 @@ public:
   std::string wavefunctionType;
   std::map<int, std::string> correlatorFiles;
   std::string determinantFile;
+  std::string compactDeterminantFile;   // afqmc multislater trial in the compact format, written from determinantFile if absent
   int numResonants;
   bool ghfDets;
   double normSampleThreshold;
@@ -228,6 +251,9 @@ public:
 //Used in the stochastic calculation of E and PT evaluation
   int stochasticIter;                    //Number of stochastic steps
   int burnIter;                          //Number of burn in steps
+  int nchains;                           //Number of markov chains advanced in lockstep on each rank
+  bool excitationThreads;                //Evaluate the excitations of a local energy over openmp threads
+  int diagonalRebuild;                  //Moves after which a walker rebuilds its tracked diagonal energy, 0 recomputes it every time
   int integralSampleSize;                //This specifies the number of determinants to sample out of the o^2v^2 possible determinants after the action of V
   size_t seed;                              // seed for the random number generator
   bool detsInCAS;
@@ -307,6 +333,7 @@ public:
   Method method;
   double sDiagShift;
   int cgIter;
+  int minSRSamples;
   bool ctmc;
 
   /*
@@ -380,15 +407,22 @@ public:
   std::vector<int> eneSteps;
   std::vector<double> errorTargets;
   double dt;
+  std::vector<int> dtSubsteps;  // more than one entry: correlated phaseless replicas with time steps dt / dtSubsteps[k]
+  int backPropSteps;         // > 0: back propagated 1-RDM with windows of this many steps
+  int backPropFreq;          // blocks between the ends of back propagation windows
   double fieldStepsize;
   size_t measureFreq;
   size_t orthoSteps;
+  std::string orthoMethod;   // householder, cholqr2 or mgs thin qr of the walkers
+  double orthoCond;          // > 0: orthogonalize when the condition estimate exceeds this, orthoSteps is then the longest interval
+  int orthoCheckSteps;       // steps between condition estimates with orthoCond
   double ene0Guess;
   size_t numJastrowSamples;
   int ngrid;
   size_t printFrequency;
   int sampleDeterminants;
   double choleskyThreshold;
+  bool choleskyRanking;      // truncate cholesky vectors ranked by their energy contribution
   std::string leftWave;
   std::string rightWave;
   size_t ndets;
@@ -396,8 +430,18 @@ public:
   bool soc;
   bool writeOneRDM;
   std::string intType;
+  bool thc;                  // thc factorized integrals in the integrals file
+  std::string cholStorage;   // full, or a single packed lower triangular copy of the cholesky vectors in double or float
   std::string scratchDir;
   double weightCap;
+  bool batchProp;
+  bool walkerThreads;
+  int checkpointFreq;
+  bool restartAFQMC;
+  bool floatProp;
+  std::string expMethod;     // taylor, adaptive or scaled application of exp(VHS)
+  int expOrder;
+  double expTol;
 };
 
 /**
@@ -630,7 +630,7 @@ void readDQMCIntegralsRG(string fcidump, int& norbs, int& nalpha, int& nbeta, do
   size_t cholSize = nchol * norbs * norbs;
   double* cholSHM;
   MPI_Barrier(MPI_COMM_WORLD);
-  readHDF5ToSHM(file, "/chol", cholSize, cholSHM, cholSHMName, cholSegment, cholRegion);
+  readHDF5ToSHM(file, "/chol", cholSize, cholSHM, cholSHMName, cholSegment, cholRegion, norbs * norbs);
   MPI_Barrier(MPI_COMM_WORLD);
 
   // create eigen matrix maps to shared memory
@@ -661,6 +661,152 @@ void readDQMCIntegralsRG(string fcidump, int& norbs, int& nalpha, int& nbeta, do
 } 
 
 
+// the thc factors are small (nthc x norbs and nthc x nthc) and are kept on every process
+void readDQMCIntegralsTHC(string fcidump, int& norbs, int& nalpha, int& nbeta, double& ecore, MatrixXd& h1, MatrixXd& thcOrbs, MatrixXd& thcV) {
+  int nelec, sz, nthc;
+  hid_t file = (-1), dataset_header = (-1), dataset_energy_core = (-1);  
+  herr_t status;
+
+  H5E_BEGIN_TRY {
+  file = H5Fopen(fcidump.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT);
+  } H5E_END_TRY
+  if (file < 0) {
+    if (commrank == 0) cout << "THC integrals not found!" << endl;
+    exit(1);
+  }
+
+  int header[4];
+  for (int i = 0; i < 4; i++) header[i] = 0;
+  
+  H5E_BEGIN_TRY {
+    dataset_header = H5Dopen(file, "/header", H5P_DEFAULT);
+    status = H5Dread(dataset_header, H5T_NATIVE_INT, H5S_ALL, H5S_ALL, H5P_DEFAULT, header);
+  } H5E_END_TRY
+  if (dataset_header < 0) {
+    if (commrank == 0) cout << "Header could not be read." << endl;
+    exit(1);
+  }
+  
+  nelec = header[0]; norbs = header[1]; sz = header[2]; nthc = header[3];
+  nalpha = (nelec + sz)/2;
+  nbeta = nelec - nalpha;
+
+  // these shouldn't really be used anywhere in afqmc
+  Determinant::EffDetLen = (norbs) / 64 + 1;
+  Determinant::norbs = norbs;
+  Determinant::nalpha = nalpha;
+  Determinant::nbeta = nbeta;
+
+  h1 = MatrixXd::Zero(norbs, norbs);
+  readMat(h1, file, "/hcore"); 
+  thcOrbs = MatrixXd::Zero(nthc, norbs);
+  readMat(thcOrbs, file, "/thc_orbs"); 
+  thcV = MatrixXd::Zero(nthc, nthc);
+  readMat(thcV, file, "/thc_V"); 
+
+  coreE = 0.;
+  double energy_core[1];
+  energy_core[0] = 0.;
+  H5E_BEGIN_TRY {
+    dataset_energy_core = H5Dopen(file, "/energy_core", H5P_DEFAULT);
+    status = H5Dread(dataset_energy_core, H5T_NATIVE_DOUBLE, H5S_ALL, H5S_ALL, H5P_DEFAULT, energy_core);
+  } H5E_END_TRY
+  if (dataset_energy_core < 0) {
+    if (commrank == 0) cout << "Core energy could not be read, setting to zero." << endl;
+  }
+  else {
+    coreE = energy_core[0];
+    ecore = energy_core[0];
+  }
+
+  status = H5Fclose(file);
+} 
+
+
+// a single packed copy of the lower triangles of the cholesky vectors in shared memory, in double (packedChol)
+// or float (floatChol), the full vectors are never stored, h1 and h1Mod hold two spin components for u
+void readDQMCIntegralsPacked(string fcidump, std::string intType, bool floatQ, int& norbs, int& nalpha, int& nbeta, int& nchol, double& ecore, std::array<MatrixXd, 2>& h1, std::array<MatrixXd, 2>& h1Mod, double*& packedChol, float*& floatChol) {
+  int nelec, sz;
+  hid_t file = (-1), dataset_header = (-1), dataset_energy_core = (-1);  
+  herr_t status;
+
+  H5E_BEGIN_TRY {
+  file = H5Fopen(fcidump.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT);
+  } H5E_END_TRY
+  if (file < 0) {
+    if (commrank == 0) cout << "Cholesky integrals not found!" << endl;
+    exit(1);
+  }
+
+  int header[4];
+  for (int i = 0; i < 4; i++) header[i] = 0;
+  
+  H5E_BEGIN_TRY {
+    dataset_header = H5Dopen(file, "/header", H5P_DEFAULT);
+    status = H5Dread(dataset_header, H5T_NATIVE_INT, H5S_ALL, H5S_ALL, H5P_DEFAULT, header);
+  } H5E_END_TRY
+  if (dataset_header < 0) {
+    if (commrank == 0) cout << "Header could not be read." << endl;
+    exit(1);
+  }
+  
+  nelec = header[0]; norbs = header[1]; sz = header[2]; nchol = header[3];
+  nalpha = (nelec + sz)/2;
+  nbeta = nelec - nalpha;
+
+  // these shouldn't really be used anywhere in afqmc
+  Determinant::EffDetLen = (norbs) / 64 + 1;
+  Determinant::norbs = norbs;
+  Determinant::nalpha = nalpha;
+  Determinant::nbeta = nbeta;
+
+  vector<string> cholNames;
+  if (intType == "u") {
+    for (int i = 0; i < 2; i++) {
+      h1[i] = MatrixXd::Zero(norbs, norbs);
+      h1Mod[i] = MatrixXd::Zero(norbs, norbs);
+    }
+    readMat(h1[0], file, "/hcore_up"); 
+    readMat(h1[1], file, "/hcore_dn"); 
+    readMat(h1Mod[0], file, "/hcore_mod_up"); 
+    readMat(h1Mod[1], file, "/hcore_mod_dn"); 
+    cholNames = {"/chol_up", "/chol_dn"};
+  }
+  else {
+    h1[0] = MatrixXd::Zero(norbs, norbs);
+    readMat(h1[0], file, "/hcore"); 
+    h1Mod[0] = MatrixXd::Zero(norbs, norbs);
+    readMat(h1Mod[0], file, "/hcore_mod"); 
+    cholNames = {"/chol"};
+  }
+
+  // read packed cholesky to shared memory
+  packedChol = nullptr;
+  floatChol = nullptr;
+  MPI_Barrier(MPI_COMM_WORLD);
+  if (floatQ) readHDF5ToSHMPacked(file, cholNames, nchol, norbs, floatChol, floatCholSHMName, floatCholSegment, floatCholRegion);
+  else readHDF5ToSHMPacked(file, cholNames, nchol, norbs, packedChol, cholSHMName, cholSegment, cholRegion);
+  MPI_Barrier(MPI_COMM_WORLD);
+
+  coreE = 0.;
+  double energy_core[1];
+  energy_core[0] = 0.;
+  H5E_BEGIN_TRY {
+    dataset_energy_core = H5Dopen(file, "/energy_core", H5P_DEFAULT);
+    status = H5Dread(dataset_energy_core, H5T_NATIVE_DOUBLE, H5S_ALL, H5S_ALL, H5P_DEFAULT, energy_core);
+  } H5E_END_TRY
+  if (dataset_energy_core < 0) {
+    if (commrank == 0) cout << "Core energy could not be read, setting to zero." << endl;
+  }
+  else {
+    coreE = energy_core[0];
+    ecore = energy_core[0];
+  }
+
+  status = H5Fclose(file);
+} 
+
+
 void readDQMCIntegralsU(string fcidump, int& norbs, int& nalpha, int& nbeta, double& ecore, std::array<MatrixXd, 2>& h1, std::array<MatrixXd, 2>& h1Mod, vector<std::array<Eigen::Map<MatrixXd>, 2>>& chol) {
   int nelec, sz, nchol;
   hid_t file = (-1), dataset_header = (-1), dataset_energy_core = (-1);  
@@ -710,8 +856,8 @@ void readDQMCIntegralsU(string fcidump, int& norbs, int& nalpha, int& nbeta, dou
   double* cholSHMUp;
   double* cholSHMDn;
   MPI_Barrier(MPI_COMM_WORLD);
-  readHDF5ToSHM(file, "/chol_up", cholSize, cholSHMUp, cholSHMNameUp, cholSegmentUp, cholRegionUp);
-  readHDF5ToSHM(file, "/chol_dn", cholSize, cholSHMDn, cholSHMNameDn, cholSegmentDn, cholRegionDn);
+  readHDF5ToSHM(file, "/chol_up", cholSize, cholSHMUp, cholSHMNameUp, cholSegmentUp, cholRegionUp, norbs * norbs);
+  readHDF5ToSHM(file, "/chol_dn", cholSize, cholSHMDn, cholSHMNameDn, cholSegmentDn, cholRegionDn, norbs * norbs);
   MPI_Barrier(MPI_COMM_WORLD);
 
   // create eigen matrix maps to shared memory
@@ -781,7 +927,7 @@ void readDQMCIntegralsSOC(string fcidump, int& norbs, int& nelec, double& ecore,
   unsigned int cholSize = nchol * norbs * norbs;
   double* cholSHM;
   MPI_Barrier(MPI_COMM_WORLD);
-  readHDF5ToSHM(file, "/chol", cholSize, cholSHM, cholSHMName, cholSegment, cholRegion);
+  readHDF5ToSHM(file, "/chol", cholSize, cholSHM, cholSHMName, cholSegment, cholRegion, norbs * norbs);
   MPI_Barrier(MPI_COMM_WORLD);
   
   // create eigen matrix maps to shared memory
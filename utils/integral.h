@@ -291,6 +291,10 @@ void readIntegralsHDF5AndInitializeDeterminantStaticVariables(string fcidump);
 
 void readDQMCIntegralsRG(string fcidump, int& norbs, int& nalpha, int& nbeta, double& ecore, Eigen::MatrixXd& h1, Eigen::MatrixXd& h1Mod, std::vector<Eigen::Map<Eigen::MatrixXd>>& chol, std::vector<Eigen::Map<Eigen::MatrixXd>>& cholMat, bool ghf=false);
 void readDQMCIntegralsU(string fcidump, int& norbs, int& nalpha, int& nbeta, double& ecore, std::array<Eigen::MatrixXd, 2>& h1, std::array<Eigen::MatrixXd, 2>& h1Mod, std::vector<std::array<Eigen::Map<Eigen::MatrixXd>, 2>>& chol);
+// packed lower triangular cholesky vectors, a single shared memory copy in double or float
+void readDQMCIntegralsPacked(string fcidump, std::string intType, bool floatQ, int& norbs, int& nalpha, int& nbeta, int& nchol, double& ecore, std::array<Eigen::MatrixXd, 2>& h1, std::array<Eigen::MatrixXd, 2>& h1Mod, double*& packedChol, float*& floatChol);
+// thc factorized integrals, (pq|rs) = sum_PQ thcOrbs_Pp thcOrbs_Pq thcV_PQ thcOrbs_Qr thcOrbs_Qs
+void readDQMCIntegralsTHC(string fcidump, int& norbs, int& nalpha, int& nbeta, double& ecore, Eigen::MatrixXd& h1, Eigen::MatrixXd& thcOrbs, Eigen::MatrixXd& thcV);
 void readDQMCIntegralsSOC(string fcidump, int& norbs, int& nelec, double& ecore, Eigen::MatrixXcd& h1, Eigen::MatrixXcd& h1Mod, std::vector<Eigen::Map<Eigen::MatrixXd>>& chol);
 
 #endif
@@ -55,6 +55,8 @@ boost::interprocess::shared_memory_object rotCholSegment;
 boost::interprocess::mapped_region rotCholRegion;
 std::string rotCholSHMName;
 
+std::vector<std::string> ciSHMNames;
+
 std::mt19937 generator;
 
 #ifndef SERIAL